@@ -0,0 +1,216 @@
+#include "BatchEval.h"
+
+#include <cstring>
+
+#include "Evaluate.h"
+
+// builds the kernel for avx2 as well as the baseline and picks one when the
+// program loads
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && \
+    defined(__linux__)
+#define BATCH_TARGETS __attribute__((target_clones("avx2", "default")))
+#else
+#define BATCH_TARGETS
+#endif
+
+namespace {
+
+using Lanes = std::uint64_t[BLOCK_SIZE];
+
+constexpr std::uint64_t FILE_A = 0x0101010101010101ULL;  // index 0 is a8
+constexpr std::uint64_t NOT_A = ~FILE_A;
+constexpr std::uint64_t NOT_H = ~(FILE_A << 7);
+constexpr std::uint64_t NOT_AB = ~(FILE_A | FILE_A << 1);
+constexpr std::uint64_t NOT_GH = ~(FILE_A << 6 | FILE_A << 7);
+
+// a shift of +1 moves a piece one file towards h, +8 one rank towards rank 1
+inline std::uint64_t shift(std::uint64_t bits, int amount) {
+  return amount > 0 ? bits << amount : bits >> -amount;
+}
+
+// kogge-stone fill along one direction, stopping at (and including) the
+// first piece in the way
+inline std::uint64_t slide(std::uint64_t sliders, std::uint64_t empty,
+                           int step, std::uint64_t mask) {
+  std::uint64_t pro = empty & mask;
+  sliders |= pro & shift(sliders, step);
+  pro &= shift(pro, step);
+  sliders |= pro & shift(sliders, 2 * step);
+  pro &= shift(pro, 2 * step);
+  sliders |= pro & shift(sliders, 4 * step);
+  return shift(sliders, step) & mask;
+}
+
+inline std::uint64_t knightFill(std::uint64_t knights) {
+  return ((knights << 17 | knights >> 15) & NOT_A) |
+         ((knights << 15 | knights >> 17) & NOT_H) |
+         ((knights << 10 | knights >> 6) & NOT_AB) |
+         ((knights << 6 | knights >> 10) & NOT_GH);
+}
+
+inline std::uint64_t popcount(std::uint64_t bits) {  // swar, so it vectorizes
+  bits -= bits >> 1 & 0x5555555555555555ULL;
+  bits = (bits & 0x3333333333333333ULL) + (bits >> 2 & 0x3333333333333333ULL);
+  bits = (bits + (bits >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+  bits += bits >> 8;  // avx2 has no 64 bit multiply, so add the bytes up
+  bits += bits >> 16;
+  bits += bits >> 32;
+  return bits & 127;
+}
+
+// the loops below all run across the lanes of a block with no branches, so
+// the compiler turns each one into vector code
+BATCH_TARGETS
+void evaluateLanes(const positionBlock& block,
+                   const std::int64_t (&weights)[12][64],
+                   const std::int64_t (&mobility)[12], int* scores) {
+  alignas(64) std::int64_t total[BLOCK_SIZE] = {};
+  alignas(64) Lanes own[2] = {};
+  alignas(64) Lanes empty;
+
+  for (int kind = 0; kind < 12; ++kind) {
+    const std::uint64_t* bits = block.pieces[kind];
+    for (int lane = 0; lane < BLOCK_SIZE; ++lane) {
+      own[kind / 6][lane] |= bits[lane];
+    }
+    // material and piece square together, weights already carry the sign
+    for (int square = 0; square < 64; ++square) {
+      std::int64_t weight = weights[kind][square];
+      for (int lane = 0; lane < BLOCK_SIZE; ++lane) {
+        std::int64_t set = bits[lane] >> square & 1;
+        total[lane] += -set & weight;
+      }
+    }
+  }
+  for (int lane = 0; lane < BLOCK_SIZE; ++lane) {
+    empty[lane] = ~(own[0][lane] | own[1][lane]);
+  }
+
+  for (int colour = 0; colour < 2; ++colour) {
+    const std::uint64_t* knights = block.pieces[colour * 6 + 2];
+    const std::uint64_t* rooks = block.pieces[colour * 6 + 1];
+    const std::uint64_t* bishops = block.pieces[colour * 6 + 3];
+    const std::uint64_t* queens = block.pieces[colour * 6 + 4];
+    std::int64_t knightWeight = mobility[colour * 6 + 2];
+    std::int64_t rookWeight = mobility[colour * 6 + 1];
+    std::int64_t bishopWeight = mobility[colour * 6 + 3];
+    std::int64_t queenWeight = mobility[colour * 6 + 4];
+    for (int lane = 0; lane < BLOCK_SIZE; ++lane) {
+      std::uint64_t free = ~own[colour][lane];
+      std::uint64_t open = empty[lane];
+      std::uint64_t knightAttacks = knightFill(knights[lane]);
+
+      std::uint64_t rookAttacks =
+          slide(rooks[lane], open, 1, NOT_A) |
+          slide(rooks[lane], open, -1, NOT_H) |
+          slide(rooks[lane], open, 8, ~0ULL) |
+          slide(rooks[lane], open, -8, ~0ULL);
+      std::uint64_t bishopAttacks =
+          slide(bishops[lane], open, 9, NOT_A) |
+          slide(bishops[lane], open, 7, NOT_H) |
+          slide(bishops[lane], open, -7, NOT_A) |
+          slide(bishops[lane], open, -9, NOT_H);
+      std::uint64_t queenAttacks =
+          slide(queens[lane], open, 1, NOT_A) |
+          slide(queens[lane], open, -1, NOT_H) |
+          slide(queens[lane], open, 8, ~0ULL) |
+          slide(queens[lane], open, -8, ~0ULL) |
+          slide(queens[lane], open, 9, NOT_A) |
+          slide(queens[lane], open, 7, NOT_H) |
+          slide(queens[lane], open, -7, NOT_A) |
+          slide(queens[lane], open, -9, NOT_H);
+
+      total[lane] += knightWeight * popcount(knightAttacks & free) +
+                     rookWeight * popcount(rookAttacks & free) +
+                     bishopWeight * popcount(bishopAttacks & free) +
+                     queenWeight * popcount(queenAttacks & free);
+    }
+  }
+
+  for (int lane = 0; lane < BLOCK_SIZE; ++lane) {
+    std::int64_t sign = block.blackToMove[lane] ? -1 : 1;
+    scores[lane] = static_cast<int>(total[lane] * sign);
+  }
+}
+
+}  // namespace
+
+void positionBlock::clear() {
+  std::memset(pieces, 0, sizeof(pieces));
+  std::memset(blackToMove, 0, sizeof(blackToMove));
+  count = 0;
+}
+
+void positionBlock::addSquares(const std::array<int, 64>& squares,
+                               bool black) {
+  if (count == 0) {
+    clear();
+  }
+  for (int i = 0; i < 64; ++i) {
+    if (squares[i]) {
+      pieces[squares[i] / 8 * 6 + squares[i] % 8 - 1][count] |= 1ULL << i;
+    }
+  }
+  blackToMove[count] = black;
+  count++;
+}
+
+void positionBlock::addBoard(const Board& board) {
+  std::array<int, 64> squares;
+  for (int i = 0; i < 64; ++i) {
+    squares[i] = board.getPiece(i);
+  }
+  addSquares(squares, board.isBlackToMove());
+}
+
+bool positionBlock::addFen(const std::string& fen) {
+  Board board;
+  if (!board.loadFen(fen)) {
+    return false;
+  }
+  addBoard(board);
+  return true;
+}
+
+void positionBlock::addPacked(const packedPosition& packed) {
+  addSquares(unpackSquares(packed), isBlackToMove(packed));
+}
+
+std::array<int, 64> positionBlock::squaresAt(int slot) const {
+  std::array<int, 64> squares{};
+  for (int kind = 0; kind < 12; ++kind) {
+    for (int i = 0; i < 64; ++i) {
+      if (pieces[kind][slot] >> i & 1) {
+        squares[i] = kind / 6 * 8 + kind % 6 + 1;
+      }
+    }
+  }
+  return squares;
+}
+
+void evaluateBlock(const positionBlock& block, int* scores) {
+  // fold the tables into one signed weight per piece and square, so tuned
+  // parameters are picked up on the next call
+  const EvalParams& params = evalParams();
+  std::int64_t weights[12][64];
+  std::int64_t mobility[12];
+  for (int kind = 0; kind < 12; ++kind) {
+    int type = kind % 6 + 1;
+    bool black = kind >= 6;
+    for (int i = 0; i < 64; ++i) {
+      int value = params.pieceValues[type] +
+                  params.pieceSquare[type][black ? i ^ 56 : i];
+      weights[kind][i] = black ? -value : value;
+    }
+    mobility[kind] = black ? -params.mobility[type] : params.mobility[type];
+  }
+  alignas(64) int laneScores[BLOCK_SIZE];
+  evaluateLanes(block, weights, mobility, laneScores);
+  std::memcpy(scores, laneScores, sizeof(int) * block.count);
+}
+
+void evaluateBlockScalar(const positionBlock& block, int* scores) {
+  for (int slot = 0; slot < block.count; ++slot) {
+    scores[slot] = evaluateSquares(block.squaresAt(slot), block.blackToMove[slot]);
+  }
+}
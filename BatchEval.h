@@ -0,0 +1,34 @@
+#ifndef BATCHEVAL_H
+#define BATCHEVAL_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "Board.h"
+#include "PackedPosition.h"
+
+constexpr int BLOCK_SIZE = 64;  // positions per block
+
+struct positionBlock {  // positions stored structure-of-arrays, so the same
+                        // bitboard of every position sits side by side
+  alignas(64) std::uint64_t pieces[12][BLOCK_SIZE];  // [colour * 6 + type - 1]
+  alignas(64) std::uint8_t blackToMove[BLOCK_SIZE];
+  int count = 0;
+
+  void clear();
+  bool full() const { return count == BLOCK_SIZE; }
+  void addSquares(const std::array<int, 64>& squares, bool black);
+  void addBoard(const Board& board);
+  bool addFen(const std::string& fen);  // false if the fen doesn't parse
+  void addPacked(const packedPosition& packed);
+  std::array<int, 64> squaresAt(int slot) const;
+};
+
+// both write one score per position, from the side to move's point of view,
+// matching evaluate(). the vector path is the one to use, the scalar one goes
+// position by position through evaluateSquares to check it against
+void evaluateBlock(const positionBlock& block, int* scores);
+void evaluateBlockScalar(const positionBlock& block, int* scores);
+
+#endif  // BATCHEVAL_H
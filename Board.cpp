@@ -2,14 +2,19 @@
 
 #include "Board.h"
 
+#include <algorithm>
 #include <any>
+#include <cctype>
+#include <cstdlib>
 #include <functional>
 #include <iostream>
 #include <optional>
+#include <sstream>
 #include <unordered_set>
 #include <vector>
 
-#include "Game.h"
+#include "Profiler.h"
+#include "SlidingAttacks.h"
 
 std::array<Point, 8> sliders = {
     Point{0, -1}, {1, -1}, {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1},
@@ -54,24 +59,143 @@ std::array<Point, 8> knightDirections = {
      */
 };
 
-std::vector<int> Board::piecesOf(int turn) {
-  std::vector<int> pieceLocations;
-  forEachSquare([&](int i) {
-    if (board[i] / 8 == !turn && board[i] != 0) {
-      pieceLocations.push_back(i);
+namespace {
+
+struct ZobristKeys {  // random numbers xored together to make position keys
+  std::array<std::array<std::uint64_t, 64>, 15> pieces;  // indexed by id
+  std::array<std::uint64_t, 4> castling;
+  std::array<std::uint64_t, 8> enPassant;
+  std::uint64_t blackToMove;
+
+  ZobristKeys() {
+    std::uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    auto next = [&]() {  // splitmix64, fixed seed so keys match across runs
+      std::uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      return z ^ (z >> 31);
+    };
+    for (auto& piece : pieces) {
+      for (auto& key : piece) {
+        key = next();
+      }
     }
-  });
-  return pieceLocations;
+    for (auto& key : castling) {
+      key = next();
+    }
+    for (auto& key : enPassant) {
+      key = next();
+    }
+    blackToMove = next();
+  }
+};
+
+const ZobristKeys zobrist;
+
+// true if every square strictly between from and to is empty. from and to
+// are always on a line here (or a knight/king step apart)
+bool pathIsClear(const std::array<int, 64>& board, int from, int to) {
+  int dx = (to % 8 > from % 8) - (to % 8 < from % 8);
+  int dy = (to / 8 > from / 8) - (to / 8 < from / 8);
+  int rowGap = std::abs(to / 8 - from / 8);
+  int colGap = std::abs(to % 8 - from % 8);
+  if (rowGap != colGap && rowGap && colGap) {
+    return true;  // knight jump
+  }
+  for (int i = from + dx + dy * 8; i != to; i += dx + dy * 8) {
+    if (board[i]) {
+      return false;
+    }
+  }
+  return true;
 }
 
-bool Board::getTurn() {
-  if (lastPieceMoved <= 8 && lastPieceMoved != 0) {
-    // false when blacks turn, true when whites
+// every reversible move (not a pawn, on an empty board) keyed by how it
+// changes the position key, stored cuckoo style so finding one is two reads.
+// lets the search spot a position it can go back to without walking the
+// history for each move
+struct CuckooTables {
+  std::array<std::uint64_t, 8192> keys{};
+  std::array<std::int8_t, 8192> from{};
+  std::array<std::int8_t, 8192> to{};
+  int count = 0;
+
+  CuckooTables();
+};
+
+int cuckooFirstSlot(std::uint64_t key) { return key & 0x1fff; }
+int cuckooSecondSlot(std::uint64_t key) { return (key >> 16) & 0x1fff; }
+
+CuckooTables::CuckooTables() {
+  auto reaches = [](int type, int from, int to) {
+    int rowGap = std::abs(to / 8 - from / 8);
+    int colGap = std::abs(to % 8 - from % 8);
+    switch (type) {
+      case 2:
+        return rowGap == 0 || colGap == 0;
+      case 3:
+        return rowGap * colGap == 2;
+      case 4:
+        return rowGap == colGap;
+      case 5:
+        return rowGap == 0 || colGap == 0 || rowGap == colGap;
+      case 6:
+        return rowGap <= 1 && colGap <= 1;
+    }
     return false;
+  };
+  for (int id : {2, 3, 4, 5, 6, 10, 11, 12, 13, 14}) {
+    for (int a = 0; a < 64; ++a) {
+      for (int b = a + 1; b < 64; ++b) {
+        if (!reaches(id % 8, a, b)) {
+          continue;
+        }
+        std::uint64_t key = zobrist.pieces[id][a] ^ zobrist.pieces[id][b] ^
+                            zobrist.blackToMove;
+        std::int8_t moveFrom = static_cast<std::int8_t>(a);
+        std::int8_t moveTo = static_cast<std::int8_t>(b);
+        int slot = cuckooFirstSlot(key);
+        while (true) {  // kick out whatever is there until it all fits
+          std::swap(keys[slot], key);
+          std::swap(from[slot], moveFrom);
+          std::swap(to[slot], moveTo);
+          if (!key) {
+            break;
+          }
+          slot = slot == cuckooFirstSlot(key) ? cuckooSecondSlot(key)
+                                              : cuckooFirstSlot(key);
+        }
+        count++;
+      }
+    }
   }
-  return true;
 }
 
+const CuckooTables cuckoo;
+
+// everything about moving that depends on colour. the templated move
+// generator functions read these, so each colour gets its own copy with the
+// numbers baked in instead of checking isBlack all the way through
+template <bool Black>
+struct Side {
+  static constexpr int offset = Black ? 8 : 0;    // piece type + offset = id
+  static constexpr int forward = Black ? 8 : -8;  // one square up the board
+                                                  // for this side's pawns
+  static constexpr int startRow = Black ? 1 : 6;  // pawns can move two from
+  static constexpr int promotionRow =
+      Black ? 6 : 1;  // pawns here promote on their next move
+  static constexpr int enPassantRow =
+      Black ? 4 : 3;  // pawns here can take en passant
+  static constexpr int backRank = Black ? 0 : 56;  // index of the a file
+                                                   // square on the home row
+  static constexpr int queensideRight = Black ? 0 : 2;  // in castleRights
+  static constexpr int kingsideRight = Black ? 1 : 3;
+};
+
+}  // namespace
+
+bool Board::getTurn() const { return !blackToMove; }
+
 bool Board::onSameLine(int from, int to, int direction) {
   int fromRow = from / 8, fromCol = from % 8;
   int toRow = to / 8, toCol = to % 8;
@@ -108,39 +232,39 @@ void Board::newPin(int pinnedPiece, int kingIndex, int attackerIndex,
 }
 
 void Board::slidingMoves(pieceData p, std::vector<moveType>& moves,
-                         const std::array<int, 64>& currentBoard) {
-  std::vector<int> directions;
-
+                         const std::array<int, 64>& currentBoard,
+                         std::uint64_t occupied) {
+  std::uint64_t attacked;
+  int firstDirection = 0;
+  int directionStep = 1;
   if (p.type == 2) {
-    directions = {0, 2, 4, 6};  // rook directions
+    attacked = rookAttackBits(p.index, occupied);
+    directionStep = 2;  // rook directions, the even ones
   } else if (p.type == 4) {
-    directions = {1, 3, 5, 7};  // bishop directions
-  } else if (p.type == 5) {
-    directions = {0, 1, 2, 3, 4, 5, 6, 7};  // queen directions
+    attacked = bishopAttackBits(p.index, occupied);
+    firstDirection = 1;  // bishop directions, the odd ones
+    directionStep = 2;
+  } else {
+    attacked = queenAttackBits(p.index, occupied);
   }
 
-  for (auto dir : directions) {
-    int x = p.index % 8;
-    int y = p.index / 8;
-
-    while (true) {
-      x += sliders[dir].X;
-      y += sliders[dir].Y;
-
-      if (x < 0 || x > 7 || y < 0 || y > 7) {
-        break;
-      }
-      int i = x + (8 * y);
-
+  // one direction at a time, nearest square first, so the moves come out in
+  // the same order as walking the rays would give
+  for (int dir = firstDirection; dir < 8; dir += directionStep) {
+    std::uint64_t ray = attacked & rayBits(p.index, dir);
+    bool towardsH1 = dir >= 2 && dir <= 5;  // up the bit order
+    while (ray) {
+      int i = towardsH1 ? lowestBit(ray) : highestBit(ray);
+      ray &= ~(1ULL << i);
       if (currentBoard[i]) {
         if (canTake(i, p.isBlack, currentBoard)) {
           moveType take{p.index, i, 2};
           moves.push_back(take);
         }
-        break;
+      } else {
+        moveType slide{p.index, i, 1};
+        moves.push_back(slide);
       }
-      moveType slide{p.index, i, 1};
-      moves.push_back(slide);
     }
   }
 }
@@ -166,141 +290,109 @@ void Board::knightMoves(pieceData p, std::vector<moveType>& moves,
   }
 }
 
-void Board::pawnMoves(pieceData p, std::vector<moveType>& moves,
+template <bool Black>
+void Board::pawnMoves(int index, std::vector<moveType>& moves,
                       const std::array<int, 64>& currentBoard) {
-  const int ADD_ROW = p.isBlack ? 8 : -8;
-  int row = p.index / 8;
-  int col = p.index % 8;
-  ;
+  using S = Side<Black>;
+  int row = index / 8;
+  int col = index % 8;
+  bool promoting = row == S::promotionRow;
 
-  int forwardOne = p.index + ADD_ROW;
-  int forwardTwo = p.index + 2 * ADD_ROW;
+  int forwardOne = index + S::forward;
+  int forwardTwo = index + 2 * S::forward;
 
   if (!currentBoard[forwardOne]) {
-    moveType f1{};
-    f1.from = p.index;
-    f1.to = forwardOne;
-    if (p.isBlack && row == 6 || !p.isBlack && row == 1) {
-      f1.typeOfMove = 5;  // means pawn is promoting
-    } else {
-      f1.typeOfMove = 1;
-    }
-    moves.push_back(f1);
+    // typeOfMove 5 means the pawn is promoting
+    moves.push_back(moveType{index, forwardOne, promoting ? 5 : 1});
     // Double move from starting position
-    if ((p.isBlack && row == 1) || (!p.isBlack && row == 6)) {
-      if (!currentBoard[forwardTwo]) {
-        moveType f2{p.index, forwardTwo, 1};
-        moves.push_back(f2);
-      }
+    if (row == S::startRow && !currentBoard[forwardTwo]) {
+      moves.push_back(moveType{index, forwardTwo, 1});
     }
   }
 
   // Captures (normal and en passant)
   for (int dx : {-1, 1}) {
     int newCol = col + dx;
-    if (newCol >= 0 && newCol < 8) {
-      int captureIndex = p.index + ADD_ROW + dx;
-      if (captureIndex >= 0 && captureIndex < 64) {
-        if (currentBoard[captureIndex] &&
-            canTake(captureIndex, p.isBlack, currentBoard)) {
-          moveType capture{};
-          capture.from = p.index;
-          capture.to = captureIndex;
-          if (!p.isBlack && row == 1 || p.isBlack && row == 6) {
-            capture.typeOfMove = 5;
-          } else {
-            capture.typeOfMove = 2;
-          }
-          moves.push_back(capture);
-        }
-        // En passant capture
-        if (enPassantFile == newCol && row == 3 + p.isBlack) {
-          if (enPassantLegalityCheck(p, moves, captureIndex)) {
-            moveType enPassant{p.index, captureIndex, 4};
-            moves.push_back(enPassant);
-          }
-        }
-      }
+    if (newCol < 0 || newCol > 7) {
+      continue;
+    }
+    int captureIndex = forwardOne + dx;
+    int target = currentBoard[captureIndex];
+    if (target && target / 8 != Black) {
+      moves.push_back(moveType{index, captureIndex, promoting ? 5 : 2});
+    }
+    // En passant capture
+    if (row == S::enPassantRow && enPassantFile == newCol &&
+        enPassantLegalityCheck<Black>(index, captureIndex)) {
+      moves.push_back(moveType{index, captureIndex, 4});
     }
   }
 }
 
-bool Board::enPassantLegalityCheck(pieceData p, std::vector<moveType>& moves,
-                                   int newIndex) {
-  int directionToTakenPawn = 8;
-  if (p.isBlack) {
-    directionToTakenPawn = -8;
-  }
-
+template <bool Black>
+bool Board::enPassantLegalityCheck(int from, int newIndex) {
   // simulating the en passant capture
   auto newBoard = board;
-  newBoard[newIndex] = 1 + p.isBlack * 8;
-  newBoard[p.index] = 0;
-  newBoard[newIndex + directionToTakenPawn] = 0;
+  newBoard[newIndex] = 1 + Side<Black>::offset;
+  newBoard[from] = 0;
+  newBoard[newIndex - Side<Black>::forward] = 0;  // the pawn being taken
 
-  std::vector<moveType> newSquares;
   std::vector<moveType> attackingMoves;
 
-  findAttackedSquares(newBoard, attackingMoves, p.isBlack * 8, !p.isBlack * 8);
+  // the king's legal moves are worked out from squaresBeingAttacked, so put
+  // it back once we're done with the simulated board
+  auto attackedBefore = squaresBeingAttacked;
+  findAttackedSquares<!Black>(newBoard, attackingMoves);
 
   bool isLegal = !isInCheck();
+  squaresBeingAttacked = attackedBefore;
 
   return isLegal;
 }
 
-int Board::pseudoLegalKingMoves(pieceData p, std::array<int, 64>& moves,
+template <bool Black>
+int Board::pseudoLegalKingMoves(int index, std::array<int, 64>& moves,
                                 const std::array<int, 64>& currentBoard) {
+  using S = Side<Black>;
   int castleSides = 0;
   for (auto km : sliders) {
-    int x = (p.index % 8) + km.X;
-    int y = (p.index / 8) + km.Y;
+    int x = (index % 8) + km.X;
+    int y = (index / 8) + km.Y;
     if (x < 0 || x > 7 || y < 0 || y > 7) {
       continue;
     }
 
     int i = x + (8 * y);
 
-    if (currentBoard[i] && canTake(i, p.isBlack, currentBoard)) {
-      moves[i] = 2;
-    } else if (!currentBoard[i]) {
+    if (!currentBoard[i]) {
       moves[i] = 1;
+    } else if (currentBoard[i] / 8 != Black) {
+      moves[i] = 2;
     }
   }
-  if (p.isBlack) {
-    if (castleRights[0]) {
-      if (!currentBoard[1] && !currentBoard[2] && !currentBoard[3]) {
-        moves[2] = 3;
-        castleSides += 1;
-      }
-    }
-    if (castleRights[1]) {
-      if (!currentBoard[5] && !currentBoard[6]) {
-        moves[6] = 3;
-        castleSides += 2;
-      }
+  if (castleRights[S::queensideRight]) {
+    if (!currentBoard[S::backRank + 1] && !currentBoard[S::backRank + 2] &&
+        !currentBoard[S::backRank + 3]) {
+      moves[S::backRank + 2] = 3;
+      castleSides += 1;
     }
-  } else {
-    if (castleRights[2]) {
-      if (!currentBoard[57] && !currentBoard[58] && !currentBoard[59]) {
-        moves[58] = 3;
-        castleSides += 1;
-      }
-    }
-    if (castleRights[3]) {
-      if (!currentBoard[61] && !currentBoard[62]) {
-        moves[62] = 3;
-        castleSides += 2;
-      }
+  }
+  if (castleRights[S::kingsideRight]) {
+    if (!currentBoard[S::backRank + 5] && !currentBoard[S::backRank + 6]) {
+      moves[S::backRank + 6] = 3;
+      castleSides += 2;
     }
   }
   return castleSides;
 }
 
+template <bool Black>
 void Board::kingMoves(
     std::vector<moveType>&
         legalKingMoves) {
+  constexpr int backRank = Side<Black>::backRank;
   std::array<int, 64> legalSquares = {};
-  int castleSides = pseudoLegalKingMoves(king, legalSquares, board);
+  int castleSides = pseudoLegalKingMoves<Black>(king.index, legalSquares, board);
   forEachSquare([&](int i) {
     if (legalSquares[i] && squaresBeingAttacked[i]) {
       legalSquares[i] = 0;
@@ -310,17 +402,17 @@ void Board::kingMoves(
   // queenside
   if ((castleSides & 1) &&  // single ampersand is to grab x (this case being 1)
                             // bit and see if its true or not
-      (squaresBeingAttacked[3 + (56 * !king.isBlack)] ||
-       squaresBeingAttacked[2 + (56 * !king.isBlack)] ||
-       squaresBeingAttacked[4 + (56 * !king.isBlack)] || inCheck)) {
-    legalSquares[2 + (56 * !king.isBlack)] = 0;
+      (squaresBeingAttacked[backRank + 3] ||
+       squaresBeingAttacked[backRank + 2] ||
+       squaresBeingAttacked[backRank + 4] || inCheck)) {
+    legalSquares[backRank + 2] = 0;
   }
 
   // king side
   if ((castleSides & 2) &&
-      (squaresBeingAttacked[5 + (56 * !king.isBlack)] ||
-       squaresBeingAttacked[6 + (56 * !king.isBlack)] || inCheck)) {
-    legalSquares[6 + (56 * !king.isBlack)] = 0;
+      (squaresBeingAttacked[backRank + 5] ||
+       squaresBeingAttacked[backRank + 6] || inCheck)) {
+    legalSquares[backRank + 6] = 0;
   }
 
   forEachSquare([&](int i) {
@@ -331,15 +423,17 @@ void Board::kingMoves(
   });
 }
 
+template <bool AttackerBlack>
 void Board::findAttackedSquares(const std::array<int, 64>& chessBoard,
-                                std::vector<moveType>& attackingMoves,
-                                int colour, int oppositeColour) {
+                                std::vector<moveType>& attackingMoves) {
+  PROFILE_SCOPE(ProfileZone::AttackedSquares);
   squaresBeingAttacked = {};
-  forEachSquare([&](int i) {
-    if ((chessBoard[i] / 8) != colour) {
-      attacks(chessBoard, attackingMoves, oppositeColour, i);
+  std::uint64_t occupied = occupancyOf(chessBoard);
+  for (int i = 0; i < 64; ++i) {
+    if (chessBoard[i] && chessBoard[i] / 8 == AttackerBlack) {
+      attacks<AttackerBlack>(chessBoard, occupied, attackingMoves, i);
     }
-  });
+  }
 }
 
 bool Board::isInCheck() {
@@ -405,31 +499,29 @@ void Board::restrictMoves(std::optional<moveType> checkingMove) {
   }
 }
 
+template <bool Black>
 void Board::attacks(const std::array<int, 64>& chessBoard,
-                    std::vector<moveType>& attackingMoves, int colour,
-                    int index) {
-  int type = chessBoard[index] - colour;
+                    std::uint64_t occupied,
+                    std::vector<moveType>& attackingMoves, int index) {
+  int type = chessBoard[index] - Side<Black>::offset;
   if (type == 1) {
-    pawnAttacks(attackingMoves, colour, index);
+    pawnAttacks<Black>(attackingMoves, index);
   } else if (type == 2) {
-    rookAttacks(chessBoard, attackingMoves, index);
+    sliderAttacks(rookAttackBits(index, occupied), attackingMoves, index);
   } else if (type == 3) {
     knightAttacks(attackingMoves, index);
   } else if (type == 4) {
-    bishopAttacks(chessBoard, attackingMoves, index);
+    sliderAttacks(bishopAttackBits(index, occupied), attackingMoves, index);
   } else if (type == 5) {
-    queenAttacks(chessBoard, attackingMoves, index);
+    sliderAttacks(queenAttackBits(index, occupied), attackingMoves, index);
   } else if (type == 6) {
     kingAttacks(attackingMoves, index);
   }
 }
 
-void Board::pawnAttacks(std::vector<moveType>& attackingMoves, int colour,
-                        int index) {
-  int row = -8;
-  if (colour) {
-    row = 8;
-  }
+template <bool Black>
+void Board::pawnAttacks(std::vector<moveType>& attackingMoves, int index) {
+  constexpr int row = Side<Black>::forward;
   if (index % 8 != 0) {
     squaresBeingAttacked[index - 1 + row] = 1;
     moveType pawnAttack{index, index - 1 + row, 1};
@@ -455,90 +547,13 @@ void Board::knightAttacks(std::vector<moveType>& attackingMoves, int index) {
   }
 }
 
-void Board::bishopAttacks(const std::array<int, 64>& chessBoard,
+void Board::sliderAttacks(std::uint64_t attacked,
                           std::vector<moveType>& attackingMoves, int index) {
-  std::array directions = {1, 3, 5, 7};
-  for (auto dir : directions) {
-    int x = index % 8;
-    int y = index / 8;
-
-    while (true) {
-      x += sliders[dir].X;
-      y += sliders[dir].Y;
-
-      if (x < 0 || x > 7 || y < 0 || y > 7) {
-        break;
-      }
-      int i = x + (8 * y);
-
-      if (chessBoard[i]) {
-        squaresBeingAttacked[i] = 1;
-        moveType take{index, i, 1};
-        attackingMoves.push_back(take);
-        break;
-      }
-      squaresBeingAttacked[i] = 1;
-      moveType slide{index, i, 1};
-      attackingMoves.push_back(slide);
-    }
-  }
-}
-
-void Board::rookAttacks(const std::array<int, 64>& chessBoard,
-                        std::vector<moveType>& attackingMoves, int index) {
-  std::array directions = {0, 2, 4, 6};
-  for (auto dir : directions) {
-    int x = index % 8;
-    int y = index / 8;
-
-    while (true) {
-      x += sliders[dir].X;
-      y += sliders[dir].Y;
-
-      if (x < 0 || x > 7 || y < 0 || y > 7) {
-        break;
-      }
-      int i = x + (8 * y);
-
-      if (chessBoard[i]) {
-        squaresBeingAttacked[i] = 1;
-        moveType take{index, i, 1};
-        attackingMoves.push_back(take);
-        break;
-      }
-      squaresBeingAttacked[i] = 1;
-      moveType slide{index, i, 1};
-      attackingMoves.push_back(slide);
-    }
-  }
-}
-
-void Board::queenAttacks(const std::array<int, 64>& chessBoard,
-                         std::vector<moveType>& attackingMoves, int index) {
-  std::array directions = {0, 1, 2, 3, 4, 5, 6, 7};
-  for (auto dir : directions) {
-    int x = index % 8;
-    int y = index / 8;
-
-    while (true) {
-      x += sliders[dir].X;
-      y += sliders[dir].Y;
-
-      if (x < 0 || x > 7 || y < 0 || y > 7) {
-        break;
-      }
-      int i = x + (8 * y);
-
-      if (chessBoard[i]) {
-        squaresBeingAttacked[i] = 1;
-        moveType take{index, i, 1};
-        attackingMoves.push_back(take);
-        break;
-      }
-      squaresBeingAttacked[i] = 1;
-      moveType slide{index, i, 1};
-      attackingMoves.push_back(slide);
-    }
+  for (; attacked; attacked &= attacked - 1) {
+    int i = lowestBit(attacked);
+    squaresBeingAttacked[i] = 1;
+    moveType attack{index, i, 1};
+    attackingMoves.push_back(attack);
   }
 }
 
@@ -591,6 +606,174 @@ Board::Board() : board(), castleRights(), enPassantSquares() {
   for (bool& castleRight : castleRights) {
     castleRight = true;
   }
+
+  setupTurn();
+}
+
+void Board::makeMove(const moveType& move) {
+  int id = board[move.from];
+  bool isBlack = id / 8;
+  int row = move.to / 8;
+
+  if (id % 8 == 1 || board[move.to]) {
+    halfmoveClock = 0;
+    keyHistory.clear();
+  } else {
+    halfmoveClock++;
+    keyHistory.push_back(positionKey);
+  }
+  if (isBlack) {
+    fullmoveNumber++;
+  }
+
+  if (move.typeOfMove == 3) {  // castling, move the rook over the king first
+    if (move.to % 8 > 4) {
+      updateBoard(row * 8 + 7, row * 8 + 5);
+    } else {
+      updateBoard(row * 8 + 0, row * 8 + 3);
+    }
+  } else if (move.typeOfMove == 4) {
+    takePiece(move.to + (isBlack ? -8 : 8));
+  }
+
+  if (move.typeOfMove == 5) {
+    int newType = move.promotion ? move.promotion : 5;
+    promotePawn(move.to, newType + isBlack * 8, move.from);
+  } else {
+    updateBoard(move.from, move.to);
+  }
+
+  if (id % 8 == 1 && abs(move.to - move.from) == 16) {
+    setEnPassantFile(move.to % 8);
+  } else {
+    resetEnPassant();
+  }
+
+  blackToMove = !isBlack;
+  setupTurn();
+  countRepetitions();
+}
+
+void Board::makeNullMove() {
+  // nothing before a pass can repeat with what comes after it, the other
+  // side would have had to pass too
+  halfmoveClock++;
+  keyHistory.clear();
+  if (blackToMove) {
+    fullmoveNumber++;
+  }
+  resetEnPassant();
+  blackToMove = !blackToMove;
+  setupTurn();
+  repetitions = 0;
+}
+
+void Board::countRepetitions() {
+  // positions with the same side to move are every second one back, scanned
+  // once here so the search can check for a draw without a loop
+  repetitions = 0;
+  for (int i = static_cast<int>(keyHistory.size()) - 2; i >= 0; i -= 2) {
+    if (keyHistory[i] == positionKey) {
+      repetitions++;
+    }
+  }
+}
+
+void Board::setupTurn() {
+  canCastle();
+  computePositionKey();
+  findKing();
+  findCheckingMoves();
+  findPinsToKing(!getTurn());
+  generateAllMoves();
+}
+
+bool Board::loadFen(const std::string& fen) {
+  std::istringstream fields(fen);
+  std::string placement, side, castling = "-", enPassant = "-";
+  int halfmoves = 0, fullmoves = 1;
+  if (!(fields >> placement >> side)) {
+    return false;
+  }
+  fields >> castling >> enPassant >> halfmoves >> fullmoves;
+
+  std::array<int, 64> newBoard = {};
+  const std::string pieceLetters = " prnbqk";  // index is the piece type
+  int square = 0;
+  for (char c : placement) {
+    if (c == '/') {
+      continue;
+    }
+    if (c >= '1' && c <= '8') {
+      square += c - '0';
+      continue;
+    }
+    auto type = pieceLetters.find(static_cast<char>(std::tolower(c)));
+    if (type == std::string::npos || type == 0 || square >= 64) {
+      return false;
+    }
+    newBoard[square++] = static_cast<int>(type) + (std::islower(c) ? 8 : 0);
+  }
+  if (square != 64 || (side != "w" && side != "b")) {
+    return false;
+  }
+
+  board = newBoard;
+  castleRights[0] = castling.find('q') != std::string::npos;
+  castleRights[1] = castling.find('k') != std::string::npos;
+  castleRights[2] = castling.find('Q') != std::string::npos;
+  castleRights[3] = castling.find('K') != std::string::npos;
+  enPassantFile = enPassant.size() == 2 ? enPassant[0] - 'a' : -1;
+  blackToMove = side == "b";
+  halfmoveClock = halfmoves;
+  fullmoveNumber = fullmoves;
+  keyHistory.clear();
+  repetitions = 0;
+  setupTurn();
+  return true;
+}
+
+std::string Board::toFen() const {
+  const std::string pieceLetters = " PRNBQK";
+  std::string fen;
+  for (int row = 0; row < 8; ++row) {
+    int empty = 0;
+    for (int col = 0; col < 8; ++col) {
+      int id = board[row * 8 + col];
+      if (!id) {
+        empty++;
+        continue;
+      }
+      if (empty) {
+        fen += static_cast<char>('0' + empty);
+        empty = 0;
+      }
+      char letter = pieceLetters[id % 8];
+      fen += id / 8 ? static_cast<char>(std::tolower(letter)) : letter;
+    }
+    if (empty) {
+      fen += static_cast<char>('0' + empty);
+    }
+    if (row != 7) {
+      fen += '/';
+    }
+  }
+  fen += getTurn() ? " w " : " b ";
+  std::string castling;
+  if (castleRights[3]) castling += 'K';
+  if (castleRights[2]) castling += 'Q';
+  if (castleRights[1]) castling += 'k';
+  if (castleRights[0]) castling += 'q';
+  fen += castling.empty() ? "-" : castling;
+  if (enPassantFile == -1) {
+    fen += " -";
+  } else {
+    fen += ' ';
+    fen += squareName(enPassantFile + (getTurn() ? 16 : 40));
+  }
+  fen += " " + std::to_string(halfmoveClock) + " " +
+         std::to_string(fullmoveNumber);
+  return fen;
 }
 
 void Board::takePiece(int index) { board[index] = 0; }
@@ -598,30 +781,37 @@ void Board::takePiece(int index) { board[index] = 0; }
 void Board::promotePawn(int index, int newId, int prevIndex) {
   board[prevIndex] = 0;
   board[index] = newId;
-  lastPieceMoved = newId;
 }
 
 int Board::getPiece(int index) const { return board[index]; }
 
 std::vector<moveType> Board::legalMoves(int index, int id,
                                         const std::array<int, 64>& currentBoard) {
+  std::uint64_t occupied = occupancyOf(currentBoard);
+  if (id / 8) {
+    return legalMovesFor<true>(index, id % 8, currentBoard, occupied);
+  }
+  return legalMovesFor<false>(index, id % 8, currentBoard, occupied);
+}
+
+template <bool Black>
+std::vector<moveType> Board::legalMovesFor(
+    int index, int type, const std::array<int, 64>& currentBoard,
+    std::uint64_t occupied) {
   std::vector<moveType> moves;
-  pieceData p{};
-  p.isBlack = id / 8;
-  p.type = id % 8;
-  p.index = index;
+  pieceData p{Black, type, index};
 
   if (p.type == 5 || p.type == 2 || p.type == 4) {
-    slidingMoves(p, moves, currentBoard);
+    slidingMoves(p, moves, currentBoard, occupied);
   }
   if (p.type == 3) {
     knightMoves(p, moves, currentBoard);
   }
   if (p.type == 1) {
-    pawnMoves(p, moves, currentBoard);
+    pawnMoves<Black>(index, moves, currentBoard);
   }
   if (p.type == 6) {
-    kingMoves(moves);
+    kingMoves<Black>(moves);
   }
 
   isPinned(p, moves);
@@ -636,22 +826,28 @@ std::vector<moveType> Board::legalMoves(int index, int id,
 }
 
 void Board::generateAllMoves() {
-  bool turn = getTurn();
+  PROFILE_SCOPE(ProfileZone::MoveGeneration);
+  if (blackToMove) {
+    generateMoves<true>();
+  } else {
+    generateMoves<false>();
+  }
+}
 
+template <bool Black>
+void Board::generateMoves() {
   allLegalMoves.clear();
-  for (int piece : piecesOf(turn)) {
+  std::uint64_t occupied = occupancyOf(board);
+  for (int piece = 0; piece < 64; ++piece) {
+    int id = board[piece];
+    if (!id || id / 8 != Black) {
+      continue;
+    }
     pieceMoves currentPiece;
     currentPiece.index = piece;
-    currentPiece.moves = legalMoves(piece, board[piece], board);
+    currentPiece.moves = legalMovesFor<Black>(piece, id % 8, board, occupied);
     if (!currentPiece.moves.empty()) {
-      allLegalMoves.push_back(currentPiece);
-    }
-  }
-  if (allLegalMoves.empty()) {
-    if (inCheck) {
-      std::cout << std::endl << "Checkmate!" << std::endl;
-    } else {
-      std::cout << std::endl << "Stalemate!" << std::endl;
+      allLegalMoves.push_back(std::move(currentPiece));
     }
   }
 }
@@ -667,6 +863,7 @@ std::vector<moveType> Board::checkMove(int index) {
 }
 
 void Board::findPinsToKing(int turn) {
+  PROFILE_SCOPE(ProfileZone::PinDetection);
   pins.clear();
 
   int kingIndex = -1;
@@ -742,7 +939,6 @@ void Board::updateBoard(int prevIndex, int newIndex) {
   int temp = board[prevIndex];
   board[prevIndex] = 0;
   board[newIndex] = temp;
-  lastPieceMoved = board[newIndex];
 }
 
 void Board::canCastle() {
@@ -759,9 +955,6 @@ void Board::canCastle() {
 void Board::resetEnPassant() { enPassantFile = -1; }
 
 void Board::findCheckingMoves() {
-  bool turn = getTurn();
-  int colour = !turn * 8;
-  int oppositeColour = turn * 8;
   bool multipleAttackers = false;
   blockingSquares.clear();
   onlyKingToMove = false;
@@ -770,7 +963,11 @@ void Board::findCheckingMoves() {
   attackingMoves.reserve(64);
   std::array<int, 64> boardWithoutKing = board;
   boardWithoutKing[king.index] = 0;
-  findAttackedSquares(boardWithoutKing, attackingMoves, colour, oppositeColour);
+  if (blackToMove) {
+    findAttackedSquares<false>(boardWithoutKing, attackingMoves);
+  } else {
+    findAttackedSquares<true>(boardWithoutKing, attackingMoves);
+  }
 
   inCheck = isInCheck();
   if (inCheck) {
@@ -795,16 +992,397 @@ void Board::findKing() {
   });
 }
 
+void Board::computePositionKey() {
+  positionKey = 0;
+  forEachSquare([&](int i) {
+    if (board[i]) {
+      positionKey ^= zobrist.pieces[board[i]][i];
+    }
+  });
+  for (int i = 0; i < 4; ++i) {
+    if (castleRights[i]) {
+      positionKey ^= zobrist.castling[i];
+    }
+  }
+  if (enPassantFile != -1) {
+    // only counts if a pawn could actually take, otherwise the position
+    // wouldn't repeat with the one we get after any other move
+    int pawn = getTurn() ? 1 : 9;
+    int row = getTurn() ? 3 : 4;
+    if ((enPassantFile > 0 && board[row * 8 + enPassantFile - 1] == pawn) ||
+        (enPassantFile < 7 && board[row * 8 + enPassantFile + 1] == pawn)) {
+      positionKey ^= zobrist.enPassant[enPassantFile];
+    }
+  }
+  if (!getTurn()) {
+    positionKey ^= zobrist.blackToMove;
+  }
+}
+
+positionSnapshot Board::snapshot() const {
+  positionSnapshot snapshot;
+  for (int i = 0; i < 64; ++i) {
+    snapshot.squares[i] = static_cast<std::int8_t>(board[i]);
+  }
+  snapshot.positionKey = positionKey;
+  snapshot.halfmoveClock = static_cast<std::uint16_t>(halfmoveClock);
+  snapshot.fullmoveNumber = static_cast<std::uint16_t>(fullmoveNumber);
+  snapshot.enPassantFile = static_cast<std::int8_t>(enPassantFile);
+  snapshot.castleRights = 0;
+  for (int i = 0; i < 4; ++i) {
+    snapshot.castleRights |= castleRights[i] << i;
+  }
+  snapshot.blackToMove = blackToMove;
+  snapshot.repetitions = static_cast<std::uint8_t>(repetitions);
+  return snapshot;
+}
+
+void Board::restore(const positionSnapshot& snapshot,
+                    const std::vector<std::uint64_t>& earlierKeys) {
+  for (int i = 0; i < 64; ++i) {
+    board[i] = snapshot.squares[i];
+  }
+  for (int i = 0; i < 4; ++i) {
+    castleRights[i] = snapshot.castleRights >> i & 1;
+  }
+  enPassantFile = snapshot.enPassantFile;
+  blackToMove = snapshot.blackToMove;
+  halfmoveClock = snapshot.halfmoveClock;
+  fullmoveNumber = snapshot.fullmoveNumber;
+  // only positions since the last capture or pawn move can come back
+  std::size_t kept = std::min<std::size_t>(halfmoveClock, earlierKeys.size());
+  keyHistory.assign(earlierKeys.end() - kept, earlierKeys.end());
+  setupTurn();
+  if (kept) {
+    countRepetitions();
+  } else {
+    repetitions = snapshot.repetitions;
+  }
+}
+
+std::uint64_t Board::getPositionKey() const { return positionKey; }
+
+int Board::getRepetitions() const { return repetitions; }
+
+bool Board::hasUpcomingRepetition(int ply) const {
+  int end = std::min(halfmoveClock, static_cast<int>(keyHistory.size()));
+  for (int i = 3; i <= end; i += 2) {  // i plies back, only the other side
+                                       // to move can differ by one move
+    std::uint64_t moveKey =
+        positionKey ^ keyHistory[keyHistory.size() - i];
+    int slot = cuckooFirstSlot(moveKey);
+    if (cuckoo.keys[slot] != moveKey) {
+      slot = cuckooSecondSlot(moveKey);
+      if (cuckoo.keys[slot] != moveKey) {
+        continue;
+      }
+    }
+    int from = cuckoo.from[slot];
+    int to = cuckoo.to[slot];
+    if (!pathIsClear(board, from, to)) {
+      continue;
+    }
+    if (ply > i) {
+      return true;  // the cycle is inside the search, either side can go
+                    // for it
+    }
+    int piece = board[from] ? board[from] : board[to];
+    if (piece / 8 == !getTurn()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Board::isBlackToMove() const { return blackToMove; }
+
+bool Board::kingInCheck() const { return inCheck; }
+
+int Board::getHalfmoveClock() const { return halfmoveClock; }
+
+int Board::getFullmoveNumber() const { return fullmoveNumber; }
+
+bool Board::canCastleSide(int right) const { return castleRights[right]; }
+
+int Board::getEnPassantFile() const { return enPassantFile; }
+
+bool Board::isInsufficientMaterial() const {
+  int minorPieces = 0;
+  for (int id : board) {
+    int type = id % 8;
+    if (type == 1 || type == 2 || type == 5) {
+      return false;  // pawns, rooks and queens can always mate
+    }
+    if (type == 3 || type == 4) {
+      minorPieces++;
+    }
+  }
+  return minorPieces <= 1;  // bare kings, or king and one minor piece
+}
+
+GameStatus Board::getStatus() const {
+  if (allLegalMoves.empty()) {
+    return inCheck ? GameStatus::Checkmate : GameStatus::Stalemate;
+  }
+  if (halfmoveClock >= 100) {
+    return GameStatus::FiftyMoves;
+  }
+  if (repetitions >= 2) {
+    return GameStatus::Repetition;
+  }
+  if (isInsufficientMaterial()) {
+    return GameStatus::InsufficientMaterial;
+  }
+  return GameStatus::Ongoing;
+}
+
+const std::vector<pieceMoves>& Board::getAllLegalMoves() const {
+  return allLegalMoves;
+}
+
+std::vector<moveType> Board::getMoveList() const {
+  std::vector<moveType> list;
+  for (const pieceMoves& piece : allLegalMoves) {
+    for (moveType move : piece.moves) {
+      if (move.typeOfMove == 5) {
+        for (int newType : {5, 2, 3, 4}) {  // queen, rook, knight, bishop
+          move.promotion = newType;
+          list.push_back(move);
+        }
+      } else {
+        list.push_back(move);
+      }
+    }
+  }
+  return list;
+}
+
+int Board::moveKind(int from, int to) const {
+  if (from < 0 || from > 63 || to < 0 || to > 63 || from == to) {
+    return 0;
+  }
+  int id = board[from];
+  int target = board[to];
+  if (!id || id / 8 != blackToMove || (target && target / 8 == blackToMove)) {
+    return 0;
+  }
+  int rowStep = to / 8 - from / 8;
+  int colStep = to % 8 - from % 8;
+  int capture = target ? 2 : 1;
+
+  switch (id % 8) {
+    case 1: {
+      int forward = blackToMove ? Side<true>::forward : Side<false>::forward;
+      int row = from / 8;
+      bool promoting = row == (blackToMove ? Side<true>::promotionRow
+                                           : Side<false>::promotionRow);
+      if (to == from + forward && !target) {
+        return promoting ? 5 : 1;
+      }
+      if (to == from + 2 * forward && !target && !board[from + forward] &&
+          row == (blackToMove ? Side<true>::startRow : Side<false>::startRow)) {
+        return 1;
+      }
+      if (rowStep != forward / 8 || (colStep != 1 && colStep != -1)) {
+        return 0;
+      }
+      if (target) {
+        return promoting ? 5 : 2;
+      }
+      bool enPassantRow = row == (blackToMove ? Side<true>::enPassantRow
+                                              : Side<false>::enPassantRow);
+      return enPassantRow && enPassantFile == to % 8 ? 4 : 0;
+    }
+    case 3:
+      return (std::abs(rowStep) == 1 && std::abs(colStep) == 2) ||
+                     (std::abs(rowStep) == 2 && std::abs(colStep) == 1)
+                 ? capture
+                 : 0;
+    case 6: {
+      if (std::abs(rowStep) <= 1 && std::abs(colStep) <= 1) {
+        return capture;
+      }
+      int backRank = blackToMove ? Side<true>::backRank : Side<false>::backRank;
+      if (from != backRank + 4 || target) {
+        return 0;
+      }
+      if (to == backRank + 2 &&
+          castleRights[blackToMove ? Side<true>::queensideRight
+                                   : Side<false>::queensideRight] &&
+          !board[backRank + 1] && !board[backRank + 3]) {
+        return 3;
+      }
+      if (to == backRank + 6 &&
+          castleRights[blackToMove ? Side<true>::kingsideRight
+                                   : Side<false>::kingsideRight] &&
+          !board[backRank + 5]) {
+        return 3;
+      }
+      return 0;
+    }
+    default: {  // sliders
+      bool straight = rowStep == 0 || colStep == 0;
+      bool diagonal = std::abs(rowStep) == std::abs(colStep);
+      int type = id % 8;
+      if ((straight && type == 4) || (diagonal && type == 2) ||
+          (!straight && !diagonal)) {
+        return 0;
+      }
+      int step = (rowStep > 0) - (rowStep < 0);
+      step = step * 8 + (colStep > 0) - (colStep < 0);
+      for (int i = from + step; i != to; i += step) {
+        if (board[i]) {
+          return 0;
+        }
+      }
+      return capture;
+    }
+  }
+}
+
+bool Board::isPseudoLegal(const moveType& move) const {
+  int kind = moveKind(move.from, move.to);
+  if (!kind || kind != move.typeOfMove) {
+    return false;
+  }
+  return kind == 5 ? move.promotion == 0 ||
+                         (move.promotion >= 2 && move.promotion <= 5)
+                   : move.promotion == 0;
+}
+
+bool Board::isLegal(const moveType& move) const {
+  if (!isPseudoLegal(move)) {
+    return false;
+  }
+  if (board[move.from] % 8 == 6) {
+    // squaresBeingAttacked was worked out without our king on the board, so
+    // stepping back along a checking line shows up as attacked too
+    if (move.typeOfMove == 3) {
+      int step = move.to > move.from ? 1 : -1;
+      return !inCheck && !squaresBeingAttacked[move.from + step] &&
+             !squaresBeingAttacked[move.to];
+    }
+    return !squaresBeingAttacked[move.to];
+  }
+  if (onlyKingToMove) {
+    return false;  // double check
+  }
+  int forward = blackToMove ? Side<true>::forward : Side<false>::forward;
+  if (inCheck && !blockingSquares.count(move.to) &&
+      !(move.typeOfMove == 4 && blockingSquares.count(move.to - forward))) {
+    return false;  // doesn't block or take the checker
+  }
+  for (const pinInfo& pin : pins) {
+    if (pin.pinIndex == move.from && !pin.pathToKing.count(move.to)) {
+      return false;
+    }
+  }
+  if (move.typeOfMove == 4) {
+    // taking en passant moves two pawns off one rank, which the pins above
+    // can't see
+    std::array<int, 64> after = board;
+    after[move.to] = after[move.from];
+    after[move.from] = 0;
+    after[move.to - forward] = 0;
+    return !slidingAttackOnKing(after);
+  }
+  return true;
+}
+
+bool Board::slidingAttackOnKing(const std::array<int, 64>& squares) const {
+  for (int dir = 0; dir < 8; ++dir) {
+    int x = king.index % 8;
+    int y = king.index / 8;
+    while (true) {
+      x += sliders[dir].X;
+      y += sliders[dir].Y;
+      if (x < 0 || x > 7 || y < 0 || y > 7) {
+        break;
+      }
+      int id = squares[x + 8 * y];
+      if (!id) {
+        continue;
+      }
+      int type = id % 8;
+      // even directions are straight lines, odd ones diagonals
+      if (id / 8 != blackToMove &&
+          (type == 5 || type == (dir % 2 ? 4 : 2))) {
+        return true;
+      }
+      break;
+    }
+  }
+  return false;
+}
+
 void Board::deleteNonBlockingMoves(std::vector<moveType>& moves) {
   auto tempMoves = moves;
   moves.clear();
   for (const auto& move : tempMoves) {
     if (blockingSquares.find(move.to) != blockingSquares.end()) {
       moves.push_back(move);
+    } else if (move.typeOfMove == 4) {
+      // en passant can get out of check by taking the pawn that just gave it
+      int takenPawn = move.to + (move.from < move.to ? -8 : 8);
+      if (blockingSquares.find(takenPawn) != blockingSquares.end()) {
+        moves.push_back(move);
+      }
     }
   }
 }
 
+std::string statusText(GameStatus status) {
+  switch (status) {
+    case GameStatus::Ongoing:
+      return "ongoing";
+    case GameStatus::Checkmate:
+      return "checkmate";
+    case GameStatus::Stalemate:
+      return "stalemate";
+    case GameStatus::InsufficientMaterial:
+      return "insufficient material";
+    case GameStatus::FiftyMoves:
+      return "fifty moves";
+    case GameStatus::Repetition:
+      return "threefold repetition";
+  }
+  return "";
+}
+
+std::string squareName(int index) {
+  std::string name;
+  name += static_cast<char>('a' + index % 8);
+  name += static_cast<char>('8' - index / 8);
+  return name;
+}
+
+std::string moveToText(const moveType& move) {
+  std::string text = squareName(move.from) + squareName(move.to);
+  if (move.typeOfMove == 5) {
+    text += " rnbq"[move.promotion ? move.promotion - 1 : 4];
+  }
+  return text;
+}
+
+moveType moveFromText(const std::string& text) {
+  moveType move{-1, -1, 0};
+  if (text.size() < 4 || text.size() > 5 || text[0] < 'a' || text[0] > 'h' ||
+      text[1] < '1' || text[1] > '8' || text[2] < 'a' || text[2] > 'h' ||
+      text[3] < '1' || text[3] > '8') {
+    return move;
+  }
+  if (text.size() == 5) {
+    std::size_t piece = std::string("rnbq").find(text[4]);
+    if (piece == std::string::npos) {
+      return move;
+    }
+    move.promotion = static_cast<int>(piece) + 2;  // rook is type 2
+  }
+  move.from = (text[0] - 'a') + 8 * ('8' - text[1]);
+  move.to = (text[2] - 'a') + 8 * ('8' - text[3]);
+  return move;
+}
+
 void Board::printBoard() {
   forEachSquare([&](int i) {
     std::cout << board[i] << " ";
@@ -813,3 +1391,11 @@ void Board::printBoard() {
     }
   });
 }
+
+// tools/bench.cpp times these on their own
+template void Board::findAttackedSquares<false>(const std::array<int, 64>&,
+                                                std::vector<moveType>&);
+template void Board::findAttackedSquares<true>(const std::array<int, 64>&,
+                                               std::vector<moveType>&);
+template bool Board::enPassantLegalityCheck<false>(int, int);
+template bool Board::enPassantLegalityCheck<true>(int, int);
@@ -4,8 +4,11 @@
 #define BOARD_H
 
 #include <array>
+#include <cstdint>
 #include <functional>
 #include <optional>
+#include <string>
+#include <type_traits>
 #include <unordered_set>
 #include <vector>
 
@@ -21,11 +24,37 @@ struct moveType {
   int from;
   int to;
   int typeOfMove;
+  int promotion = 0;  // piece type a pawn turns into when typeOfMove is 5,
+                      // 0 means it hasn't been picked yet (queen by default)
 };
 struct pieceMoves {
   int index;
   std::vector<moveType> moves;
 };
+enum class GameStatus {
+  Ongoing,
+  Checkmate,
+  Stalemate,
+  InsufficientMaterial,
+  FiftyMoves,
+  Repetition  // threefold
+};
+struct positionSnapshot {  // everything that makes a position, small enough to
+                           // keep one per ply. the moves, pins and checks
+                           // Board works out are rebuilt from it by restore
+  std::array<std::int8_t, 64> squares;  // piece ids, same layout as the board
+  std::uint64_t positionKey;
+  std::uint16_t halfmoveClock;
+  std::uint16_t fullmoveNumber;
+  std::int8_t enPassantFile;
+  std::uint8_t castleRights;  // bit i set for castleRights[i]
+  bool blackToMove;
+  std::uint8_t repetitions;
+};
+static_assert(sizeof(positionSnapshot) <= 128,
+              "positionSnapshot should stay under two cache lines");
+static_assert(std::is_trivially_copyable<positionSnapshot>::value,
+              "positionSnapshot has to be copyable with memcpy");
 struct pinInfo {
   int pinIndex;
   std::unordered_set<int> pathToKing;  // vector of indices which track the path
@@ -33,6 +62,9 @@ struct pinInfo {
 };
 
 class Board {
+  friend struct BoardBenchAccess;  // tools/bench.cpp times the private hot
+                                   // paths directly
+
  private:
   std::array<int, 64> board;
   std::array<bool, 4>
@@ -44,7 +76,14 @@ class Board {
                          // is the one that is switched to true, as this matches
                          // FEN notation.
   int enPassantFile = -1;
-  int lastPieceMoved = 0;
+  bool blackToMove = false;
+  std::uint64_t positionKey = 0;  // zobrist hash, recomputed every turn
+  int halfmoveClock = 0;  // plies since the last capture or pawn move
+  std::vector<std::uint64_t>
+      keyHistory;  // keys of the positions before this one, back to the last
+                   // capture or pawn move (nothing earlier can repeat)
+  int repetitions = 0;  // times this position has already been on the board
+  int fullmoveNumber = 1;
   bool onlyKingToMove = false;
   bool inCheck = false;
   pieceData king{false, 6, 60};
@@ -62,58 +101,87 @@ class Board {
       action(i);
     }
   }
-  std::vector<int> piecesOf(int turn);
-  bool getTurn();
+  bool getTurn() const;  // true when it's white to move
   bool onSameLine(int from, int to, int direction);
   void newPin(int pinnedPiece, int kingIndex, int attackerIndex, int direction);
 
-  // other private functions:
+  // other private functions. the ones templated on Black are built once for
+  // each colour, so push directions, promotion rows and castle squares are
+  // constants in them (see Side in Board.cpp). the colour is picked once per
+  // turn in generateAllMoves and findCheckingMoves
   void kingLegalMoves();
+  void countRepetitions();
+  template <bool Black>
+  void generateMoves();
+  template <bool Black>
+  std::vector<moveType> legalMovesFor(int index, int type,
+                                      const std::array<int, 64>& currentBoard,
+                                      std::uint64_t occupied);
   void slidingMoves(pieceData p, std::vector<moveType>& moves,
-                    const std::array<int, 64>& currentBoard);
+                    const std::array<int, 64>& currentBoard,
+                    std::uint64_t occupied);  // occupied squares of
+                                              // currentBoard as bits
   void knightMoves(pieceData p, std::vector<moveType>& moves,
                    const std::array<int, 64>& currentBoard);
-  void pawnMoves(pieceData p, std::vector<moveType>& moves,
+  template <bool Black>
+  void pawnMoves(int index, std::vector<moveType>& moves,
                  const std::array<int, 64>& currentBoard);
+  template <bool Black>
   bool enPassantLegalityCheck(
-      pieceData p, std::vector<moveType>& moves,
-      int newIndex);  // handles the special case where taking an en passant
-                      // would be an illegal move, due to a rook/queen lasering
-                      // through the two pawns to the king
+      int from, int newIndex);  // handles the special case where taking an en
+                                // passant would be an illegal move, due to a
+                                // rook/queen lasering through the two pawns to
+                                // the king
+  template <bool Black>
   int pseudoLegalKingMoves(
-      pieceData p, std::array<int, 64>& moves,
+      int index, std::array<int, 64>& moves,
       const std::array<int, 64>&
           currentBoard);  // outputs the 8 moves around king, and castling moves
                           // if legal. doesn't check if move is legal.
+  template <bool Black>
   void kingMoves(std::vector<moveType>&
                      legalKingMoves);  // checks if each king move would put the
                                        // king in check (and castle stuff), if
                                        // so then its filtered out
-  void findAttackedSquares(const std::array<int, 64>& chessBoard,
-                           std::vector<moveType>& attackingMoves, int colour,
-                           int oppositeColour);
+  template <bool AttackerBlack>
+  void findAttackedSquares(
+      const std::array<int, 64>& chessBoard,
+      std::vector<moveType>& attackingMoves);  // every square the pieces of
+                                               // one colour attack
   bool isInCheck();
   void findAttackersOnKing(const std::vector<moveType>& attackingMoves,
                            bool& multipleAttackers,
                            std::optional<moveType>& checkingMove);
   void restrictMoves(std::optional<moveType> checkingMove);
+  bool slidingAttackOnKing(
+      const std::array<int, 64>& squares) const;  // a rook, bishop or queen
+                                                  // of the other side sees
+                                                  // our king on this board
 
   // attacks, these functions are different from the moves functions cause
-  void attacks(const std::array<int, 64>& chessBoard,
-               std::vector<moveType>& attackingMoves, int colour, int index);
-  void pawnAttacks(std::vector<moveType>& attackingMoves, int colour,
-                   int index);
+  template <bool Black>
+  void attacks(const std::array<int, 64>& chessBoard, std::uint64_t occupied,
+               std::vector<moveType>& attackingMoves, int index);
+  template <bool Black>
+  void pawnAttacks(std::vector<moveType>& attackingMoves, int index);
   void knightAttacks(std::vector<moveType>& attackingMoves, int index);
-  void bishopAttacks(const std::array<int, 64>& chessBoard,
-                     std::vector<moveType>& attackingMoves, int index);
-  void rookAttacks(const std::array<int, 64>& chessBoard,
-                   std::vector<moveType>& attackingMoves, int index);
-  void queenAttacks(const std::array<int, 64>& chessBoard,
-                    std::vector<moveType>& attackingMoves, int index);
+  void sliderAttacks(std::uint64_t attacked,
+                     std::vector<moveType>& attackingMoves,
+                     int index);  // attacked comes from SlidingAttacks.h
   void kingAttacks(std::vector<moveType>& attackingMoves, int index);
 
  public:
   Board();  // constructor which sets the board to starting position
+  bool loadFen(const std::string& fen);  // returns false (and leaves the
+                                         // board alone) if it can't parse it
+  std::string toFen() const;
+  void makeMove(const moveType& move);  // plays a legal move (castling, en
+                                        // passant and promotion included)
+                                        // and sets up the next turn
+  void makeNullMove();  // passes the turn, for null move pruning in the
+                       // search. never call it in check
+  void setupTurn();  // finds checks and pins for the side to move and
+                     // generates its legal moves
   void takePiece(int index);  // used only for en passant moves
   void promotePawn(int index, int newId, int prevIndex);
   int getPiece(int index) const;
@@ -133,9 +201,55 @@ class Board {
   void findCheckingMoves();
   void deleteNonBlockingMoves(std::vector<moveType>& moves);
   void findKing();
+  void computePositionKey();
+  positionSnapshot snapshot() const;
+  void restore(const positionSnapshot& snapshot,
+               const std::vector<std::uint64_t>& earlierKeys =
+                   {});  // earlierKeys are the positions played before this
+                         // one, oldest first, so repetitions still count
+  std::uint64_t getPositionKey() const;
+  int getRepetitions() const;
+  bool hasUpcomingRepetition(
+      int ply) const;  // true if the side to move has a reversible move that
+                       // goes back to an earlier position. ply is the search
+                       // depth from the root, positions from before the root
+                       // only count if the move is ours to make
+  bool isBlackToMove() const;
+  bool kingInCheck() const;
+  int getHalfmoveClock() const;
+  int getFullmoveNumber() const;
+  bool canCastleSide(int right) const;  // indexed like castleRights
+  int getEnPassantFile() const;         // -1 if the last move wasn't a double
+                                        // pawn push
+  bool isInsufficientMaterial() const;  // neither side can ever mate
+  GameStatus getStatus() const;
+  const std::vector<pieceMoves>& getAllLegalMoves() const;
+  std::vector<moveType> getMoveList()
+      const;  // all legal moves as a flat list, with a separate entry for
+              // each promotion piece
+  int moveKind(int from, int to)
+      const;  // the typeOfMove the generator would give a move from -> to
+              // by the side to move, 0 if its piece can't go there at all.
+              // checks and pins aren't looked at
+  bool isPseudoLegal(
+      const moveType& move) const;  // right piece, right shape, nothing in
+                                    // the way and typeOfMove matches. cheap
+                                    // enough for hash and killer moves
+  bool isLegal(const moveType& move)
+      const;  // same answer as finding it in getMoveList, but worked out
+              // straight from the checks, pins and attacked squares
+              // setupTurn found
 
   // debugging functions:
   void printBoard();
 };
 
+std::string statusText(GameStatus status);  // e.g. "fifty moves"
+std::string squareName(int index);  // 0 is "a8", 63 is "h1"
+std::string moveToText(const moveType& move);  // e.g. "e2e4" or "e7e8q"
+moveType moveFromText(
+    const std::string& text);  // the other way, typeOfMove is left 0 (see
+                               // Board::moveKind) and from is -1 if it
+                               // can't be read
+
 #endif  // BOARD_H
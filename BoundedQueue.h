@@ -0,0 +1,58 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+// blocking queue for any number of producers and consumers. push waits while
+// the queue is full, so fast producers get held back instead of piling up
+// memory behind a slow consumer
+template <typename T>
+class BoundedQueue {
+ private:
+  std::deque<T> items;
+  std::size_t capacity;
+  bool closed = false;
+  std::mutex mutex;
+  std::condition_variable notFull;
+  std::condition_variable notEmpty;
+
+ public:
+  explicit BoundedQueue(std::size_t capacity) : capacity(capacity) {}
+
+  bool push(T item) {  // returns false if the queue was closed
+    std::unique_lock<std::mutex> lock(mutex);
+    notFull.wait(lock, [&] { return closed || items.size() < capacity; });
+    if (closed) {
+      return false;
+    }
+    items.push_back(std::move(item));
+    notEmpty.notify_one();
+    return true;
+  }
+
+  bool pop(T& item) {  // returns false once the queue is closed and empty
+    std::unique_lock<std::mutex> lock(mutex);
+    notEmpty.wait(lock, [&] { return closed || !items.empty(); });
+    if (items.empty()) {
+      return false;
+    }
+    item = std::move(items.front());
+    items.pop_front();
+    notFull.notify_one();
+    return true;
+  }
+
+  void close() {  // wakes everyone up, what's already queued can still be
+                  // popped
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    notFull.notify_all();
+    notEmpty.notify_all();
+  }
+};
+
+#endif  // BOUNDEDQUEUE_H
@@ -0,0 +1,69 @@
+#include "ChessClock.h"
+
+#include <algorithm>
+
+ChessClock::ChessClock(int baseMs, int incrementMs) {
+  reset(baseMs, incrementMs);
+}
+
+void ChessClock::reset(int baseMs, int incrementMs) {
+  remaining[0] = remaining[1] = std::chrono::milliseconds(baseMs);
+  increment = std::chrono::milliseconds(incrementMs);
+  running = -1;
+}
+
+ChessClock::Clock::duration ChessClock::left(bool black) const {
+  if (running == black) {
+    return remaining[black] - (Clock::now() - turnStart);
+  }
+  return remaining[black];
+}
+
+void ChessClock::start(bool black) {
+  stop();
+  running = black;
+  turnStart = Clock::now();
+}
+
+void ChessClock::press() {
+  if (running == -1) {
+    return;
+  }
+  bool black = running;
+  stop();
+  remaining[black] += increment;
+  start(!black);
+}
+
+void ChessClock::stop() {
+  if (running != -1) {
+    remaining[running] = left(running);
+    running = -1;
+  }
+}
+
+int ChessClock::remainingMs(bool black) const {
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(left(black));
+  return std::max(0, static_cast<int>(ms.count()));
+}
+
+int ChessClock::getIncrementMs() const {
+  return static_cast<int>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(increment).count());
+}
+
+bool ChessClock::flagged(bool black) const {
+  return left(black) <= Clock::duration::zero();
+}
+
+bool ChessClock::isRunning() const { return running != -1; }
+
+std::string formatClock(int ms) {
+  if (ms < 10000) {
+    return std::to_string(ms / 1000) + "." + std::to_string(ms / 100 % 10);
+  }
+  int seconds = ms / 1000;
+  std::string secondsText = std::to_string(seconds % 60);
+  return std::to_string(seconds / 60) + ":" +
+         (secondsText.size() < 2 ? "0" : "") + secondsText;
+}
@@ -0,0 +1,35 @@
+#ifndef CHESSCLOCK_H
+#define CHESSCLOCK_H
+
+#include <array>
+#include <chrono>
+#include <string>
+
+// a two sided game clock with an increment. runs off steady_clock, so it
+// keeps real time no matter how often anyone looks at it
+class ChessClock {
+ private:
+  using Clock = std::chrono::steady_clock;
+  std::array<Clock::duration, 2> remaining;  // 0 is white, 1 is black
+  Clock::duration increment;
+  int running = -1;  // side whose clock is ticking, -1 when stopped
+  Clock::time_point turnStart;
+
+  Clock::duration left(bool black) const;
+
+ public:
+  explicit ChessClock(int baseMs = 300000, int incrementMs = 0);
+  void reset(int baseMs, int incrementMs);
+  void start(bool black);  // starts one side's clock, no increment
+  void press();  // the side on the move is done: it gets the increment and
+                 // the other side's clock starts
+  void stop();   // pauses whichever clock is running
+  int remainingMs(bool black) const;
+  int getIncrementMs() const;
+  bool flagged(bool black) const;  // out of time
+  bool isRunning() const;
+};
+
+std::string formatClock(int ms);  // "4:59", or "9.4" under ten seconds
+
+#endif  // CHESSCLOCK_H
@@ -0,0 +1,19 @@
+#ifndef EMBEDDEDIMAGES_H
+#define EMBEDDEDIMAGES_H
+
+#include <cstddef>
+#include <string>
+
+// the piece, board and promotion images, compiled into the game by
+// cmake/EmbedFiles.cmake so it starts without reading anything from disk
+// and runs from any directory
+struct embeddedFile {
+  const char* name;  // file name in images/, e.g. "wp.png"
+  const unsigned char* data;
+  std::size_t size;
+};
+
+const embeddedFile* findEmbeddedImage(
+    const std::string& name);  // null if it wasn't embedded
+
+#endif  // EMBEDDEDIMAGES_H
@@ -0,0 +1,128 @@
+#include "Engine.h"
+
+#include <utility>
+#include <vector>
+
+Engine::Engine() : worker(&Engine::workerLoop, this) {}
+
+Engine::~Engine() {
+  quitting.store(true, std::memory_order_relaxed);
+  EngineCommand quit;
+  quit.type = EngineCommand::Quit;
+  sendCommand(quit);
+  worker.join();
+}
+
+void Engine::sendCommand(EngineCommand command) {
+  {
+    std::lock_guard<std::mutex> lock(commandMutex);
+    if (command.type != EngineCommand::Think) {
+      // don't wait for the worker to pick the command up, the search polls
+      // this flag on every node. set under the lock so the worker can't clear
+      // it without also seeing the command
+      stopFlag.store(true, std::memory_order_relaxed);
+    }
+    commands.push_back(std::move(command));
+  }
+  commandReady.notify_one();
+}
+
+void Engine::newPosition(const Board& board) {
+  EngineCommand command;
+  command.type = EngineCommand::NewPosition;
+  command.position = board;
+  sendCommand(std::move(command));
+}
+
+unsigned Engine::think(const SearchLimits& limits) {
+  if (limits.ponder) {
+    // cleared here rather than on the worker, so a hit that comes before the
+    // search has started isn't lost
+    ponderHitFlag.store(false, std::memory_order_relaxed);
+  }
+  EngineCommand command;
+  command.type = EngineCommand::Think;
+  command.limits = limits;
+  command.searchId = ++nextSearchId;
+  sendCommand(command);
+  return command.searchId;
+}
+
+void Engine::ponderHit() {
+  ponderHitFlag.store(true, std::memory_order_relaxed);
+}
+
+void Engine::stop() {
+  EngineCommand command;
+  command.type = EngineCommand::Stop;
+  sendCommand(command);
+}
+
+void Engine::openCache(const std::string& path) {
+  EngineCommand command;
+  command.type = EngineCommand::OpenCache;
+  command.path = path;
+  sendCommand(std::move(command));
+}
+
+bool Engine::pollResult(EngineResult& result) { return results.pop(result); }
+
+void Engine::workerLoop() {
+  while (true) {
+    EngineCommand command;
+    {
+      std::unique_lock<std::mutex> lock(commandMutex);
+      commandReady.wait(lock, [&] { return !commands.empty(); });
+      command = std::move(commands.front());
+      commands.pop_front();
+      if (commands.empty()) {
+        // nothing newer is waiting, so the next search is allowed to run
+        stopFlag.store(false, std::memory_order_relaxed);
+      }
+    }
+
+    switch (command.type) {
+      case EngineCommand::Quit:
+        return;
+      case EngineCommand::NewPosition:
+        position = std::move(command.position);
+        break;
+      case EngineCommand::OpenCache:
+        table.openFile(command.path, 16);
+        break;
+      case EngineCommand::Think:
+        runSearch(command.limits, command.searchId);
+        break;
+      case EngineCommand::Stop:
+        break;
+    }
+  }
+}
+
+void Engine::runSearch(const SearchLimits& limits, unsigned searchId) {
+  Search search(stopFlag, &table, &ponderHitFlag);
+  std::vector<moveType> pv;
+  moveType best = search.think(position, limits, [&](const SearchInfo& info) {
+    if (info.completed) {
+      pv = info.pv;
+    }
+    EngineResult update;
+    update.searchId = searchId;
+    update.info = info;
+    results.push(std::move(update));  // dropping a progress update is fine
+  });
+
+  EngineResult final;
+  final.searchId = searchId;
+  final.isFinal = true;
+  final.bestMove = best;
+  if (pv.size() >= 2 && pv[0].from == best.from && pv[0].to == best.to &&
+      pv[0].promotion == best.promotion) {
+    final.ponderMove = pv[1];
+  }
+  final.info.nodes = search.getNodes();
+  while (!results.push(final) &&
+         !quitting.load(std::memory_order_relaxed)) {
+    std::this_thread::yield();  // the GUI drains the queue every frame
+  }
+}
@@ -0,0 +1,71 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "Board.h"
+#include "Search.h"
+#include "SpscQueue.h"
+#include "TranspositionTable.h"
+
+struct EngineCommand {
+  enum Type { Think, Stop, NewPosition, OpenCache, Quit };
+  Type type;
+  Board position;  // only used by NewPosition
+  std::string path;  // only used by OpenCache
+  SearchLimits limits;  // only used by Think
+  unsigned searchId = 0;
+};
+struct EngineResult {
+  unsigned searchId = 0;  // which think command this answers
+  bool isFinal = false;   // false for progress updates, true for the move
+  SearchInfo info;
+  moveType bestMove{-1, -1, 0};
+  moveType ponderMove{-1, -1, 0};  // the reply the pv expects, from is -1
+                                   // if the pv stops at the best move
+};
+
+// runs the search on its own thread so the window never waits on it.
+// commands go in through a small locked queue, results come back through a
+// lock free queue that the GUI drains once per frame
+class Engine {
+ private:
+  std::mutex commandMutex;
+  std::condition_variable commandReady;
+  std::deque<EngineCommand> commands;
+  std::atomic<bool> stopFlag{false};
+  std::atomic<bool> quitting{false};
+  std::atomic<bool> ponderHitFlag{false};  // see SearchLimits::ponder
+  SpscQueue<EngineResult, 256> results;
+  unsigned nextSearchId = 0;
+  Board position;  // only touched by the worker thread
+  TranspositionTable table;  // worker thread only, kept between searches
+  std::thread worker;  // declared last so it starts after everything above
+
+  void sendCommand(EngineCommand command);
+  void workerLoop();
+  void runSearch(const SearchLimits& limits, unsigned searchId);
+
+ public:
+  Engine();
+  ~Engine();
+  Engine(const Engine&) = delete;
+  Engine& operator=(const Engine&) = delete;
+
+  void newPosition(const Board& board);  // also aborts any running search
+  unsigned think(const SearchLimits& limits);  // returns the search id
+  void ponderHit();  // the opponent played the move a ponder search is on,
+                     // it carries on as a normal search on the clock
+  void stop();  // current search stops within a millisecond and still
+                // reports its best move so far
+  void openCache(const std::string& path);  // keeps the table in this file
+                                            // so it survives restarts
+  bool pollResult(EngineResult& result);  // call from the GUI thread only
+};
+
+#endif  // ENGINE_H
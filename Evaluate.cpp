@@ -0,0 +1,248 @@
+#include "Evaluate.h"
+
+#include <array>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "Profiler.h"
+
+namespace {
+
+// piece-square tables are written from white's point of view with index 0 at
+// a8, same as the board array. black pieces read them mirrored (index ^ 56)
+const std::array<int, 64> pawnTable = {
+    0,  0,  0,  0,   0,   0,  0,  0,  50, 50, 50,  50, 50, 50,  50, 50,
+    10, 10, 20, 30,  30,  20, 10, 10, 5,  5,  10,  25, 25, 10,  5,  5,
+    0,  0,  0,  20,  20,  0,  0,  0,  5,  -5, -10, 0,  0,  -10, -5, 5,
+    5,  10, 10, -20, -20, 10, 10, 5,  0,  0,  0,   0,  0,  0,   0,  0};
+
+const std::array<int, 64> knightTable = {
+    -50, -40, -30, -30, -30, -30, -40, -50, -40, -20, 0,   0,   0,
+    0,   -20, -40, -30, 0,   10,  15,  15,  10,  0,   -30, -30, 5,
+    15,  20,  20,  15,  5,   -30, -30, 0,   15,  20,  20,  15,  0,
+    -30, -30, 5,   10,  15,  15,  10,  5,   -30, -40, -20, 0,   5,
+    5,   0,   -20, -40, -50, -40, -30, -30, -30, -30, -40, -50};
+
+const std::array<int, 64> bishopTable = {
+    -20, -10, -10, -10, -10, -10, -10, -20, -10, 0,   0,   0,   0,
+    0,   0,   -10, -10, 0,   5,   10,  10,  5,   0,   -10, -10, 5,
+    5,   10,  10,  5,   5,   -10, -10, 0,   10,  10,  10,  10,  0,
+    -10, -10, 10,  10,  10,  10,  10,  10,  -10, -10, 5,   0,   0,
+    0,   0,   5,   -10, -20, -10, -10, -10, -10, -10, -10, -20};
+
+const std::array<int, 64> rookTable = {
+    0, 0,  0, 0, 0, 0, 0, 0,  5,  10, 10, 10, 10, 10, 10, 5,
+    -5, 0, 0, 0, 0, 0, 0, -5, -5, 0,  0,  0,  0,  0,  0,  -5,
+    -5, 0, 0, 0, 0, 0, 0, -5, -5, 0,  0,  0,  0,  0,  0,  -5,
+    -5, 0, 0, 0, 0, 0, 0, -5, 0,  0,  0,  5,  5,  0,  0,  0};
+
+const std::array<int, 64> queenTable = {
+    -20, -10, -10, -5, -5, -10, -10, -20, -10, 0,   0,   0,  0,  0,   0,   -10,
+    -10, 0,   5,   5,  5,  5,   0,   -10, -5,  0,   5,   5,  5,  5,   0,   -5,
+    0,   0,   5,   5,  5,  5,   0,   -5,  -10, 5,   5,   5,  5,  5,   0,   -10,
+    -10, 0,   5,   0,  0,  0,   0,   -10, -20, -10, -10, -5, -5, -10, -10, -20};
+
+const std::array<int, 64> kingTable = {
+    -30, -40, -40, -50, -50, -40, -40, -30, -30, -40, -40, -50, -50,
+    -40, -40, -30, -30, -40, -40, -50, -50, -40, -40, -30, -30, -40,
+    -40, -50, -50, -40, -40, -30, -20, -30, -30, -40, -40, -30, -30,
+    -20, -10, -20, -20, -20, -20, -20, -20, -10, 20,  20,  0,   0,
+    0,   0,   20,  20,  20,  30,  10,  0,   0,   10,  30,  20};
+
+EvalParams makeDefaultParams() {
+  EvalParams params;
+  params.pieceValues = {0, 100, 500, 320, 330, 900, 0};
+  params.pieceSquare = {std::array<int, 64>{}, pawnTable,  rookTable,
+                        knightTable,           bishopTable, queenTable,
+                        kingTable};
+  params.mobility = {0, 0, 2, 4, 5, 1, 0};
+  return params;
+}
+
+EvalParams params = makeDefaultParams();
+
+const char* tableNames[7] = {"", "pawn", "rook", "knight", "bishop", "queen",
+                             "king"};  // by piece type
+
+int popcount(std::uint64_t bits) {
+  int count = 0;
+  while (bits) {
+    bits &= bits - 1;
+    count++;
+  }
+  return count;
+}
+
+// squares a knight or slider on index attacks, up to and including the
+// first piece in each direction
+std::uint64_t pieceAttacks(const std::array<int, 64>& squares, int type,
+                           int index) {
+  static const int knightSteps[8][2] = {{1, -2}, {2, -1}, {2, 1},  {1, 2},
+                                        {-1, 2}, {-2, 1}, {-2, -1}, {-1, -2}};
+  static const int raySteps[8][2] = {{0, -1}, {1, -1}, {1, 0},  {1, 1},
+                                     {0, 1},  {-1, 1}, {-1, 0}, {-1, -1}};
+  std::uint64_t attacks = 0;
+  int x = index % 8, y = index / 8;
+  if (type == 3) {
+    for (const auto& step : knightSteps) {
+      int nx = x + step[0], ny = y + step[1];
+      if (nx >= 0 && nx < 8 && ny >= 0 && ny < 8) {
+        attacks |= 1ULL << (ny * 8 + nx);
+      }
+    }
+    return attacks;
+  }
+  for (int dir = 0; dir < 8; ++dir) {
+    bool diagonal = dir % 2;
+    if ((type == 2 && diagonal) || (type == 4 && !diagonal)) {
+      continue;
+    }
+    int nx = x + raySteps[dir][0], ny = y + raySteps[dir][1];
+    while (nx >= 0 && nx < 8 && ny >= 0 && ny < 8) {
+      attacks |= 1ULL << (ny * 8 + nx);
+      if (squares[ny * 8 + nx]) {
+        break;
+      }
+      nx += raySteps[dir][0];
+      ny += raySteps[dir][1];
+    }
+  }
+  return attacks;
+}
+
+}  // namespace
+
+const EvalParams& evalParams() { return params; }
+
+EvalParams& mutableEvalParams() { return params; }
+
+// the file is a few named lists of numbers, "values" and "mobility" with one
+// per piece type and a 64 square table for each piece. anything left out
+// keeps its current weights
+bool loadEvalParams(const std::string& path) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cout << "couldn't open " << path << std::endl;
+    return false;
+  }
+  EvalParams loaded = params;
+  std::string line, text;
+  while (std::getline(file, line)) {
+    text += line.substr(0, line.find('#')) + "\n";  // # starts a comment
+  }
+  std::istringstream words(text);
+  std::string name;
+  while (words >> name) {
+    int* values = nullptr;
+    int count = 7;
+    if (name == "values") {
+      values = loaded.pieceValues.data();
+    } else if (name == "mobility") {
+      values = loaded.mobility.data();
+    }
+    for (int type = 1; type <= 6 && !values; ++type) {
+      if (name == tableNames[type]) {
+        values = loaded.pieceSquare[type].data();
+        count = 64;
+      }
+    }
+    if (!values) {
+      std::cout << path << ": unknown weights \"" << name << "\"" << std::endl;
+      return false;
+    }
+    for (int i = 0; i < count; ++i) {
+      if (!(words >> values[i])) {
+        std::cout << path << ": " << name << " needs " << count << " numbers"
+                  << std::endl;
+        return false;
+      }
+    }
+  }
+  params = loaded;
+  return true;
+}
+
+bool saveEvalParams(const std::string& path, const EvalParams& weights) {
+  std::ofstream file(path);
+  file << "# evaluation weights, loaded with --eval. piece tables are from\n"
+          "# white's point of view with a8 first\n";
+  file << "values";
+  for (int value : weights.pieceValues) {
+    file << " " << value;
+  }
+  file << "\nmobility";
+  for (int value : weights.mobility) {
+    file << " " << value;
+  }
+  file << "\n";
+  for (int type = 1; type <= 6; ++type) {
+    file << tableNames[type] << "\n";
+    for (int i = 0; i < 64; ++i) {
+      file << std::setw(5) << weights.pieceSquare[type][i]
+           << (i % 8 == 7 ? "\n" : "");
+    }
+  }
+  return static_cast<bool>(file);
+}
+
+std::array<int, 7> mobilityCounts(const std::array<int, 64>& squares) {
+  std::array<std::uint64_t, 2> own = {};
+  std::array<std::array<std::uint64_t, 7>, 2> attacks = {};
+  for (int i = 0; i < 64; ++i) {
+    int id = squares[i];
+    if (!id) {
+      continue;
+    }
+    own[id / 8] |= 1ULL << i;
+    if (id % 8 >= 2 && id % 8 <= 5) {
+      attacks[id / 8][id % 8] |= pieceAttacks(squares, id % 8, i);
+    }
+  }
+  std::array<int, 7> counts = {};
+  for (int type = 2; type <= 5; ++type) {
+    counts[type] = popcount(attacks[0][type] & ~own[0]) -
+                   popcount(attacks[1][type] & ~own[1]);
+  }
+  return counts;
+}
+
+int evaluateSquares(const std::array<int, 64>& squares, bool blackToMove) {
+  int score = 0;  // positive is good for white
+  std::array<std::uint64_t, 2> own = {};
+  std::array<std::array<std::uint64_t, 7>, 2> attacks = {};
+  for (int i = 0; i < 64; ++i) {
+    int id = squares[i];
+    if (!id) {
+      continue;
+    }
+    int type = id % 8;
+    int colour = id / 8;
+    own[colour] |= 1ULL << i;
+    if (colour) {
+      score -= params.pieceValues[type] + params.pieceSquare[type][i ^ 56];
+    } else {
+      score += params.pieceValues[type] + params.pieceSquare[type][i];
+    }
+    if (type >= 2 && type <= 5) {
+      attacks[colour][type] |= pieceAttacks(squares, type, i);
+    }
+  }
+  // mobility counts the squares all pieces of a type reach together, minus
+  // ones our own pieces stand on. batch evaluation works the same way
+  for (int type = 2; type <= 5; ++type) {
+    score += params.mobility[type] * popcount(attacks[0][type] & ~own[0]);
+    score -= params.mobility[type] * popcount(attacks[1][type] & ~own[1]);
+  }
+  return blackToMove ? -score : score;
+}
+
+int evaluate(const Board& board) {
+  PROFILE_SCOPE(ProfileZone::Evaluation);
+  std::array<int, 64> squares;
+  for (int i = 0; i < 64; ++i) {
+    squares[i] = board.getPiece(i);
+  }
+  return evaluateSquares(squares, board.isBlackToMove());
+}
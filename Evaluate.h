@@ -0,0 +1,37 @@
+#ifndef EVALUATE_H
+#define EVALUATE_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "Board.h"
+
+constexpr int MATE_SCORE = 30000;  // scores above MATE_SCORE - 1000 are mates
+
+struct EvalParams {  // every weight the evaluation uses
+  std::array<int, 7> pieceValues;  // indexed by piece type
+  std::array<std::array<int, 64>, 7>
+      pieceSquare;  // [type][square] from white's point of view with index 0
+                    // at a8, black pieces read them mirrored (index ^ 56)
+  std::array<int, 7> mobility;  // per square reached, by piece type
+};
+
+const EvalParams& evalParams();
+EvalParams& mutableEvalParams();  // for loading or tuning weights
+bool loadEvalParams(const std::string& path);  // a file saveEvalParams (or
+                                               // chess_tune) wrote. false
+                                               // and nothing changed if it
+                                               // can't be read
+bool saveEvalParams(const std::string& path, const EvalParams& weights);
+
+int evaluate(const Board& board);  // static evaluation in centipawns, from
+                                   // the point of view of the side to move
+int evaluateSquares(const std::array<int, 64>& squares,
+                    bool blackToMove);  // same thing on a bare board array
+std::array<int, 7> mobilityCounts(
+    const std::array<int, 64>& squares);  // by piece type, white's squares
+                                          // minus black's. what the mobility
+                                          // weights multiply, for the tuner
+
+#endif  // EVALUATE_H
@@ -2,32 +2,63 @@
 
 #include <SFML/Graphics.hpp>
 #include <SFML/Window/Event.hpp>
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
 #include <iostream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "Board.h"
+#include "EmbeddedImages.h"
+#include "Evaluate.h"
+#include "Profiler.h"
 
-Game::Game() : window(sf::VideoMode(800, 800), "Chess Game") {
+namespace {
+
+constexpr float BOARD_SIZE = 800.f;
+constexpr float SCRUBBER_HEIGHT = 30.f;  // strip under the board
+
+}  // namespace
+
+Game::Game(std::chrono::steady_clock::time_point launchTime)
+    : launchTime(launchTime),
+      window(sf::VideoMode(static_cast<unsigned>(BOARD_SIZE),
+                           static_cast<unsigned>(BOARD_SIZE + SCRUBBER_HEIGHT)),
+             "Chess Game") {
   window.setFramerateLimit(120);
+  engineLimits.reportIntervalMs = 100;  // time comes from the clock
+  profileSetTracing(profileEnabled());
 }
 
 void Game::run() {
   summonStartingSprites();
-  board.generateAllMoves();
+  record.reset(board);
+  engine.newPosition(board);
+  clock.start(turn);
 
   while (window.isOpen()) {
     sf::Event event{};
     while (window.pollEvent(event)) {
       if (event.type == sf::Event::Closed) {
         window.close();
+      } else if (event.type == sf::Event::KeyPressed) {
+        handleKeyPress(event);
       } else if (isPromoting) {
         choosePromotionPiece(event);
+      } else if (handleScrubber(event)) {
+        continue;
       } else {
         handleDragAndDrop(event);
       }
     }
 
+    pollEngine();
+    updatePlayback();
+    updateClock();
     updateDragPosition();
 
     window.clear();
@@ -38,10 +69,22 @@ void Game::run() {
       window.draw(s);
     }
     lightValidSquares(validMoves);
+    if (analysisMode) {
+      drawAnalysis();
+    }
+    drawScrubber();
     if (draggedPiece) {
       window.draw(*draggedPiece);
     }
     window.display();
+    if (!firstFrameShown) {
+      firstFrameShown = true;
+      std::cout << "first frame after "
+                << std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - launchTime)
+                       .count()
+                << " ms (images " << imagesMs << " ms)" << std::endl;
+    }
   }
 }
 
@@ -52,7 +95,9 @@ void Game::handleMouseClick(sf::Event& event) {
   int row = static_cast<int>(mousePos.y) / 100;
   prevIndex = row * 8 + col;
   pieceId = board.getPiece(prevIndex);
-  if (pieceId / 8 == turn) {
+  if (pieceId / 8 == turn && turn != engineSide && !timeOut &&
+      board.getStatus() == GameStatus::Ongoing) {
+    isPlayingBack = false;
     validMoves = board.checkMove(prevIndex);
     for (int i = 1; i < sprite.size(); ++i) {
       if (sprite[i].getGlobalBounds().contains(mousePos)) {
@@ -70,47 +115,113 @@ void Game::dropPiece() {
   int col = static_cast<int>(pos.x + 50) / 100;
   int row = static_cast<int>(pos.y + 50) / 100;
   int newIndex = row * 8 + col;
-  bool switchTurn = true;
 
-  bool foundMove = false;
   for (const auto& move : validMoves) {
     if (move.to == newIndex) {
-      foundMove = true;
-      switch (move.typeOfMove) {
-        case 2:
-          takePiece(row, col);
-          break;
-        case 3:
-          castling(row, col);
-          break;
-        case 4:
-          takingEnPassant(row, col);
-          break;
-        case 5:
-          isPromoting = true;
-          promotingPieceIndex = newIndex;
-          promotingPieceSprite = draggedPiece;
-          draggedPiece->setPosition(col * 100.f, row * 100.f);
-          sprite[33].setPosition(0, 0);
-          switchTurn = false;
-          break;
-        default:
-          if ((pieceId & 1) && abs(move.to - move.from) == 16) {
-            board.setEnPassantFile(col);
-          }
-          break;
-      }
-      if (switchTurn) {
+      if (move.typeOfMove == 5) {  // wait for the player to pick a piece
+        isPromoting = true;
+        promotingMove = move;
+        promotingPieceSprite = draggedPiece;
         draggedPiece->setPosition(col * 100.f, row * 100.f);
-        board.updateBoard(prevIndex, newIndex);
-        nextTurn();
-        checkPawnMove(prevIndex, newIndex);
-        break;
+        sprite[33 + turn].setPosition(0, 0);
+        return;
       }
+      board.makeMove(move);
+      syncSprites();
+      nextTurn(move);
+      return;
     }
   }
-  if (!foundMove) {
-    draggedPiece->setPosition((prevIndex % 8) * 100.f, (prevIndex / 8) * 100.f);
+  draggedPiece->setPosition((prevIndex % 8) * 100.f, (prevIndex / 8) * 100.f);
+}
+
+void Game::handleKeyPress(sf::Event& event) {
+  if (event.key.code == sf::Keyboard::E && !isPromoting) {
+    // E hands the side to move over to the engine, or takes it back
+    if (engineSide == -1) {
+      engineSide = turn;
+      startEngineSearch();
+    } else {
+      stopPonder();
+      engineSide = -1;
+      engine.stop();
+      startAnalysis();
+    }
+  } else if (event.key.code == sf::Keyboard::P) {
+    // P dumps the hot path profile (only has numbers with CHESS_PROFILE)
+    profileWriteJson("profile.json");
+    profileWriteChromeTrace("profile_trace.json");
+    std::cout << "wrote profile.json and profile_trace.json" << std::endl;
+  } else if (!isPromoting && !isDragging &&
+             (event.key.code == sf::Keyboard::Left ||
+              event.key.code == sf::Keyboard::Right ||
+              event.key.code == sf::Keyboard::Up ||
+              event.key.code == sf::Keyboard::Down ||
+              event.key.code == sf::Keyboard::Home ||
+              event.key.code == sf::Keyboard::End)) {
+    // arrows step through the game one move at a time, up and down go ten
+    // at a time, home and end jump to the start and the latest position
+    int last = record.plyCount();
+    isPlayingBack = false;
+    switch (event.key.code) {
+      case sf::Keyboard::Left:
+        showPly(viewPly - 1);
+        break;
+      case sf::Keyboard::Right:
+        showPly(viewPly + 1);
+        break;
+      case sf::Keyboard::Up:
+        showPly(viewPly - 10);
+        break;
+      case sf::Keyboard::Down:
+        showPly(viewPly + 10);
+        break;
+      case sf::Keyboard::Home:
+        showPly(0);
+        break;
+      default:
+        showPly(last);
+        break;
+    }
+  } else if (event.key.code == sf::Keyboard::F && !isPromoting &&
+             !isDragging) {
+    // F plays the game forward from the board, from the start if it's
+    // already at the end. shift makes it go faster
+    isPlayingBack = !isPlayingBack;
+    playbackIntervalMs = event.key.shift ? 40 : 150;
+    if (isPlayingBack && viewPly == record.plyCount()) {
+      showPly(0);
+    }
+    playbackClock.restart();
+  } else if (event.key.code == sf::Keyboard::A) {
+    // A switches the live analysis overlay on and off
+    analysisMode = !analysisMode;
+    analysis = SearchInfo{};
+    stopPonder();  // analysis has the engine while it's on
+    if (analysisMode) {
+      startAnalysis();
+    } else if (turn != engineSide) {
+      engine.stop();
+    }
+  } else if (event.key.code == sf::Keyboard::O) {
+    // O switches pondering on the player's time off and on
+    ponderEnabled = !ponderEnabled;
+    std::cout << "pondering " << (ponderEnabled ? "on" : "off") << std::endl;
+    if (!ponderEnabled) {
+      stopPonder();
+    }
+  } else if (event.key.code == sf::Keyboard::G) {
+    // G prints the database games that got to this position
+    listIndexedGames();
+  } else if (event.key.code == sf::Keyboard::M) {
+    // M cycles how many lines the analysis shows: 1, 3, 5
+    analysisLines = analysisLines >= 5 ? 1 : analysisLines + 2;
+    std::cout << "analysis lines: " << analysisLines << std::endl;
+    if (analysisMode && turn != engineSide) {
+      engine.stop();
+      analysis = SearchInfo{};
+      startAnalysis();
+    }
   }
 }
 
@@ -137,34 +248,26 @@ void Game::takeNonPromotingPiece(int row, int col,
     if (sprite[i].getGlobalBounds().contains(col * 100.f, row * 100.f) &&
         (&sprite[i] != promotingPieceSprite)) {
       sprite[i].setPosition(1000, 1000);
-      pieceTaken = i;
     }
   }
 }
 
-void Game::undoPromotion(int row, int col) {
-  promotingPieceSprite->setPosition((prevIndex % 8) * 100.f,
-                                    (prevIndex / 8) * 100.f);
-
-  sprite[33].setPosition(1000, 1000);
+void Game::undoPromotion() {
+  sprite[33 + turn].setPosition(1000, 1000);
   isPromoting = false;
   promotingPieceSprite = nullptr;
-  promotingPieceId = 0;
-  promotingPieceIndex = -1;
-  if (pieceTaken) {
-    sprite[pieceTaken].setPosition(col * 100.f, row * 100.f);
-  }
+  promotingMove = moveType{-1, -1, 0};
+  syncSprites();  // puts back the pawn and anything it was about to take
 }
 
 void Game::choosePromotionPiece(sf::Event& event) {
   if (!promotingPieceSprite) {
     throw std::runtime_error("sprite of the promoting piece is missing");
   }
-  int col = promotingPieceIndex % 8;
-  int row = promotingPieceIndex / 8;
-  int colour = turn;
+  int col = promotingMove.to % 8;
+  int row = promotingMove.to / 8;
 
-  if (board.getPiece(promotingPieceIndex)) {
+  if (board.getPiece(promotingMove.to)) {
     takeNonPromotingPiece(row, col, promotingPieceSprite);
   }
 
@@ -173,104 +276,103 @@ void Game::choosePromotionPiece(sf::Event& event) {
     sf::Vector2f mousePos =
         window.mapPixelToCoords({event.mouseButton.x, event.mouseButton.y});
     if (mousePos.x > 400 || mousePos.y > 100) {
-      undoPromotion(row, col);
+      undoPromotion();
 
       return;
     }
     if (mousePos.x < 100) {
-      board.promotePawn(promotingPieceIndex, 5 + (colour * 8), prevIndex);
-      promotingPieceSprite->setTexture(texture[5 + (colour * 6)]);
-
+      promotingMove.promotion = 5;
     } else if (mousePos.x < 200) {
-      board.promotePawn(promotingPieceIndex, 4 + (colour * 8), prevIndex);
-      promotingPieceSprite->setTexture(texture[4 + (colour * 6)]);
-
+      promotingMove.promotion = 4;
     } else if (mousePos.x < 300) {
-      board.promotePawn(promotingPieceIndex, 3 + (colour * 8), prevIndex);
-      promotingPieceSprite->setTexture(texture[3 + (colour * 6)]);
-
-    } else if (mousePos.x < 400) {
-      board.promotePawn(promotingPieceIndex, 2 + (colour * 8), prevIndex);
-      promotingPieceSprite->setTexture(texture[2 + (colour * 6)]);
+      promotingMove.promotion = 3;
+    } else {
+      promotingMove.promotion = 2;
     }
-    nextTurn();
-    sprite[33].setPosition(1000, 1000);
+    board.makeMove(promotingMove);
+    moveType played = promotingMove;
+    sprite[33 + turn].setPosition(1000, 1000);
     isPromoting = false;
     promotingPieceSprite = nullptr;
-    promotingPieceId = 0;
-    promotingPieceIndex = -1;
-    pieceTaken = 0;
+    promotingMove = moveType{-1, -1, 0};
+    syncSprites();
+    nextTurn(played);
   }
 }
 
-void Game::checkPawnMove(int prevIndex, int newIndex) {
-  int prevRow = prevIndex / 8;
-  int newRow = newIndex / 8;
-  bool isPawn =
-      (board.getPiece(newIndex) == 1 || board.getPiece(newIndex) == 9);
-  if (isPawn && abs(newRow - prevRow) == 2) {
-    return;
+void Game::lightValidSquares(std::vector<moveType>& moves) {
+  for (auto move : moves) {
+    float x = move.to % 8 * 100.f;
+    float y = move.to / 8 * 100.f;
+    sf::RectangleShape highlight(sf::Vector2f(100.f, 100.f));
+    highlight.setFillColor(sf::Color(255, 0, 0, 50));
+    highlight.setPosition(x, y);
+    window.draw(highlight);
   }
-  board.resetEnPassant();
 }
 
-void Game::castling(int row, int col) {
-  int side = col - 5;  // neg means queenside, pos is kingside
-
-  if (side > 0) {
-    board.updateBoard(row * 8 + 7, row * 8 + 5);
-    float xcoord = 7 * 100.f;
-    float ycoord = row * 100.f;
-    for (int i = 1; i < sprite.size(); ++i) {
-      if (sprite[i].getGlobalBounds().contains(xcoord, ycoord)) {
-        sprite[i].setPosition(5 * 100.f, ycoord);
-        break;
-      }
-    }
-  } else {
-    board.updateBoard(row * 8 + 0, row * 8 + 3);
-    float xcoord = 0 * 100.f;
-    float ycoord = row * 100.f;
-    for (int i = 1; i < sprite.size(); ++i) {
-      if (sprite[i].getGlobalBounds().contains(xcoord, ycoord)) {
-        sprite[i].setPosition(3 * 100.f, ycoord);
-        break;
-      }
-    }
+void Game::drawAnalysis() {
+  if (analysis.pv.empty()) {
+    return;
   }
-}
-
-void Game::takingEnPassant(int row, int col) {
-  ;
-  int ROW_BEHIND_PIECE = (pieceId / 8) ? -1 : 1;
-  for (int i = 1; i < sprite.size(); ++i) {
-    if (sprite[i].getGlobalBounds().contains(
-            col * 100.f, (row + ROW_BEHIND_PIECE) * 100.f) &&
-        (&sprite[i] != draggedPiece)) {
-      sprite[i].setPosition(1000, 1000);
+  // eval bar down the left edge, white's share grows from the bottom
+  int whiteScore = board.isBlackToMove() ? -analysis.score : analysis.score;
+  float whiteShare = 0.5f + std::clamp(whiteScore, -1000, 1000) / 2000.f;
+  if (std::abs(whiteScore) > MATE_SCORE - 1000) {
+    whiteShare = whiteScore > 0 ? 1.f : 0.f;
+  }
+  sf::RectangleShape blackBar(sf::Vector2f(12.f, 800.f));
+  blackBar.setFillColor(sf::Color(40, 40, 40, 200));
+  window.draw(blackBar);
+  sf::RectangleShape whiteBar(sf::Vector2f(12.f, 800.f * whiteShare));
+  whiteBar.setFillColor(sf::Color(235, 235, 235, 220));
+  whiteBar.setPosition(0, 800.f * (1 - whiteShare));
+  window.draw(whiteBar);
+
+  // the other multipv lines just get their first move, thinner and greyer
+  // the further down they are
+  for (int i = static_cast<int>(analysis.lines.size()) - 1; i >= 1; --i) {
+    const moveType& move = analysis.lines[i].pv[0];
+    if (move.from == analysis.pv[0].from && move.to == analysis.pv[0].to) {
+      continue;  // a new best move mid iteration, the lines are a bit behind
     }
+    drawArrow(move.from, move.to, sf::Color(200, 140, 40, 170 - i * 20),
+              10.f - i);
   }
-  board.takePiece((row + ROW_BEHIND_PIECE) * 8 + col);
-}
 
-void Game::takePiece(int row, int col) {
-  for (int i = 1; i < sprite.size(); ++i) {
-    if (sprite[i].getGlobalBounds().contains(col * 100.f, row * 100.f) &&
-        (&sprite[i] != draggedPiece)) {
-      sprite[i].setPosition(1000, 1000);
-    }
+  // best move in green, then the rest of the line fading out
+  for (int i = std::min<int>(analysis.pv.size(), 4) - 1; i >= 0; --i) {
+    sf::Color colour = i % 2 ? sf::Color(60, 120, 220, 160 - i * 30)
+                             : sf::Color(40, 180, 60, 200 - i * 30);
+    drawArrow(analysis.pv[i].from, analysis.pv[i].to, colour,
+              i == 0 ? 14.f : 9.f);
   }
 }
 
-void Game::lightValidSquares(std::vector<moveType>& moves) {
-  for (auto move : moves) {
-    float x = move.to % 8 * 100.f;
-    float y = move.to / 8 * 100.f;
-    sf::RectangleShape highlight(sf::Vector2f(100.f, 100.f));
-    highlight.setFillColor(sf::Color(255, 0, 0, 50));
-    highlight.setPosition(x, y);
-    window.draw(highlight);
-  }
+void Game::drawArrow(int from, int to, sf::Color colour, float thickness) {
+  sf::Vector2f start((from % 8) * 100.f + 50, (from / 8) * 100.f + 50);
+  sf::Vector2f end((to % 8) * 100.f + 50, (to / 8) * 100.f + 50);
+  float dx = end.x - start.x;
+  float dy = end.y - start.y;
+  float length = std::sqrt(dx * dx + dy * dy);
+  float angle = std::atan2(dy, dx) * 180.f / 3.14159265f;
+  float headLength = 30.f;
+
+  sf::RectangleShape shaft(sf::Vector2f(length - headLength, thickness));
+  shaft.setOrigin(0, thickness / 2);
+  shaft.setPosition(start);
+  shaft.setRotation(angle);
+  shaft.setFillColor(colour);
+  window.draw(shaft);
+
+  sf::ConvexShape head(3);
+  head.setPoint(0, sf::Vector2f(0.f, 0.f));
+  head.setPoint(1, sf::Vector2f(-headLength, -thickness * 1.5f));
+  head.setPoint(2, sf::Vector2f(-headLength, thickness * 1.5f));
+  head.setPosition(end);
+  head.setRotation(angle);
+  head.setFillColor(colour);
+  window.draw(head);
 }
 
 void Game::updateDragPosition() {  // makes sprite follow mouse as you're
@@ -298,16 +400,33 @@ void Game::loadSprites() {
                                       "bk.png",
                                       "promochoiceswhite.png",
                                       "promochoicesblack.png"};
-  // array of the images i use as sprites
+  // array of the images i use as sprites. they're compiled into the game
+  // (EmbeddedImages.h), decoding them is most of the startup time so each
+  // one gets its own thread. only the upload to the gpu has to stay on this
+  // thread, the window's context lives here
+  auto start = std::chrono::steady_clock::now();
+  std::array<sf::Image, 15> image;
+  std::array<bool, 15> decoded{};
+  std::vector<std::thread> decoders;
+  for (int i = 0; i < static_cast<int>(image.size()); ++i) {
+    decoders.emplace_back([&, i] {
+      const embeddedFile* embedded = findEmbeddedImage(file[i]);
+      decoded[i] =
+          embedded && image[i].loadFromMemory(embedded->data, embedded->size);
+    });
+  }
+  for (std::thread& decoder : decoders) {
+    decoder.join();
+  }
   int j = 0;
   for (int i = 0; i < texture.size();
        ++i) {  // loop that makes 1 texture of each file, and sprites equal to
                // the amount of pieces we need on the starting chessboard.
-    std::string path = "images/" + file[i];
-    if (!texture[i].loadFromFile(
-            path)) {  // makes texture for each of the images, if missing will
-                      // send a message
-      std::cout << path << " is missing" << std::endl;
+    if (!decoded[i] ||
+        !texture[i].loadFromImage(
+            image[i])) {  // makes texture for each of the images, if missing
+                          // will send a message
+      std::cout << file[i] << " is missing" << std::endl;
     }
     if (i == 1 || i == 7) {  // loop to make 8 pawn sprites for each side
       for (int k = 0; k < 8; ++k) {
@@ -326,71 +445,354 @@ void Game::loadSprites() {
       j++;
     }
   }
+  imagesMs = std::chrono::duration<double, std::milli>(
+                 std::chrono::steady_clock::now() - start)
+                 .count();
 }
 
 void Game::deleteSprites() {}
 
-void Game::nextTurn() {
-  board.canCastle();
+void Game::nextTurn(const moveType& move) {
+  turn = board.isBlackToMove();
+  record.truncate(viewPly);  // a move from an earlier ply starts a new line
+  record.push(move, board);
+  viewPly++;
+  if (clock.isRunning()) {
+    clock.press();
+  } else {
+    clock.start(turn);  // first move after looking back through the game
+  }
+
+  GameStatus status = board.getStatus();
+  if (status == GameStatus::Checkmate) {
+    std::cout << std::endl << "Checkmate!" << std::endl;
+  } else if (status == GameStatus::Stalemate) {
+    std::cout << std::endl << "Stalemate!" << std::endl;
+  } else if (status != GameStatus::Ongoing) {
+    std::cout << std::endl << "Draw by " << statusText(status) << "!"
+              << std::endl;
+  }
+  if (status != GameStatus::Ongoing) {
+    clock.stop();
+  }
+
+  if (pondering) {
+    pondering = false;
+    if (turn == engineSide && status == GameStatus::Ongoing &&
+        move.from == ponderMove.from && move.to == ponderMove.to &&
+        move.promotion == ponderMove.promotion) {
+      // the engine has been on this position since its last move, its
+      // search carries on with the clock running from now
+      engine.ponderHit();
+      ponderHits++;
+      ponderSavedMs += std::chrono::duration<double, std::milli>(
+                           std::chrono::steady_clock::now() - ponderStart)
+                           .count();
+      analysis = SearchInfo{};
+      return;
+    }
+    ponderMisses++;  // newPosition stops it
+  }
+  if (status != GameStatus::Ongoing) {
+    reportPonder();
+  }
 
-  turn = !turn;
-  board.findKing();
-  board.findCheckingMoves();
-  board.findPinsToKing(!turn);
-  board.generateAllMoves();
+  engine.newPosition(board);
+  analysis = SearchInfo{};
+  if (turn == engineSide) {
+    startEngineSearch();
+  } else {
+    startAnalysis();
+  }
+}
+
+void Game::showPly(int ply) {
+  ply = std::clamp(ply, 0, record.plyCount());
+  if (ply == viewPly) {
+    return;
+  }
+  // a checkpoint restore and a few moves played on from it. the keys before
+  // it come along so repetitions still count after a takeback
+  stopPonder();
+  engine.stop();
+  engineSearchId = 0;
+  record.seek(ply, board);
+  viewPly = ply;
+  turn = board.isBlackToMove();
+  bool latest = viewPly == record.plyCount();
+  if (latest && !timeOut && board.getStatus() == GameStatus::Ongoing) {
+    clock.start(turn);
+  } else {
+    clock.stop();
+  }
+  validMoves = {};
+  syncSprites();
+  if (!isScrubbing && !isPlayingBack) {
+    std::cout << "ply " << viewPly << " of " << record.plyCount() << std::endl;
+  }
+
+  engine.newPosition(board);
+  analysis = SearchInfo{};
+  // the engine only plays on from the latest position, looking back through
+  // the game shouldn't make it move
+  if (turn == engineSide && latest) {
+    startEngineSearch();
+  } else {
+    startAnalysis();
+  }
+}
+
+bool Game::handleScrubber(sf::Event& event) {
+  auto scrubTo = [&](float x) {
+    int plies = record.plyCount();
+    showPly(static_cast<int>(std::lround(x / BOARD_SIZE * plies)));
+  };
+  if (event.type == sf::Event::MouseButtonPressed &&
+      event.mouseButton.button == sf::Mouse::Left && !isDragging) {
+    sf::Vector2f mousePos =
+        window.mapPixelToCoords({event.mouseButton.x, event.mouseButton.y});
+    if (mousePos.y < BOARD_SIZE) {
+      return false;
+    }
+    isScrubbing = true;
+    isPlayingBack = false;
+    scrubTo(mousePos.x);
+    return true;
+  }
+  if (!isScrubbing) {
+    return false;
+  }
+  if (event.type == sf::Event::MouseMoved) {
+    scrubTo(window.mapPixelToCoords({event.mouseMove.x, event.mouseMove.y}).x);
+  } else if (event.type == sf::Event::MouseButtonReleased &&
+             event.mouseButton.button == sf::Mouse::Left) {
+    isScrubbing = false;
+    std::cout << "ply " << viewPly << " of " << record.plyCount() << std::endl;
+  }
+  return true;
+}
+
+void Game::drawScrubber() {
+  sf::RectangleShape strip(sf::Vector2f(BOARD_SIZE, SCRUBBER_HEIGHT));
+  strip.setPosition(0, BOARD_SIZE);
+  strip.setFillColor(sf::Color(50, 50, 50));
+  window.draw(strip);
+  int plies = record.plyCount();
+  if (!plies) {
+    return;
+  }
+  float shown = BOARD_SIZE * viewPly / plies;
+  sf::RectangleShape played(sf::Vector2f(shown, SCRUBBER_HEIGHT - 12));
+  played.setPosition(0, BOARD_SIZE + 6);
+  played.setFillColor(isPlayingBack ? sf::Color(60, 160, 80)
+                                    : sf::Color(110, 110, 110));
+  window.draw(played);
+  sf::RectangleShape handle(sf::Vector2f(6.f, SCRUBBER_HEIGHT));
+  handle.setPosition(std::min(shown, BOARD_SIZE - 6), BOARD_SIZE);
+  handle.setFillColor(sf::Color(230, 230, 230));
+  window.draw(handle);
+}
+
+void Game::updatePlayback() {
+  if (!isPlayingBack ||
+      playbackClock.getElapsedTime().asMilliseconds() < playbackIntervalMs) {
+    return;
+  }
+  playbackClock.restart();
+  showPly(viewPly + 1);
+  if (viewPly == record.plyCount()) {
+    isPlayingBack = false;
+    std::cout << "ply " << viewPly << " of " << record.plyCount() << std::endl;
+  }
+}
+
+void Game::startEngineSearch() {
+  if (timeOut || board.getStatus() != GameStatus::Ongoing) {
+    return;
+  }
+  SearchLimits limits = engineLimits;
+  limits.timeLeftMs = std::max(1, clock.remainingMs(turn));
+  limits.incrementMs = clock.getIncrementMs();
+  engineSearchId = engine.think(limits);
+}
+
+void Game::updateClock() {
+  if (!timeOut && clock.isRunning() && clock.flagged(turn)) {
+    timeOut = true;
+    clock.stop();
+    stopPonder();
+    engine.stop();
+    engineSearchId = 0;
+    std::cout << std::endl
+              << (turn ? "Black" : "White") << " ran out of time!"
+              << std::endl;
+    reportPonder();
+  }
+  // the title only changes when a displayed digit does
+  std::string title = "Chess Game   White " +
+                      formatClock(clock.remainingMs(false)) + "   Black " +
+                      formatClock(clock.remainingMs(true));
+  if (gameIndex.isOpen()) {
+    if (board.getPositionKey() != indexedKey) {
+      const positionPosting* first;
+      indexedKey = board.getPositionKey();
+      indexedGames = gameIndex.find(indexedKey, first);
+    }
+    title += "   in " + std::to_string(indexedGames) + " of " +
+             std::to_string(gameIndex.gameCount()) + " games";
+  }
+  if (title != shownTitle) {
+    window.setTitle(title);
+    shownTitle = title;
+  }
+}
+
+void Game::useAnalysisCache(const std::string& path) {
+  engine.openCache(path);
+}
+
+bool Game::useGameIndex(const std::string& path) {
+  if (!gameIndex.open(path)) {
+    return false;
+  }
+  indexedKey = 0;
+  std::cout << path << ": " << gameIndex.gameCount() << " games, "
+            << gameIndex.keyCount() << " positions" << std::endl;
+  return true;
+}
+
+void Game::listIndexedGames() {
+  if (!gameIndex.isOpen()) {
+    std::cout << "no games database, start with --index file" << std::endl;
+    return;
+  }
+  const positionPosting* first;
+  std::size_t count = gameIndex.find(board.getPositionKey(), first);
+  std::cout << count << " games reached this position" << std::endl;
+  for (std::size_t i = 0; i < count && i < 20; ++i) {
+    std::cout << "  " << gameIndex.gameLabel(first[i].game) << ", move "
+              << first[i].ply / 2 + 1 << std::endl;
+  }
+  if (count > 20) {
+    std::cout << "  and " << count - 20 << " more" << std::endl;
+  }
+}
+
+void Game::startAnalysis() {
+  if (!analysisMode || turn == engineSide ||
+      board.getStatus() != GameStatus::Ongoing) {
+    return;
+  }
+  SearchLimits limits;  // no time limit, runs until the position changes
+  limits.reportIntervalMs = 100;
+  limits.multiPv = analysisLines;
+  engineSearchId = engine.think(limits);
+}
+
+void Game::pollEngine() {
+  EngineResult result;
+  while (engine.pollResult(result)) {
+    if (result.searchId != engineSearchId) {
+      continue;  // left over from an old search
+    }
+    if (!result.isFinal) {
+      if (analysisMode && result.info.completed) {
+        for (std::size_t i = 0; i < result.info.lines.size(); ++i) {
+          std::cout << "depth " << result.info.depth << " multipv " << i + 1
+                    << " score " << result.info.lines[i].score << " pv";
+          for (const moveType& move : result.info.lines[i].pv) {
+            std::cout << " " << moveToText(move);
+          }
+          std::cout << std::endl;
+        }
+      }
+      if (!result.info.pv.empty()) {
+        analysis = result.info;
+      }
+      continue;
+    }
+    engineSearchId = 0;
+    if (turn != engineSide || timeOut || result.bestMove.from < 0) {
+      continue;
+    }
+    board.makeMove(result.bestMove);
+    syncSprites();
+    nextTurn(result.bestMove);
+    startPonder(result.ponderMove);
+  }
+}
+
+void Game::startPonder(const moveType& expected) {
+  if (!ponderEnabled || analysisMode || engineSide == -1 ||
+      turn == engineSide || timeOut || expected.from < 0 ||
+      board.getStatus() != GameStatus::Ongoing) {
+    return;
+  }
+  Board expectedBoard = board;
+  expectedBoard.makeMove(expected);
+  engine.newPosition(expectedBoard);
+  // the engine's clock doesn't run while we think, so what it has now is
+  // what it'll have when we move
+  SearchLimits limits = engineLimits;
+  limits.timeLeftMs = std::max(1, clock.remainingMs(engineSide));
+  limits.incrementMs = clock.getIncrementMs();
+  limits.ponder = true;
+  engineSearchId = engine.think(limits);
+  pondering = true;
+  ponderMove = expected;
+  ponderStart = std::chrono::steady_clock::now();
+}
+
+void Game::stopPonder() {
+  if (!pondering) {
+    return;
+  }
+  pondering = false;
+  engine.stop();
+  engineSearchId = 0;
+  engine.newPosition(board);
+}
+
+void Game::reportPonder() {
+  int ponders = ponderHits + ponderMisses;
+  if (ponders > 0) {
+    std::cout << "pondering: guessed " << ponderHits << " of " << ponders
+              << " replies (" << 100 * ponderHits / ponders << "%), "
+              << std::fixed << std::setprecision(1) << ponderSavedMs / 1000
+              << " s of search done on your time" << std::defaultfloat
+              << std::endl;
+  }
+  ponderHits = ponderMisses = 0;
+  ponderSavedMs = 0;
 }
 
 void Game::summonStartingSprites() {
   float scale = 100.0 / 333;
-  int coordMult = 100;
   sprite[0].setScale(1 / 2.4, 1 / 2.4);
   for (int i = 1; i < sprite.size(); ++i) {
     sprite[i].setScale(scale,
                        scale);  // loop that sets all sprites to proper scale
   }
 
+  syncSprites();
+  sprite[33].setPosition(1000, 1000);
+  sprite[34].setPosition(1000, 1000);
+}
+
+void Game::syncSprites() {
+  // sprites 1-32 are the pieces, texture index is piece type for white and
+  // piece type + 6 for black
   int j = 1;
-  for (int k = 0; k < 8; ++k) {
-    sprite[j].setPosition(k * coordMult, 6 * coordMult);
+  for (int i = 0; i < 64; ++i) {
+    int id = board.getPiece(i);
+    if (!id) {
+      continue;
+    }
+    sprite[j].setTexture(texture[id % 8 + (id / 8) * 6]);
+    sprite[j].setPosition((i % 8) * 100.f, (i / 8) * 100.f);
     j++;
   }
-
-  sprite[j].setPosition(0 * coordMult, 7 * coordMult);
-  j++;
-  sprite[j].setPosition(7 * coordMult, 7 * coordMult);
-  j++;
-
-  sprite[j].setPosition(1 * coordMult, 7 * coordMult);
-  j++;
-  sprite[j].setPosition(6 * coordMult, 7 * coordMult);
-  j++;
-  sprite[j].setPosition(2 * coordMult, 7 * coordMult);
-  j++;
-  sprite[j].setPosition(5 * coordMult, 7 * coordMult);
-  j++;
-  sprite[j].setPosition(3 * coordMult, 7 * coordMult);
-  j++;
-  sprite[j].setPosition(4 * coordMult, 7 * coordMult);
-  j++;
-  for (int k = 0; k < 8; ++k) {
-    sprite[j].setPosition(k * coordMult, 1 * coordMult);
-    j++;
+  for (; j < 33; ++j) {  // captured pieces get parked off the board
+    sprite[j].setPosition(1000, 1000);
   }
-  sprite[j].setPosition(0 * coordMult, 0 * coordMult);
-  j++;
-  sprite[j].setPosition(7 * coordMult, 0 * coordMult);
-  j++;
-  sprite[j].setPosition(1 * coordMult, 0 * coordMult);
-  j++;
-  sprite[j].setPosition(6 * coordMult, 0 * coordMult);
-  j++;
-  sprite[j].setPosition(2 * coordMult, 0 * coordMult);
-  j++;
-  sprite[j].setPosition(5 * coordMult, 0 * coordMult);
-  j++;
-  sprite[j].setPosition(3 * coordMult, 0 * coordMult);
-  j++;
-  sprite[j].setPosition(4 * coordMult, 0 * coordMult);
-  sprite[33].setPosition(1000, 1000);
-  sprite[34].setPosition(1000, 1000);
 }
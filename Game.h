@@ -5,11 +5,24 @@
 #include <SFML/Graphics.hpp>
 #include <SFML/Window/Event.hpp>
 #include <array>
+#include <chrono>
+#include <string>
+#include <vector>
 
 #include "Board.h"
+#include "ChessClock.h"
+#include "Engine.h"
+#include "GameRecord.h"
+#include "PositionIndex.h"
 
 class Game {
  private:
+  // startup timing, printed once the first frame is up
+  std::chrono::steady_clock::time_point launchTime;
+  double imagesMs = 0;  // decoding and uploading the textures
+  bool firstFrameShown = false;
+  //
+
   sf::RenderWindow window;
   std::array<sf::Texture, 15> texture;
   std::array<sf::Sprite, 35> sprite;
@@ -24,33 +37,95 @@ class Game {
 
   // stuff for pawn promotion
   bool isPromoting = false;
-  int promotingPieceId = 0;
-  int promotingPieceIndex;
+  moveType promotingMove{-1, -1, 0};
   sf::Sprite* promotingPieceSprite = nullptr;
-  int pieceTaken = 0;
+  //
+
+  // engine opponent, searches on its own thread
+  Engine engine;
+  SearchLimits engineLimits;
+  int engineSide = -1;  // -1 when off, otherwise the colour it plays
+  unsigned engineSearchId = 0;  // id of the search we're waiting on
+  bool analysisMode = false;  // keep searching and draw what the engine sees
+  SearchInfo analysis;        // latest report from the running search
+  int analysisLines = 1;      // multipv for the analysis, M cycles it
+  //
+
+  // pondering: after its move the engine searches the reply its pv expects
+  // while we think. playing that reply turns the search into the real one,
+  // anything else stops it and starts again on the right position (the table
+  // keeps what it found). O switches it off and on
+  bool ponderEnabled = true;
+  bool pondering = false;
+  moveType ponderMove{-1, -1, 0};
+  std::chrono::steady_clock::time_point ponderStart;
+  int ponderHits = 0;  // this game
+  int ponderMisses = 0;
+  double ponderSavedMs = 0;  // searched on our time for the replies it got
+  //
+
+  // the game so far. the board shows the position at viewPly, and making a
+  // move from an earlier ply throws away everything after it (that's how
+  // takebacks work). the strip under the board scrubs through it and F plays
+  // it forward from where the board is
+  GameRecord record;
+  int viewPly = 0;
+  bool isScrubbing = false;  // dragging along the strip
+  bool isPlayingBack = false;
+  sf::Clock playbackClock;  // time since playback last stepped
+  int playbackIntervalMs = 150;
+  //
+
+  // games database (--index). the title bar says how many of its games
+  // reached the position on the board and G lists them in the terminal
+  PositionIndex gameIndex;
+  std::uint64_t indexedKey = 0;  // position indexedGames was looked up for
+  std::size_t indexedGames = 0;
+  //
+
+  // game clock, shown in the title bar. it only runs while we're on the
+  // latest position
+  ChessClock clock{300000, 2000};
+  bool timeOut = false;  // someone's flag fell, the game is over
+  std::string shownTitle;
   //
 
  public:
-  Game();
+  explicit Game(std::chrono::steady_clock::time_point launchTime =
+                    std::chrono::steady_clock::now());
   void run();
   void loadSprites();
+  void useAnalysisCache(const std::string& path);  // engine table lives in
+                                                   // this file between runs
+  bool useGameIndex(const std::string& path);  // made by chess_index
+  void listIndexedGames();  // the games that reached the board's position
   void deleteSprites();
   void summonStartingSprites();
-  void movePiece();
-  void undoPromotion(int row, int col);
+  void syncSprites();  // puts a sprite on every occupied square of the board
+  void undoPromotion();
   void takeNonPromotingPiece(int row, int col,
                              sf::Sprite* promotingPieceSprite);
   void choosePromotionPiece(sf::Event& event);
-  void checkPawnMove(int prevIndex, int newIndex);
   void handleDragAndDrop(sf::Event& Event);
   void handleMouseClick(sf::Event& event);
+  void handleKeyPress(sf::Event& event);
   void dropPiece();
   void updateDragPosition();
   void lightValidSquares(std::vector<moveType>& moves);
-  void takePiece(int row, int col);
-  void castling(int row, int col);
-  void takingEnPassant(int row, int col);
-  void nextTurn();
+  void nextTurn(const moveType& move);  // move is the one just played
+  void showPly(int ply);  // jumps the board to any position in the record
+  bool handleScrubber(sf::Event& event);  // true if the event was for it
+  void drawScrubber();
+  void updatePlayback();  // steps forward while F playback is on
+  void updateClock();  // checks for a flag fall and redraws the times
+  void startEngineSearch();
+  void startAnalysis();
+  void drawAnalysis();
+  void drawArrow(int from, int to, sf::Color colour, float thickness);
+  void pollEngine();  // picks up the engine's move once it's ready
+  void startPonder(const moveType& expected);
+  void stopPonder();  // drops a ponder search without counting it
+  void reportPonder();  // hit rate and time saved, at the end of a game
 };
 
 #endif  // GAME_H
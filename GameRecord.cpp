@@ -0,0 +1,55 @@
+#include "GameRecord.h"
+
+#include <algorithm>
+
+GameRecord::GameRecord(int checkpointInterval)
+    : checkpointInterval(std::max(1, checkpointInterval)) {
+  reset(Board());
+}
+
+void GameRecord::reset(const Board& start) {
+  moves.clear();
+  keys.assign(1, start.getPositionKey());
+  checkpoints.assign(1, start.snapshot());
+}
+
+void GameRecord::truncate(int ply) {
+  ply = std::clamp(ply, 0, plyCount());
+  moves.resize(ply);
+  keys.resize(ply + 1);
+  checkpoints.resize(ply / checkpointInterval + 1);
+}
+
+void GameRecord::push(const moveType& move, const Board& after) {
+  moves.push_back(move);
+  keys.push_back(after.getPositionKey());
+  if (plyCount() % checkpointInterval == 0) {
+    checkpoints.push_back(after.snapshot());
+  }
+}
+
+void GameRecord::seek(int ply, Board& board) const {
+  ply = std::clamp(ply, 0, plyCount());
+  int checkpoint = ply / checkpointInterval;
+  int checkpointPly = checkpoint * checkpointInterval;
+  std::vector<std::uint64_t> earlierKeys(keys.begin(),
+                                         keys.begin() + checkpointPly);
+  board.restore(checkpoints[checkpoint], earlierKeys);
+  // makeMove keeps the key history going from here, so repetitions come out
+  // the same as when the game was played
+  for (int i = checkpointPly; i < ply; ++i) {
+    board.makeMove(moves[i]);
+  }
+}
+
+int GameRecord::plyCount() const { return static_cast<int>(moves.size()); }
+
+int GameRecord::getCheckpointInterval() const { return checkpointInterval; }
+
+const std::vector<moveType>& GameRecord::getMoves() const { return moves; }
+
+std::size_t GameRecord::memoryBytes() const {
+  return moves.size() * sizeof(moveType) +
+         keys.size() * sizeof(std::uint64_t) +
+         checkpoints.size() * sizeof(positionSnapshot);
+}
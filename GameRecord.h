@@ -0,0 +1,37 @@
+#ifndef GAMERECORD_H
+#define GAMERECORD_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Board.h"
+
+// a game as its moves plus a position snapshot every checkpointInterval
+// plies. going to any ply restores the checkpoint at or before it and plays
+// at most checkpointInterval - 1 moves on from there, so seeking costs the
+// same at ply 300 as at ply 3 without keeping a snapshot for every ply
+class GameRecord {
+ private:
+  int checkpointInterval;
+  std::vector<moveType> moves;      // moves[i] is played at ply i
+  std::vector<std::uint64_t> keys;  // key of every position, by ply
+  std::vector<positionSnapshot>
+      checkpoints;  // at ply 0, checkpointInterval, 2 * checkpointInterval..
+
+ public:
+  explicit GameRecord(int checkpointInterval = 16);
+
+  void reset(const Board& start);  // a new game from this position
+  void truncate(int ply);  // forgets everything after ply, for a takeback or
+                           // a new line from an earlier position
+  void push(const moveType& move,
+            const Board& after);  // after is the position the move led to
+  void seek(int ply, Board& board) const;  // puts board at ply, with the
+                                           // earlier keys for repetitions
+  int plyCount() const;  // moves played, the last ply is this
+  int getCheckpointInterval() const;
+  const std::vector<moveType>& getMoves() const;
+  std::size_t memoryBytes() const;  // what the record keeps, roughly
+};
+
+#endif  // GAMERECORD_H
@@ -0,0 +1,253 @@
+#include "MateSolver.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+constexpr std::uint32_t INFINITE_PN = 100000000;  // proven or disproven.
+                                                 // small enough that adding
+                                                 // two never overflows
+constexpr int BUCKET_SIZE = 4;
+
+std::uint64_t tableKey(const Board& position, int plies) {
+  return position.getPositionKey() ^
+         (static_cast<std::uint64_t>(plies) * 0x9E3779B97F4A7C15ULL);
+}
+
+int moveCount(const Board& position) {
+  int count = 0;
+  for (const pieceMoves& piece : position.getAllLegalMoves()) {
+    count += static_cast<int>(piece.moves.size());
+  }
+  return count;
+}
+
+}  // namespace
+
+MateSolver::MateSolver(std::size_t megabytes) {
+  std::size_t count = megabytes * 1024 * 1024 / sizeof(pnEntry);
+  std::size_t powerOfTwo = BUCKET_SIZE;
+  while (powerOfTwo * 2 <= count) {
+    powerOfTwo *= 2;
+  }
+  table.assign(powerOfTwo, pnEntry{});
+}
+
+MateSolver::pnValue MateSolver::lookup(const Board& position, int plies,
+                                       bool attacker) const {
+  std::uint64_t key = tableKey(position, plies);
+  std::size_t bucket = key & (table.size() - 1) & ~std::size_t(BUCKET_SIZE - 1);
+  for (int i = 0; i < BUCKET_SIZE; ++i) {
+    const pnEntry& entry = table[bucket + i];
+    if (entry.key == key && entry.plies == plies) {
+      return {entry.phi, entry.delta};
+    }
+  }
+
+  // not searched yet, work out what we can from the position itself
+  int count = moveCount(position);
+  if (count == 0) {
+    if (position.kingInCheck()) {
+      return {INFINITE_PN, 0};  // mated
+    }
+    // stalemate is as good as a win for the defender
+    return attacker ? pnValue{INFINITE_PN, 0} : pnValue{0, INFINITE_PN};
+  }
+  if (plies == 0) {
+    return attacker ? pnValue{INFINITE_PN, 0} : pnValue{0, INFINITE_PN};
+  }
+  // every defender reply has to be refuted, so a node with more of them is
+  // further from a proof (the df-pn+ starting guess)
+  return attacker ? pnValue{1, 1}
+                  : pnValue{1, static_cast<std::uint32_t>(count)};
+}
+
+void MateSolver::store(const Board& position, int plies, pnValue value,
+                       std::uint32_t work) {
+  std::uint64_t key = tableKey(position, plies);
+  std::size_t bucket = key & (table.size() - 1) & ~std::size_t(BUCKET_SIZE - 1);
+  pnEntry* slot = &table[bucket];
+  for (int i = 0; i < BUCKET_SIZE; ++i) {
+    pnEntry& entry = table[bucket + i];
+    if (entry.key == key && entry.plies == plies) {
+      slot = &entry;
+      break;
+    }
+    if (entry.plies < 0 || entry.work < slot->work) {
+      slot = &entry;  // empty, or cheaper to redo than the last pick
+    }
+  }
+  slot->key = key;
+  slot->phi = value.phi;
+  slot->delta = value.delta;
+  slot->work = work;
+  slot->plies = static_cast<std::int16_t>(plies);
+}
+
+MateSolver::pnValue MateSolver::mid(const Board& position, int plies,
+                                    bool attacker, std::uint32_t thresholdPhi,
+                                    std::uint32_t thresholdDelta) {
+  long long startNodes = nodes;
+  if (++nodes == nodeLimit) {
+    aborted = true;
+  }
+
+  std::vector<Board> children;
+  for (const moveType& move : position.getMoveList()) {
+    Board child = position;
+    child.makeMove(move);
+    if (attacker && checksOnly && !child.kingInCheck()) {
+      continue;
+    }
+    children.push_back(child);
+  }
+  std::vector<pnValue> values;
+  values.reserve(children.size());
+  for (const Board& child : children) {
+    values.push_back(lookup(child, plies - 1, !attacker));
+  }
+
+  pnValue value{INFINITE_PN, 0};  // the attacker has run out of checks
+  while (!children.empty()) {
+    // we win if any child loses (smallest delta), and lose only once every
+    // child wins (sum of phi)
+    value = {INFINITE_PN, 0};
+    std::size_t best = 0;
+    std::uint32_t secondDelta = INFINITE_PN;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      if (values[i].delta < value.phi) {
+        secondDelta = value.phi;
+        value.phi = values[i].delta;
+        best = i;
+      } else if (values[i].delta < secondDelta) {
+        secondDelta = values[i].delta;
+      }
+      value.delta = std::min(INFINITE_PN, value.delta + values[i].phi);
+    }
+    if (value.phi >= thresholdPhi || value.delta >= thresholdDelta ||
+        aborted) {
+      break;
+    }
+    // the child may use the slack we have left, and should come back once
+    // it's no longer clearly the best one
+    std::uint64_t childPhi = static_cast<std::uint64_t>(thresholdDelta) -
+                             value.delta + values[best].phi;
+    std::uint64_t childDelta =
+        std::min<std::uint64_t>(thresholdPhi, secondDelta + 1ULL);
+    values[best] = mid(children[best], plies - 1, !attacker,
+                       static_cast<std::uint32_t>(
+                           std::min<std::uint64_t>(childPhi, INFINITE_PN)),
+                       static_cast<std::uint32_t>(childDelta));
+  }
+  store(position, plies, value, static_cast<std::uint32_t>(nodes - startNodes));
+  return value;
+}
+
+MateSolver::pnValue MateSolver::prove(const Board& position, int plies,
+                                      bool attacker) {
+  pnValue value = lookup(position, plies, attacker);
+  if (value.phi == 0 || value.delta == 0) {
+    return value;
+  }
+  return mid(position, plies, attacker, INFINITE_PN, INFINITE_PN);
+}
+
+int MateSolver::shortestMate(const Board& position, int maxPlies) {
+  for (int plies = 1; plies <= maxPlies; plies += 2) {
+    pnValue value = prove(position, plies, true);
+    if (aborted) {
+      return -1;
+    }
+    if (value.phi == 0) {
+      return plies;
+    }
+  }
+  return -1;
+}
+
+std::vector<moveType> MateSolver::mateLine(const Board& root, int plies) {
+  // the attacker plays any move that still mates in time, the defender the
+  // reply that holds out longest
+  std::vector<moveType> line;
+  Board position = root;
+  bool attacker = true;
+  while (plies > 0) {
+    std::vector<moveType> moves = position.getMoveList();
+    if (moves.empty()) {
+      break;
+    }
+    moveType chosen = moves[0];
+    if (attacker) {
+      for (const moveType& move : moves) {
+        Board child = position;
+        child.makeMove(move);
+        if (checksOnly && !child.kingInCheck()) {
+          continue;
+        }
+        if (prove(child, plies - 1, false).delta == 0) {
+          chosen = move;
+          break;
+        }
+      }
+    } else {
+      int longest = -1;
+      for (const moveType& move : moves) {
+        Board child = position;
+        child.makeMove(move);
+        int mate = shortestMate(child, plies - 1);
+        if (mate > longest) {
+          longest = mate;
+          chosen = move;
+        }
+      }
+      plies = longest + 1;
+    }
+    position.makeMove(chosen);
+    line.push_back(chosen);
+    --plies;
+    attacker = !attacker;
+  }
+  return line;
+}
+
+MateResult MateSolver::solve(const Board& root, const MateLimits& limits) {
+  auto start = std::chrono::steady_clock::now();
+  if (checksOnly != limits.checksOnly) {
+    // entries from the other mode would prove or disprove the wrong thing
+    table.assign(table.size(), pnEntry{});
+    checksOnly = limits.checksOnly;
+  }
+  nodes = 0;
+  nodeLimit = limits.nodes;
+  aborted = false;
+
+  MateResult result;
+  result.status = MateStatus::Disproven;
+  if (root.getStatus() == GameStatus::Ongoing) {
+    // one more move at a time, so the first proof is the shortest mate
+    for (int plies = 1; plies <= 2 * limits.moves - 1; plies += 2) {
+      pnValue value = prove(root, plies, true);
+      if (aborted) {
+        result.status = MateStatus::Unknown;
+        break;
+      }
+      if (value.phi == 0) {
+        result.status = MateStatus::Proven;
+        result.mateIn = (plies + 1) / 2;
+        result.nodes = nodes;
+        nodeLimit = 0;  // the line is only a few more proofs
+        result.line = mateLine(root, plies);
+        break;
+      }
+    }
+  }
+  if (result.status != MateStatus::Proven) {
+    result.nodes = nodes;
+  }
+  result.timeMs = static_cast<int>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count());
+  return result;
+}
@@ -0,0 +1,71 @@
+#ifndef MATESOLVER_H
+#define MATESOLVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Board.h"
+
+struct MateLimits {
+  int moves = 5;          // longest mate to look for, in moves of the attacker
+  long long nodes = 0;    // 0 means no node limit
+  bool checksOnly = true;  // attacker only tries checks. much faster, but
+                           // misses mates that start with a quiet move
+};
+enum class MateStatus {
+  Proven,     // the side to move mates within the limit
+  Disproven,  // no forced mate within the limit
+  Unknown     // ran out of nodes first
+};
+struct MateResult {
+  MateStatus status = MateStatus::Unknown;
+  int mateIn = 0;  // moves, when proven
+  std::vector<moveType> line;  // shortest mate against the longest defence
+  long long nodes = 0;
+  int timeMs = 0;
+};
+struct pnEntry {
+  std::uint64_t key = 0;
+  std::uint32_t phi = 0;    // proof number of the side to move
+  std::uint32_t delta = 0;  // its disproof number
+  std::uint32_t work = 0;   // nodes it took, the cheapest entry goes first
+  std::int16_t plies = -1;  // plies left when it was stored, -1 when empty
+};
+
+// proves forced mates with depth-first proof-number search (df-pn). the
+// numbers count how many more leaves have to be settled to prove or disprove
+// a node, and the search always expands the most proving one it can afford
+// under its thresholds. phi and delta are proof and disproof numbers from the
+// point of view of the side to move, so the same code handles both sides.
+// positions are keyed together with the plies left, so results from
+// different depths never mix and the search graph has no cycles
+class MateSolver {
+ private:
+  struct pnValue {
+    std::uint32_t phi;
+    std::uint32_t delta;
+  };
+
+  std::vector<pnEntry> table;  // fixed size, old entries get overwritten
+  long long nodes = 0;
+  long long nodeLimit = 0;
+  bool checksOnly = true;
+  bool aborted = false;
+
+  pnValue mid(const Board& position, int plies, bool attacker,
+              std::uint32_t thresholdPhi, std::uint32_t thresholdDelta);
+  pnValue lookup(const Board& position, int plies, bool attacker) const;
+  pnValue prove(const Board& position, int plies, bool attacker);
+  void store(const Board& position, int plies, pnValue value,
+             std::uint32_t work);
+  int shortestMate(const Board& position, int maxPlies);  // plies, -1 if
+                                                          // there isn't one
+  std::vector<moveType> mateLine(const Board& root, int plies);
+
+ public:
+  explicit MateSolver(std::size_t megabytes = 16);
+  MateResult solve(const Board& root, const MateLimits& limits);
+};
+
+#endif  // MATESOLVER_H
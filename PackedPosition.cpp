@@ -0,0 +1,84 @@
+#include "PackedPosition.h"
+
+#include <cctype>
+#include <string>
+
+packedPosition packPosition(const Board& board) {
+  packedPosition packed{};
+  int count = 0;
+  for (int i = 0; i < 64; ++i) {
+    int id = board.getPiece(i);
+    if (!id) {
+      continue;
+    }
+    packed.occupancy |= 1ULL << i;
+    packed.pieces[count / 2] |= id << (count % 2 * 4);
+    count++;
+  }
+  packed.flags = board.isBlackToMove();
+  for (int right = 0; right < 4; ++right) {
+    packed.flags |= board.canCastleSide(right) << (right + 1);
+  }
+  packed.enPassantFile = board.getEnPassantFile();
+  packed.halfmoveClock = board.getHalfmoveClock();
+  packed.fullmoveNumber = board.getFullmoveNumber();
+  return packed;
+}
+
+std::array<int, 64> unpackSquares(const packedPosition& packed) {
+  std::array<int, 64> squares{};
+  int count = 0;
+  for (int i = 0; i < 64; ++i) {
+    if (packed.occupancy >> i & 1) {
+      squares[i] = packed.pieces[count / 2] >> (count % 2 * 4) & 15;
+      count++;
+    }
+  }
+  return squares;
+}
+
+bool isBlackToMove(const packedPosition& packed) { return packed.flags & 1; }
+
+bool unpackPosition(const packedPosition& packed, Board& board) {
+  // goes through fen so the board sets itself up the same way it always does
+  const std::string pieceLetters = " PRNBQK";
+  std::array<int, 64> squares = unpackSquares(packed);
+  std::string fen;
+  for (int rank = 0; rank < 8; ++rank) {
+    int empty = 0;
+    for (int file = 0; file < 8; ++file) {
+      int id = squares[rank * 8 + file];
+      if (!id) {
+        empty++;
+        continue;
+      }
+      if (empty) {
+        fen += std::to_string(empty);
+        empty = 0;
+      }
+      char letter = pieceLetters[id % 8];
+      fen += id / 8 ? static_cast<char>(std::tolower(letter)) : letter;
+    }
+    if (empty) {
+      fen += std::to_string(empty);
+    }
+    fen += rank < 7 ? '/' : ' ';
+  }
+  fen += isBlackToMove(packed) ? "b " : "w ";
+  std::string castling;
+  if (packed.flags >> 4 & 1) castling += 'K';
+  if (packed.flags >> 3 & 1) castling += 'Q';
+  if (packed.flags >> 2 & 1) castling += 'k';
+  if (packed.flags >> 1 & 1) castling += 'q';
+  fen += castling.empty() ? "-" : castling;
+  if (packed.enPassantFile < 0 || packed.enPassantFile > 7) {
+    fen += " -";
+  } else {
+    fen += ' ';
+    fen += static_cast<char>('a' + packed.enPassantFile);
+    fen += isBlackToMove(packed) ? '3' : '6';
+  }
+  fen += ' ' + std::to_string(packed.halfmoveClock) + ' ' +
+         std::to_string(packed.fullmoveNumber);
+  return board.loadFen(fen);
+}
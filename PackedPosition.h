@@ -0,0 +1,28 @@
+#ifndef PACKEDPOSITION_H
+#define PACKEDPOSITION_H
+
+#include <array>
+#include <cstdint>
+
+#include "Board.h"
+
+struct packedPosition {  // a whole position in 32 bytes, for datasets
+  std::uint64_t occupancy;  // bit i set if square i (0 is a8) has a piece
+  std::array<std::uint8_t, 16>
+      pieces;  // piece ids two to a byte (low nibble first), in the order of
+               // the occupied squares
+  std::uint8_t flags;  // bit 0 black to move, bits 1-4 castleRights
+  std::int8_t enPassantFile;
+  std::uint16_t halfmoveClock;
+  std::uint16_t fullmoveNumber;
+};
+static_assert(sizeof(packedPosition) == 32, "packedPosition should be 32 bytes");
+
+packedPosition packPosition(const Board& board);
+std::array<int, 64> unpackSquares(const packedPosition& packed);
+bool unpackPosition(const packedPosition& packed,
+                    Board& board);  // returns false if the position isn't
+                                    // one loadFen accepts
+bool isBlackToMove(const packedPosition& packed);
+
+#endif  // PACKEDPOSITION_H
@@ -0,0 +1,81 @@
+#include "Perft.h"
+
+#include <atomic>
+
+#include "TaskScheduler.h"
+
+namespace {
+
+void perftTask(TaskGroup& group, const Board& position, int depth,
+               int splitDepth, std::atomic<long long>& nodes) {
+  if (depth <= splitDepth) {
+    nodes.fetch_add(perft(position, depth), std::memory_order_relaxed);
+    return;
+  }
+  for (const moveType& move : position.getMoveList()) {
+    Board child = position;
+    child.makeMove(move);
+    group.run([&group, child, depth, splitDepth, &nodes]() {
+      perftTask(group, child, depth - 1, splitDepth, nodes);
+    });
+  }
+}
+
+}  // namespace
+
+long long perft(const Board& position, int depth) {
+  if (depth <= 0) {
+    return 1;
+  }
+  std::vector<moveType> moves = position.getMoveList();
+  if (depth == 1) {
+    return static_cast<long long>(moves.size());
+  }
+  long long nodes = 0;
+  for (const moveType& move : moves) {
+    Board child = position;
+    child.makeMove(move);
+    nodes += perft(child, depth - 1);
+  }
+  return nodes;
+}
+
+std::vector<std::pair<moveType, long long>> perftDivide(const Board& position,
+                                                        int depth) {
+  std::vector<std::pair<moveType, long long>> counts;
+  for (const moveType& move : position.getMoveList()) {
+    Board child = position;
+    child.makeMove(move);
+    counts.emplace_back(move, perft(child, depth - 1));
+  }
+  return counts;
+}
+
+long long perft(const Board& position, int depth, TaskScheduler& scheduler,
+                int splitDepth) {
+  std::atomic<long long> nodes{0};
+  TaskGroup group(scheduler);
+  perftTask(group, position, depth, splitDepth, nodes);
+  group.wait();
+  return nodes;
+}
+
+std::vector<std::pair<moveType, long long>> perftDivide(
+    const Board& position, int depth, TaskScheduler& scheduler,
+    int splitDepth) {
+  std::vector<moveType> moves = position.getMoveList();
+  std::vector<std::atomic<long long>> counts(moves.size());
+  TaskGroup group(scheduler);
+  for (std::size_t i = 0; i < moves.size(); ++i) {
+    Board child = position;
+    child.makeMove(moves[i]);
+    counts[i] = 0;
+    perftTask(group, child, depth - 1, splitDepth, counts[i]);
+  }
+  group.wait();
+  std::vector<std::pair<moveType, long long>> result;
+  for (std::size_t i = 0; i < moves.size(); ++i) {
+    result.emplace_back(moves[i], counts[i].load());
+  }
+  return result;
+}
@@ -0,0 +1,29 @@
+#ifndef PERFT_H
+#define PERFT_H
+
+#include <utility>
+#include <vector>
+
+#include "Board.h"
+
+class TaskScheduler;
+
+// counts the leaf nodes of the legal move tree, the standard way to check a
+// move generator against known numbers
+long long perft(const Board& position, int depth);
+
+// perft for each root move separately, handy for tracking down a wrong count
+std::vector<std::pair<moveType, long long>> perftDivide(const Board& position,
+                                                        int depth);
+
+// the same counts spread over a TaskScheduler's workers. every move down to
+// splitDepth plies from the leaves is a task of its own, so a root move with
+// a far bigger tree than the rest is shared out instead of leaving one thread
+// with most of the work
+long long perft(const Board& position, int depth, TaskScheduler& scheduler,
+                int splitDepth = 3);
+std::vector<std::pair<moveType, long long>> perftDivide(
+    const Board& position, int depth, TaskScheduler& scheduler,
+    int splitDepth = 3);
+
+#endif  // PERFT_H
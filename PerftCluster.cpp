@@ -0,0 +1,467 @@
+#include "PerftCluster.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+#include "Perft.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct perftUnit {
+  std::string fen;
+  int depth;
+  long long weight;  // lines of the split that reach it
+  int rootMove;      // index into the root's getMoveList
+};
+
+// the fen without the move clocks, which perft doesn't care about
+std::string positionPart(const std::string& fen) {
+  std::size_t end = 0;
+  for (int field = 0; field < 4 && end != std::string::npos; ++field) {
+    end = fen.find(' ', end + (field > 0));
+  }
+  return fen.substr(0, end);
+}
+
+void splitTree(const Board& position, int plies, int depth, int rootMove,
+               std::unordered_map<std::string, std::size_t>& seen,
+               std::vector<perftUnit>& units, long long& lines) {
+  if (plies == 0) {
+    lines++;
+    std::string fen = position.toFen();
+    std::string key = std::to_string(rootMove) + " " + positionPart(fen);
+    auto found = seen.find(key);
+    if (found != seen.end()) {
+      units[found->second].weight++;
+      return;
+    }
+    seen.emplace(key, units.size());
+    units.push_back({fen, depth, 1, rootMove});
+    return;
+  }
+  std::vector<moveType> moves = position.getMoveList();
+  for (std::size_t i = 0; i < moves.size(); ++i) {
+    Board child = position;
+    child.makeMove(moves[i]);
+    splitTree(child, plies - 1, depth - 1,
+              rootMove < 0 ? static_cast<int>(i) : rootMove, seen, units,
+              lines);
+  }
+}
+
+std::vector<perftUnit> split(const Board& position, int depth, int plies,
+                             long long& lines) {
+  std::unordered_map<std::string, std::size_t> seen;
+  std::vector<perftUnit> units;
+  lines = 0;
+  splitTree(position, plies, depth, -1, seen, units, lines);
+  return units;
+}
+
+bool sendLine(int fd, const std::string& line) {
+  std::string text = line + "\n";
+  std::size_t sent = 0;
+  while (sent < text.size()) {
+    ssize_t result =
+        send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+    if (result <= 0) {
+      return false;
+    }
+    sent += static_cast<std::size_t>(result);
+  }
+  return true;
+}
+
+// takes the next whole line out of buffer, false if there isn't one yet
+bool takeLine(std::string& buffer, std::string& line) {
+  std::size_t end = buffer.find('\n');
+  if (end == std::string::npos) {
+    return false;
+  }
+  line = buffer.substr(0, end);
+  buffer.erase(0, end + 1);
+  return true;
+}
+
+struct workerConnection {
+  int fd;
+  std::string buffer;
+  int stats = -1;  // index into the result's workers once it said hello
+  int unit = -1;   // the one it's doing
+  bool timedOut = false;
+  Clock::time_point issuedAt;
+  Clock::time_point joined;
+};
+
+}  // namespace
+
+bool runPerftCoordinator(const Board& position, int depth,
+                         const perftClusterConfig& config,
+                         perftClusterResult& result) {
+  result = perftClusterResult();
+  auto start = Clock::now();
+  std::vector<moveType> rootMoves = position.getMoveList();
+  for (const moveType& move : rootMoves) {
+    result.divide.emplace_back(move, 0);
+  }
+  if (depth < 1 || rootMoves.empty()) {
+    result.nodes = depth < 1 ? 1 : 0;
+    return true;
+  }
+
+  // the shallowest split with at least 64 units a worker, not counting on
+  // more than four workers if they're coming from elsewhere. the units
+  // aren't anywhere near the same size, that's what the count evens out
+  std::vector<perftUnit> units;
+  if (config.splitDepth > 0) {
+    result.splitDepth = std::min(config.splitDepth, depth);
+    units = split(position, depth, result.splitDepth, result.splitLines);
+  } else {
+    std::size_t wanted =
+        64 * std::max(config.localWorkers + (config.remote ? 4 : 0), 1);
+    for (result.splitDepth = 1;; result.splitDepth++) {
+      units = split(position, depth, result.splitDepth, result.splitLines);
+      if (units.size() >= wanted || result.splitDepth >= depth - 1 ||
+          result.splitDepth >= 4) {
+        break;
+      }
+    }
+  }
+  result.units = static_cast<long long>(units.size());
+  result.splitSeconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  int yes = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(static_cast<std::uint16_t>(config.port));
+  address.sin_addr.s_addr = htonl(config.remote ? INADDR_ANY : INADDR_LOOPBACK);
+  socklen_t addressSize = sizeof(address);
+  if (listenFd < 0 ||
+      bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) !=
+          0 ||
+      listen(listenFd, 128) != 0 ||
+      getsockname(listenFd, reinterpret_cast<sockaddr*>(&address),
+                  &addressSize) != 0) {
+    std::cout << "couldn't listen on port " << config.port << ": "
+              << std::strerror(errno) << std::endl;
+    if (listenFd >= 0) {
+      close(listenFd);
+    }
+    return false;
+  }
+  int port = ntohs(address.sin_port);
+  if (config.localWorkers == 0) {
+    std::cout << "waiting for workers on port " << port << ", "
+              << units.size() << " units" << std::endl;
+  }
+
+  std::vector<pid_t> children;
+  std::cout.flush();  // or the children print it again
+  for (int i = 0; i < config.localWorkers; ++i) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      close(listenFd);
+      bool ok = runPerftWorker("127.0.0.1", port, config.stallEvery,
+                               2 * config.timeoutSeconds);
+      std::cout.flush();
+      _exit(ok ? 0 : 1);
+    }
+    if (pid < 0) {
+      std::cout << "couldn't start a worker: " << std::strerror(errno)
+                << std::endl;
+      break;
+    }
+    children.push_back(pid);
+  }
+  int childrenRunning = static_cast<int>(children.size());
+
+  std::vector<long long> counts(units.size(), -1);
+  std::vector<int> issues(units.size(), 0);
+  std::vector<bool> queued(units.size(), true);
+  std::deque<int> pending;
+  for (std::size_t i = 0; i < units.size(); ++i) {
+    pending.push_back(static_cast<int>(i));
+  }
+  std::size_t done = 0;
+  std::vector<workerConnection> connections;
+  auto timeout = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(config.timeoutSeconds));
+
+  auto requeue = [&](int unit) {
+    if (unit >= 0 && counts[unit] < 0 && !queued[unit]) {
+      pending.push_front(unit);
+      queued[unit] = true;
+    }
+  };
+  auto hangUp = [&](std::size_t i) {
+    workerConnection& connection = connections[i];
+    requeue(connection.unit);
+    if (connection.stats >= 0) {
+      result.workers[connection.stats].connectedSeconds =
+          std::chrono::duration<double>(Clock::now() - connection.joined)
+              .count();
+    }
+    close(connection.fd);
+    connections.erase(connections.begin() + static_cast<long>(i));
+  };
+  // false if the line made no sense
+  auto handleLine = [&](workerConnection& connection,
+                        const std::string& line) {
+    std::istringstream words(line);
+    std::string word;
+    words >> word;
+    if (word == "hello" && connection.stats < 0) {
+      std::string name;
+      words >> name;
+      connection.stats = static_cast<int>(result.workers.size());
+      connection.joined = Clock::now();
+      result.workers.emplace_back();
+      result.workers.back().name = name;
+      return true;
+    }
+    long long id = -1, nodes = -1, micros = -1;
+    words >> id >> nodes >> micros;
+    if (word != "done" || !words || connection.stats < 0 ||
+        id != connection.unit || nodes < 0) {
+      return false;
+    }
+    perftWorkerStats& stats = result.workers[connection.stats];
+    stats.nodes += nodes;
+    stats.busySeconds += micros / 1e6;
+    if (counts[id] < 0) {
+      counts[id] = nodes;
+      done++;
+      stats.units++;
+    } else {
+      stats.late++;
+    }
+    connection.unit = -1;
+    connection.timedOut = false;
+    return true;
+  };
+
+  bool ok = true;
+  while (done < units.size()) {
+    Clock::time_point now = Clock::now();
+    for (workerConnection& connection : connections) {
+      if (connection.stats < 0 || connection.unit >= 0) {
+        continue;
+      }
+      while (!pending.empty() && counts[pending.front()] >= 0) {
+        queued[pending.front()] = false;
+        pending.pop_front();
+      }
+      if (pending.empty()) {
+        break;
+      }
+      int unit = pending.front();
+      pending.pop_front();
+      queued[unit] = false;
+      if (issues[unit]++ > 0) {
+        result.reissued++;
+      }
+      connection.unit = unit;
+      connection.issuedAt = now;
+      // a failed send shows up as a hang up when it's next read
+      sendLine(connection.fd, "unit " + std::to_string(unit) + " " +
+                                  std::to_string(units[unit].depth) + " " +
+                                  units[unit].fen);
+    }
+
+    int waitMs = 1000;
+    for (const workerConnection& connection : connections) {
+      if (connection.unit >= 0 && !connection.timedOut) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            connection.issuedAt + timeout - now);
+        waitMs = std::max(0, std::min(waitMs, static_cast<int>(left.count()) +
+                                                  1));
+      }
+    }
+    std::vector<pollfd> polled(1 + connections.size());
+    polled[0] = {listenFd, POLLIN, 0};
+    for (std::size_t i = 0; i < connections.size(); ++i) {
+      polled[i + 1] = {connections[i].fd, POLLIN, 0};
+    }
+    if (poll(polled.data(), polled.size(), waitMs) < 0 && errno != EINTR) {
+      std::cout << "poll failed: " << std::strerror(errno) << std::endl;
+      ok = false;
+      break;
+    }
+
+    // newest last, so going backwards the erasing doesn't move the rest
+    for (std::size_t i = connections.size(); i-- > 0;) {
+      if (!(polled[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) {
+        continue;
+      }
+      char chunk[4096];
+      ssize_t count = recv(connections[i].fd, chunk, sizeof(chunk), 0);
+      if (count <= 0) {
+        hangUp(i);
+        continue;
+      }
+      connections[i].buffer.append(chunk, static_cast<std::size_t>(count));
+      std::string line;
+      bool sensible = true;
+      while (sensible && takeLine(connections[i].buffer, line)) {
+        sensible = handleLine(connections[i], line);
+      }
+      if (!sensible) {
+        std::cout << "dropping a worker that sent: " << line << std::endl;
+        hangUp(i);
+      }
+    }
+    if (polled[0].revents & POLLIN) {
+      int fd = accept(listenFd, nullptr, nullptr);
+      if (fd >= 0) {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        connections.push_back({fd, "", -1, -1, false, {}, Clock::now()});
+      }
+    }
+
+    now = Clock::now();
+    for (workerConnection& connection : connections) {
+      if (connection.unit >= 0 && !connection.timedOut &&
+          now - connection.issuedAt >= timeout) {
+        connection.timedOut = true;  // nothing new for it until it answers
+        requeue(connection.unit);
+      }
+    }
+
+    // local workers only: if they've all gone nobody is going to finish
+    while (childrenRunning > 0 && waitpid(-1, nullptr, WNOHANG) > 0) {
+      childrenRunning--;
+    }
+    if (!children.empty() && childrenRunning == 0 && !config.remote &&
+        connections.empty()) {
+      std::cout << "every worker has gone with " << units.size() - done
+                << " units left" << std::endl;
+      ok = false;
+      break;
+    }
+  }
+
+  while (!connections.empty()) {
+    sendLine(connections.back().fd, "quit");
+    hangUp(connections.size() - 1);
+  }
+  close(listenFd);
+  for (int i = 0; i < childrenRunning; ++i) {
+    waitpid(-1, nullptr, 0);
+  }
+  if (!ok) {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < units.size(); ++i) {
+    long long nodes = counts[i] * units[i].weight;
+    result.nodes += nodes;
+    result.divide[units[i].rootMove].second += nodes;
+    result.unitNodes += counts[i];
+  }
+  result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  return true;
+}
+
+bool runPerftWorker(const std::string& host, int port, int stallEvery,
+                    double stallSeconds) {
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* addresses = nullptr;
+  if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints,
+                  &addresses) != 0) {
+    std::cout << "can't find " << host << std::endl;
+    return false;
+  }
+  int fd = -1;
+  auto giveUp = Clock::now() + std::chrono::seconds(10);
+  while (fd < 0) {
+    for (addrinfo* a = addresses; a && fd < 0; a = a->ai_next) {
+      fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+      if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+      }
+    }
+    if (fd < 0) {
+      if (Clock::now() > giveUp) {
+        std::cout << "couldn't connect to " << host << ":" << port << ": "
+                  << std::strerror(errno) << std::endl;
+        freeaddrinfo(addresses);
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+  }
+  freeaddrinfo(addresses);
+  int yes = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+  char hostName[256] = "worker";
+  gethostname(hostName, sizeof(hostName) - 1);
+  bool ok = sendLine(fd, std::string("hello ") + hostName + "/" +
+                             std::to_string(getpid()));
+  std::string buffer, line;
+  long long unitsDone = 0;
+  while (ok) {
+    if (!takeLine(buffer, line)) {
+      char chunk[4096];
+      ssize_t count = recv(fd, chunk, sizeof(chunk), 0);
+      if (count <= 0) {
+        ok = false;
+        break;
+      }
+      buffer.append(chunk, static_cast<std::size_t>(count));
+      continue;
+    }
+    std::istringstream words(line);
+    std::string word, fen;
+    long long id = -1;
+    int depth = -1;
+    words >> word >> id >> depth;
+    std::getline(words >> std::ws, fen);
+    if (word == "quit") {
+      break;
+    }
+    Board board;
+    if (word != "unit" || depth < 0 || !board.loadFen(fen)) {
+      std::cout << "coordinator sent: " << line << std::endl;
+      ok = false;
+      break;
+    }
+    if (stallEvery > 0 && ++unitsDone % stallEvery == 0) {
+      std::this_thread::sleep_for(
+          std::chrono::duration<double>(stallSeconds));
+    }
+    auto start = Clock::now();
+    long long nodes = perft(board, depth);
+    long long micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                           Clock::now() - start)
+                           .count();
+    ok = sendLine(fd, "done " + std::to_string(id) + " " +
+                          std::to_string(nodes) + " " +
+                          std::to_string(micros));
+  }
+  close(fd);
+  return ok;
+}
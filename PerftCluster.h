@@ -0,0 +1,71 @@
+#ifndef PERFTCLUSTER_H
+#define PERFTCLUSTER_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Board.h"
+
+// perft spread over worker processes, on this machine or on others. the
+// coordinator plays the first splitDepth plies itself, merges the positions
+// that the same root move reaches more than one way, and hands the rest out
+// as work units, a fen and the depth left, one line each way over tcp:
+//   worker: hello <name>
+//   coordinator: unit <id> <depth> <fen>    worker: done <id> <nodes> <us>
+//   coordinator: quit
+// a worker does one unit at a time in the order they came. a unit that isn't
+// done within the timeout, or whose worker goes away, is handed to the next
+// free worker as well and the first answer counts, a worker that timed out
+// gets nothing new until it answers. the counts are added up in unit order at
+// the end, so the result doesn't depend on who did what or when
+
+struct perftClusterConfig {
+  int port = 0;          // 0 picks a free one
+  bool remote = false;   // accept workers from other hosts, not just this one
+  int localWorkers = 0;  // worker processes to start on this machine
+  int splitDepth = 0;    // 0 picks the shallowest that gives every worker
+                         // plenty of units
+  double timeoutSeconds = 60;
+  int stallEvery = 0;  // local workers sit on every nth unit for twice the
+                       // timeout before answering, to try out the re-issuing
+};
+
+struct perftWorkerStats {
+  std::string name;
+  long long units = 0;     // answers that counted
+  long long late = 0;      // answers for units someone else had finished
+  long long nodes = 0;     // leaf nodes it counted itself, every answer
+  double busySeconds = 0;  // as the worker timed it
+  double connectedSeconds = 0;
+};
+
+struct perftClusterResult {
+  long long nodes = 0;
+  std::vector<std::pair<moveType, long long>> divide;  // by root move, in
+                                                       // getMoveList order
+  int splitDepth = 0;
+  long long units = 0;
+  long long splitLines = 0;  // positions at splitDepth before merging
+  long long reissued = 0;    // times a unit went out again
+  long long unitNodes = 0;   // what the units added up to before weighting,
+                             // the work actually done
+  double splitSeconds = 0;
+  double seconds = 0;  // split included
+  std::vector<perftWorkerStats> workers;  // in the order they said hello
+};
+
+// listens, starts the local workers, and waits for workers until every unit
+// is done. a worker that answers nonsense is dropped. false if it couldn't
+// listen, or if only local workers were allowed and they've all gone
+bool runPerftCoordinator(const Board& position, int depth,
+                         const perftClusterConfig& config,
+                         perftClusterResult& result);
+
+// connects to a coordinator (trying for a few seconds, it may not be up yet)
+// and does units until told to quit. false if it never got through or the
+// connection dropped before the quit
+bool runPerftWorker(const std::string& host, int port, int stallEvery = 0,
+                    double stallSeconds = 0);
+
+#endif  // PERFTCLUSTER_H
@@ -0,0 +1,302 @@
+#include "Pgn.h"
+
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+const char* pieceLetters = "  RNBQK";  // indexed by piece type
+
+bool isResult(const std::string& token) {
+  return token == "1-0" || token == "0-1" || token == "1/2-1/2" ||
+         token == "*";
+}
+
+// [Name "value"], with \" and \\ inside the value
+bool parseTag(const std::string& line,
+              std::pair<std::string, std::string>& tag) {
+  std::size_t open = line.find('[');
+  std::size_t quote = line.find('"', open);
+  if (open == std::string::npos || quote == std::string::npos) {
+    return false;
+  }
+  std::size_t nameStart = open + 1;
+  std::size_t nameEnd = line.find_first_of(" \t\"", nameStart);
+  tag.first = line.substr(nameStart, nameEnd - nameStart);
+  tag.second.clear();
+  for (std::size_t i = quote + 1; i < line.size() && line[i] != '"'; ++i) {
+    if (line[i] == '\\' && i + 1 < line.size()) {
+      i++;
+    }
+    tag.second += line[i];
+  }
+  return !tag.first.empty();
+}
+
+}  // namespace
+
+std::string pgnGame::tag(const std::string& name) const {
+  for (const auto& [tagName, value] : tags) {
+    if (tagName == name) {
+      return value;
+    }
+  }
+  return "";
+}
+
+bool PgnReader::open(const std::string& path) {
+  file.open(path);
+  return file.is_open();
+}
+
+long long PgnReader::getGamesRead() const { return gamesRead; }
+
+bool PgnReader::next(pgnGame& game) {
+  game = pgnGame{};
+  bool inMovetext = false;
+  int commentDepth = 0;  // a { comment } can run over several lines
+  std::string line;
+  while (true) {
+    if (hasPendingLine) {
+      line = std::move(pendingLine);
+      hasPendingLine = false;
+    } else if (!std::getline(file, line)) {
+      break;
+    }
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    std::size_t first = line.find_first_not_of(" \t");
+    if (first == std::string::npos) {
+      continue;
+    }
+    if (commentDepth == 0 && line[first] == '%') {
+      continue;  // escaped line, meant for other programs
+    }
+    if (commentDepth == 0 && line[first] == '[') {
+      if (inMovetext) {
+        // the next game's tags, keep the line for it
+        pendingLine = std::move(line);
+        hasPendingLine = true;
+        break;
+      }
+      std::pair<std::string, std::string> tag;
+      if (parseTag(line, tag)) {
+        game.tags.push_back(std::move(tag));
+      }
+      continue;
+    }
+    inMovetext = true;
+    for (char c : line) {
+      commentDepth += c == '{';
+      commentDepth -= c == '}' && commentDepth > 0;
+    }
+    game.movetext += line;
+    game.movetext += '\n';
+  }
+  if (game.tags.empty() && game.movetext.empty()) {
+    return false;
+  }
+  gamesRead++;
+  return true;
+}
+
+bool pgnMoves(const pgnGame& game, Board& start,
+              std::vector<moveType>& moves) {
+  start = Board();
+  moves.clear();
+  std::string fen = game.tag("FEN");
+  if (!fen.empty() && !start.loadFen(fen)) {
+    return false;
+  }
+  Board position = start;
+  const std::string& text = game.movetext;
+  int variationDepth = 0;  // moves inside ( ) aren't part of the game
+  std::size_t i = 0;
+  while (i < text.size()) {
+    char c = text[i];
+    if (c == '{' || c == ';') {
+      i = text.find(c == '{' ? '}' : '\n', i);
+      if (i == std::string::npos) {
+        break;
+      }
+      i++;
+      continue;
+    }
+    if (c == '(' || c == ')') {
+      variationDepth += c == '(' ? 1 : (variationDepth > 0 ? -1 : 0);
+      i++;
+      continue;
+    }
+    if (std::isspace(static_cast<unsigned char>(c))) {
+      i++;
+      continue;
+    }
+    std::size_t end = i;
+    while (end < text.size() &&
+           !std::isspace(static_cast<unsigned char>(text[end])) &&
+           !std::strchr("{};()", text[end])) {
+      end++;
+    }
+    std::string token = text.substr(i, end - i);
+    i = end;
+    if (variationDepth > 0 || token[0] == '$') {
+      continue;
+    }
+    // "12." "12..." or glued on like "12.e4"
+    std::size_t digits = 0;
+    while (digits < token.size() &&
+           std::isdigit(static_cast<unsigned char>(token[digits]))) {
+      digits++;
+    }
+    if (digits < token.size() && token[digits] == '.') {
+      token.erase(0, token.find_first_not_of('.', digits));
+      if (token.empty() || token.find_first_not_of('.') == std::string::npos) {
+        continue;
+      }
+    }
+    if (isResult(token)) {
+      break;
+    }
+    moveType move;
+    if (!moveFromSan(position, token, move)) {
+      return false;
+    }
+    position.makeMove(move);
+    moves.push_back(move);
+  }
+  return true;
+}
+
+bool moveFromSan(const Board& board, const std::string& san,
+                 moveType& move) {
+  std::string text = san;
+  while (!text.empty() && std::strchr("+#!?", text.back())) {
+    text.pop_back();
+  }
+  if (text.empty()) {
+    return false;
+  }
+  std::vector<moveType> legal = board.getMoveList();
+
+  if (text == "O-O" || text == "0-0" || text == "O-O-O" || text == "0-0-0") {
+    int kingFile = text.size() == 3 ? 6 : 2;
+    for (const moveType& candidate : legal) {
+      if (candidate.typeOfMove == 3 && candidate.to % 8 == kingFile) {
+        move = candidate;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  int type = 1;
+  std::size_t start = 0;
+  if (text[0] != ' ' && std::strchr(pieceLetters, text[0])) {
+    type = static_cast<int>(std::strchr(pieceLetters, text[0]) - pieceLetters);
+    start = 1;
+  }
+  int promotion = 0;
+  if (type == 1 && text.size() > 2 &&
+      std::isalpha(static_cast<unsigned char>(text.back()))) {
+    // "e8=Q", also "e8Q" and "e8q"
+    const char* letter =
+        std::strchr(pieceLetters, std::toupper(text.back()));
+    if (!letter || *letter == ' ' || *letter == 'K') {
+      return false;
+    }
+    promotion = static_cast<int>(letter - pieceLetters);
+    text.pop_back();
+    if (text.back() == '=') {
+      text.pop_back();
+    }
+  }
+  if (text.size() < start + 2) {
+    return false;
+  }
+  char file = text[text.size() - 2];
+  char rank = text[text.size() - 1];
+  if (file < 'a' || file > 'h' || rank < '1' || rank > '8') {
+    return false;
+  }
+  int to = ('8' - rank) * 8 + (file - 'a');
+
+  // whatever is left between the piece and the square: disambiguation,
+  // capture marks, or the from square of long algebraic ("e2-e4")
+  int fromFile = -1, fromRank = -1;
+  for (std::size_t i = start; i + 2 < text.size(); ++i) {
+    char c = text[i];
+    if (c >= 'a' && c <= 'h') {
+      fromFile = c - 'a';
+    } else if (c >= '1' && c <= '8') {
+      fromRank = c - '1';
+    } else if (c != 'x' && c != ':' && c != '-') {
+      return false;
+    }
+  }
+
+  int found = 0;
+  for (const moveType& candidate : legal) {
+    if (candidate.to != to || board.getPiece(candidate.from) % 8 != type ||
+        (fromFile >= 0 && candidate.from % 8 != fromFile) ||
+        (fromRank >= 0 && 7 - candidate.from / 8 != fromRank)) {
+      continue;
+    }
+    if (candidate.typeOfMove == 5
+            ? candidate.promotion != (promotion ? promotion : 5)
+            : promotion != 0) {
+      continue;
+    }
+    move = candidate;
+    found++;
+  }
+  return found == 1;
+}
+
+std::string moveToSan(const Board& board, const moveType& move) {
+  int type = board.getPiece(move.from) % 8;
+  std::string san;
+  if (move.typeOfMove == 3) {
+    san = move.to % 8 == 6 ? "O-O" : "O-O-O";
+  } else {
+    bool capture = board.getPiece(move.to) || move.typeOfMove == 4;
+    if (type == 1) {
+      if (capture) {
+        san += static_cast<char>('a' + move.from % 8);
+      }
+    } else {
+      san += pieceLetters[type];
+      // only as much of the from square as it takes to tell it apart from
+      // the same kind of piece going to the same square
+      bool clash = false, sameFile = false, sameRank = false;
+      for (const moveType& other : board.getMoveList()) {
+        if (other.to == move.to && other.from != move.from &&
+            board.getPiece(other.from) % 8 == type) {
+          clash = true;
+          sameFile |= other.from % 8 == move.from % 8;
+          sameRank |= other.from / 8 == move.from / 8;
+        }
+      }
+      if (clash && (!sameFile || sameRank)) {
+        san += static_cast<char>('a' + move.from % 8);
+      }
+      if (clash && sameFile) {
+        san += static_cast<char>('8' - move.from / 8);
+      }
+    }
+    if (capture) {
+      san += 'x';
+    }
+    san += squareName(move.to);
+    if (move.typeOfMove == 5) {
+      san += '=';
+      san += pieceLetters[move.promotion ? move.promotion : 5];
+    }
+  }
+  Board after = board;
+  after.makeMove(move);
+  if (after.kingInCheck()) {
+    san += after.getStatus() == GameStatus::Checkmate ? '#' : '+';
+  }
+  return san;
+}
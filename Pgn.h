@@ -0,0 +1,46 @@
+#ifndef PGN_H
+#define PGN_H
+
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Board.h"
+
+// games from PGN files. reading one only splits out the tags and the move
+// text, the moves themselves are worked out by pgnMoves (which has to replay
+// the game through Board), so a file can be read on one thread and the
+// replaying spread over the others
+struct pgnGame {
+  std::vector<std::pair<std::string, std::string>> tags;  // in file order
+  std::string movetext;
+  std::string tag(const std::string& name) const;  // "" if it isn't there
+};
+
+class PgnReader {
+ private:
+  std::ifstream file;
+  std::string pendingLine;  // first tag of the next game, read while looking
+                            // for the end of the last one
+  bool hasPendingLine = false;
+  long long gamesRead = 0;
+
+ public:
+  bool open(const std::string& path);
+  bool next(pgnGame& game);  // false at the end of the file
+  long long getGamesRead() const;
+};
+
+// start is the FEN tag's position if there is one, otherwise the normal
+// start. comments, variations, NAGs and move numbers are skipped. returns
+// false if a move can't be read or isn't legal, moves then has the ones that
+// came before it
+bool pgnMoves(const pgnGame& game, Board& start, std::vector<moveType>& moves);
+
+bool moveFromSan(const Board& board, const std::string& san,
+                 moveType& move);  // e.g. "Nbd7", "exd8=Q+" or "O-O". false
+                                   // if it isn't exactly one legal move
+std::string moveToSan(const Board& board, const moveType& move);
+
+#endif  // PGN_H
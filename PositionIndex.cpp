@@ -0,0 +1,431 @@
+#include "PositionIndex.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Board.h"
+#include "Pgn.h"
+#include "TaskScheduler.h"
+#include "TrainingData.h"
+
+namespace {
+
+constexpr char INDEX_MAGIC[4] = {'C', 'P', 'I', '1'};
+constexpr std::uint32_t INDEX_VERSION = 1;
+constexpr std::size_t BATCH_GAMES = 4096;  // read this many, then replay them
+
+struct sourceGame {  // read from a file but not replayed yet
+  pgnGame pgn;
+  std::vector<std::uint8_t> packed;  // from a training file instead
+  std::string label;
+};
+
+struct keyedPosting {
+  std::uint64_t key;
+  positionPosting posting;
+
+  bool operator<(const keyedPosting& other) const {
+    if (key != other.key) {
+      return key < other.key;
+    }
+    if (posting.game != other.posting.game) {
+      return posting.game < other.posting.game;
+    }
+    return posting.ply < other.posting.ply;
+  }
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+std::string pgnLabel(const pgnGame& game) {
+  std::string label = game.tag("White") + " - " + game.tag("Black");
+  for (const char* name : {"Event", "Date", "Result"}) {
+    std::string value = game.tag(name);
+    if (!value.empty() && value != "?") {
+      label += ", " + value;
+    }
+  }
+  return label;
+}
+
+// one input file, handing out its games in order
+class gameSource {
+ private:
+  std::string path;
+  bool isTraining = false;
+  PgnReader pgn;
+  TrainingReader training;
+  long long gamesRead = 0;
+
+ public:
+  bool open(const std::string& filePath) {
+    path = filePath;
+    std::ifstream file(path, std::ios::binary);
+    std::uint32_t magic = 0;
+    if (!file.read(reinterpret_cast<char*>(&magic), sizeof(magic))) {
+      magic = 0;  // shorter than a chunk header, can only be PGN
+    }
+    isTraining = magic == TRAINING_MAGIC;
+    return isTraining ? training.open(path) : pgn.open(path);
+  }
+
+  bool next(sourceGame& game) {
+    if (isTraining) {
+      game.pgn = pgnGame{};
+      if (!training.nextGame(game.packed)) {
+        return false;
+      }
+      game.label = path + " game " + std::to_string(gamesRead + 1);
+    } else {
+      game.packed.clear();
+      if (!pgn.next(game.pgn)) {
+        return false;
+      }
+      game.label = pgnLabel(game.pgn);
+    }
+    gamesRead++;
+    return true;
+  }
+};
+
+// adds a posting for every position the game reached, false if it stopped
+// early on a move that didn't read or replay
+bool replayGame(const sourceGame& game, std::uint32_t number,
+                std::vector<keyedPosting>& out) {
+  Board start;
+  std::vector<moveType> moves;
+  bool whole = game.packed.empty() ? pgnMoves(game.pgn, start, moves)
+                                   : decodeGame(game.packed, start, moves);
+  Board position = start;
+  std::size_t first = out.size();
+  out.push_back({position.getPositionKey(), {number, 0}});
+  for (std::size_t ply = 0; ply < moves.size(); ++ply) {
+    position.makeMove(moves[ply]);
+    out.push_back({position.getPositionKey(),
+                   {number, static_cast<std::uint32_t>(ply + 1)}});
+  }
+  // a game going back to a position it already had only counts the first
+  // time
+  std::sort(out.begin() + first, out.end());
+  out.erase(std::unique(out.begin() + first, out.end(),
+                        [](const keyedPosting& a, const keyedPosting& b) {
+                          return a.key == b.key;
+                        }),
+            out.end());
+  return whole;
+}
+
+template <typename T>
+void writeArray(std::ofstream& file, const std::vector<T>& values) {
+  file.write(reinterpret_cast<const char*>(values.data()),
+             values.size() * sizeof(T));
+}
+
+}  // namespace
+
+bool buildPositionIndex(const std::vector<std::string>& inputs,
+                        const std::string& outPath, int threads,
+                        positionIndexStats& stats) {
+  stats = positionIndexStats{};
+  TaskScheduler scheduler(std::max(1, threads));
+  // one list per worker plus one for this thread, which takes a share of
+  // every parallelFor itself
+  std::vector<std::vector<keyedPosting>> found(scheduler.threadCount() + 1);
+  std::vector<std::string> labels;
+  std::atomic<long long> broken{0};
+
+  for (const std::string& path : inputs) {
+    gameSource source;
+    if (!source.open(path)) {
+      std::cout << "couldn't open " << path << std::endl;
+      return false;
+    }
+    std::vector<sourceGame> batch;
+    while (true) {
+      auto readStart = std::chrono::steady_clock::now();
+      batch.clear();
+      sourceGame game;
+      while (batch.size() < BATCH_GAMES && source.next(game)) {
+        batch.push_back(std::move(game));
+      }
+      stats.readSeconds += secondsSince(readStart);
+      if (batch.empty()) {
+        break;
+      }
+
+      auto replayStart = std::chrono::steady_clock::now();
+      std::size_t firstNumber = labels.size();
+      if (firstNumber + batch.size() > 0xffffffffu) {
+        std::cout << "too many games for one index" << std::endl;
+        return false;
+      }
+      labels.resize(firstNumber + batch.size());
+      parallelFor(scheduler, 0, batch.size(), 16,
+                  [&](std::size_t first, std::size_t last) {
+                    auto& out = found[TaskScheduler::currentWorker() + 1];
+                    for (std::size_t i = first; i < last; ++i) {
+                      std::uint32_t number =
+                          static_cast<std::uint32_t>(firstNumber + i);
+                      if (!replayGame(batch[i], number, out)) {
+                        broken++;
+                      }
+                      labels[number] = std::move(batch[i].label);
+                    }
+                  });
+      stats.replaySeconds += secondsSince(replayStart);
+    }
+  }
+  stats.games = static_cast<long long>(labels.size());
+  stats.brokenGames = broken;
+
+  // each worker's postings are sorted as a task of their own, then merged in
+  auto sortStart = std::chrono::steady_clock::now();
+  parallelFor(scheduler, 0, found.size(), 1,
+              [&found](std::size_t first, std::size_t last) {
+                for (std::size_t t = first; t < last; ++t) {
+                  std::sort(found[t].begin(), found[t].end());
+                }
+              });
+  std::vector<keyedPosting> all;
+  for (std::vector<keyedPosting>& part : found) {
+    std::size_t middle = all.size();
+    all.insert(all.end(), part.begin(), part.end());
+    std::vector<keyedPosting>().swap(part);
+    std::inplace_merge(all.begin(), all.begin() + middle, all.end());
+  }
+  if (all.size() > 0xffffffffu) {
+    std::cout << "too many positions for one index" << std::endl;
+    return false;
+  }
+  std::vector<std::uint64_t> keys;
+  std::vector<std::uint32_t> starts;
+  std::vector<positionPosting> postings;
+  postings.reserve(all.size());
+  for (const keyedPosting& entry : all) {
+    if (keys.empty() || entry.key != keys.back()) {
+      keys.push_back(entry.key);
+      starts.push_back(static_cast<std::uint32_t>(postings.size()));
+    }
+    postings.push_back(entry.posting);
+  }
+  starts.push_back(static_cast<std::uint32_t>(postings.size()));
+  std::vector<keyedPosting>().swap(all);
+  stats.sortSeconds = secondsSince(sortStart);
+
+  auto writeStart = std::chrono::steady_clock::now();
+  std::string text;
+  std::vector<std::uint64_t> labelOffsets;
+  for (const std::string& label : labels) {
+    labelOffsets.push_back(text.size());
+    text += label;
+  }
+  labelOffsets.push_back(text.size());
+
+  positionIndexHeader header{};
+  std::memcpy(header.magic, INDEX_MAGIC, 4);
+  header.version = INDEX_VERSION;
+  header.keyCheck = Board().getPositionKey();
+  header.games = labels.size();
+  header.keys = keys.size();
+  header.postings = postings.size();
+  header.startsOffset = sizeof(header) + keys.size() * sizeof(std::uint64_t);
+  std::uint64_t startsEnd =
+      header.startsOffset + starts.size() * sizeof(std::uint32_t);
+  header.postingsOffset = (startsEnd + 7) / 8 * 8;  // keeps the rest aligned
+  header.labelsOffset =
+      header.postingsOffset + postings.size() * sizeof(positionPosting);
+  header.textOffset =
+      header.labelsOffset + labelOffsets.size() * sizeof(std::uint64_t);
+  header.fileBytes = header.textOffset + text.size();
+
+  std::string temporaryPath = outPath + ".tmp";
+  {
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeArray(file, keys);
+    writeArray(file, starts);
+    file.write("\0\0\0\0\0\0\0", header.postingsOffset - startsEnd);
+    writeArray(file, postings);
+    writeArray(file, labelOffsets);
+    file.write(text.data(), text.size());
+    if (!file) {
+      std::cout << "couldn't write " << temporaryPath << std::endl;
+      return false;
+    }
+  }
+#ifdef _WIN32
+  std::remove(outPath.c_str());  // rename won't replace a file there
+#endif
+  if (std::rename(temporaryPath.c_str(), outPath.c_str()) != 0) {
+    std::cout << "couldn't rename " << temporaryPath << " to " << outPath
+              << std::endl;
+    return false;
+  }
+  stats.writeSeconds = secondsSince(writeStart);
+  stats.positions = static_cast<long long>(postings.size());
+  stats.keys = static_cast<long long>(keys.size());
+  stats.fileBytes = static_cast<long long>(header.fileBytes);
+  return true;
+}
+
+PositionIndex::~PositionIndex() { close(); }
+
+bool PositionIndex::open(const std::string& path) {
+  close();
+#ifndef _WIN32
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cout << "couldn't open " << path << std::endl;
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size < 1) {
+    std::cout << path << " is empty" << std::endl;
+    ::close(fd);
+    return false;
+  }
+  std::size_t bytes = static_cast<std::size_t>(info.st_size);
+  void* mapping = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);  // the mapping stays valid without it
+  if (mapping == MAP_FAILED) {
+    std::cout << "couldn't map " << path << std::endl;
+    return false;
+  }
+  data = static_cast<const std::uint8_t*>(mapping);
+  dataBytes = bytes;
+  mapped = true;
+#else
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    std::cout << "couldn't open " << path << std::endl;
+    return false;
+  }
+  memory.assign(std::istreambuf_iterator<char>(file),
+                std::istreambuf_iterator<char>());
+  data = memory.data();
+  dataBytes = memory.size();
+#endif
+
+  // only the layout is checked, a checksum would mean reading all of it
+  const positionIndexHeader* candidate =
+      reinterpret_cast<const positionIndexHeader*>(data);
+  const char* problem = nullptr;
+  if (dataBytes < sizeof(positionIndexHeader) ||
+      std::memcmp(candidate->magic, INDEX_MAGIC, 4) != 0) {
+    problem = "not a position index";
+  } else if (candidate->version != INDEX_VERSION ||
+             candidate->keyCheck != Board().getPositionKey()) {
+    problem = "made by a different version, build it again";
+  } else if (candidate->fileBytes != dataBytes ||
+             candidate->keys > dataBytes / 8 ||
+             candidate->postings > dataBytes / 8 ||
+             candidate->games > dataBytes / 8 ||
+             candidate->startsOffset !=
+                 sizeof(positionIndexHeader) + candidate->keys * 8 ||
+             candidate->postingsOffset <
+                 candidate->startsOffset + (candidate->keys + 1) * 4 ||
+             candidate->labelsOffset !=
+                 candidate->postingsOffset + candidate->postings * 8 ||
+             candidate->textOffset !=
+                 candidate->labelsOffset + (candidate->games + 1) * 8 ||
+             candidate->textOffset > dataBytes) {
+    problem = "truncated or damaged";
+  }
+  if (problem) {
+    std::cout << path << ": " << problem << std::endl;
+    close();
+    return false;
+  }
+  header = candidate;
+  keys = reinterpret_cast<const std::uint64_t*>(header + 1);
+  starts = reinterpret_cast<const std::uint32_t*>(data + header->startsOffset);
+  postings =
+      reinterpret_cast<const positionPosting*>(data + header->postingsOffset);
+  labels = reinterpret_cast<const std::uint64_t*>(data + header->labelsOffset);
+  text = reinterpret_cast<const char*>(data + header->textOffset);
+  return true;
+}
+
+void PositionIndex::close() {
+#ifndef _WIN32
+  if (mapped) {
+    munmap(const_cast<std::uint8_t*>(data), dataBytes);
+  }
+#endif
+  memory.clear();
+  memory.shrink_to_fit();
+  data = nullptr;
+  dataBytes = 0;
+  mapped = false;
+  header = nullptr;
+  keys = nullptr;
+  starts = nullptr;
+  postings = nullptr;
+  labels = nullptr;
+  text = nullptr;
+}
+
+bool PositionIndex::isOpen() const { return header != nullptr; }
+
+std::size_t PositionIndex::find(std::uint64_t key,
+                                const positionPosting*& first) const {
+  first = nullptr;
+  if (!header) {
+    return 0;
+  }
+  const std::uint64_t* end = keys + header->keys;
+  const std::uint64_t* at = std::lower_bound(keys, end, key);
+  if (at == end || *at != key) {
+    return 0;
+  }
+  std::size_t i = at - keys;
+  if (starts[i] > starts[i + 1] || starts[i + 1] > header->postings) {
+    return 0;  // damaged, open doesn't read far enough to notice
+  }
+  first = postings + starts[i];
+  return starts[i + 1] - starts[i];
+}
+
+std::string PositionIndex::gameLabel(std::uint32_t game) const {
+  std::uint64_t textBytes = header ? header->fileBytes - header->textOffset : 0;
+  if (!header || game >= header->games || labels[game] > labels[game + 1] ||
+      labels[game + 1] > textBytes) {
+    return "";
+  }
+  return std::string(text + labels[game], text + labels[game + 1]);
+}
+
+std::uint64_t PositionIndex::gameCount() const {
+  return header ? header->games : 0;
+}
+
+std::uint64_t PositionIndex::keyCount() const {
+  return header ? header->keys : 0;
+}
+
+std::uint64_t PositionIndex::postingCount() const {
+  return header ? header->postings : 0;
+}
+
+std::uint64_t PositionIndex::keyAt(std::size_t i) const {
+  return header && i < header->keys ? keys[i] : 0;
+}
+
+std::size_t PositionIndex::fileBytes() const { return dataBytes; }
@@ -0,0 +1,95 @@
+#ifndef POSITIONINDEX_H
+#define POSITIONINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// which games of a collection reached a position. buildPositionIndex replays
+// every game once and writes the file, after that a lookup is a binary
+// search over the sorted keys plus reading that key's postings, straight out
+// of a memory mapping. the file is laid out as
+//   header | keys | starts | postings | labels | label text
+// where keys are the distinct position keys in order, starts[i] is the first
+// posting of keys[i] (with one more on the end), postings are grouped by key
+// and in game order, and labels[g] is where game g's label starts in the text
+
+struct positionIndexHeader {
+  char magic[4];  // "CPI1"
+  std::uint32_t version;
+  std::uint64_t keyCheck;  // key of the starting position, so an index made
+                           // with different zobrist keys counts as stale
+  std::uint64_t games;
+  std::uint64_t keys;      // distinct positions
+  std::uint64_t postings;  // one per position per game that reached it
+  std::uint64_t startsOffset;  // byte offsets from the start of the file, the
+                               // keys come straight after the header
+  std::uint64_t postingsOffset;
+  std::uint64_t labelsOffset;
+  std::uint64_t textOffset;
+  std::uint64_t fileBytes;
+};
+
+struct positionPosting {
+  std::uint32_t game;  // number in the order the games were read, from 0
+  std::uint32_t ply;   // first time the game reached it, 0 is the start
+};
+
+struct positionIndexStats {
+  long long games = 0;
+  long long brokenGames = 0;  // a move didn't read or replay, the plies
+                              // before it are still indexed
+  long long positions = 0;    // postings, repeats within a game left out
+  long long keys = 0;
+  long long fileBytes = 0;
+  double readSeconds = 0;  // splitting the files into games
+  double replaySeconds = 0;
+  double sortSeconds = 0;
+  double writeSeconds = 0;
+};
+
+// inputs are PGN files or training files (TrainingData.h), told apart by the
+// first bytes. the games are replayed on threads workers. the whole index is
+// built in memory, about 16 bytes per position, and written to outPath
+// through a temporary file so a reader never maps half an index
+bool buildPositionIndex(const std::vector<std::string>& inputs,
+                        const std::string& outPath, int threads,
+                        positionIndexStats& stats);
+
+class PositionIndex {
+ private:
+  const std::uint8_t* data = nullptr;  // the mapping, or memory's
+  std::size_t dataBytes = 0;
+  std::vector<std::uint8_t> memory;  // where there's no mmap
+  bool mapped = false;
+  const positionIndexHeader* header = nullptr;
+  const std::uint64_t* keys = nullptr;
+  const std::uint32_t* starts = nullptr;
+  const positionPosting* postings = nullptr;
+  const std::uint64_t* labels = nullptr;
+  const char* text = nullptr;
+
+ public:
+  PositionIndex() = default;
+  ~PositionIndex();
+  PositionIndex(const PositionIndex&) = delete;
+  PositionIndex& operator=(const PositionIndex&) = delete;
+
+  bool open(const std::string& path);  // false if it's missing, damaged or
+                                       // stale, the index is closed then
+  void close();
+  bool isOpen() const;
+  std::size_t find(std::uint64_t key, const positionPosting*& first)
+      const;  // how many games reached the position, first points at their
+              // postings inside the mapping
+  std::string gameLabel(std::uint32_t game) const;  // e.g. "Carlsen - Nepo,
+                                                    // WCh 2021, 1-0"
+  std::uint64_t gameCount() const;
+  std::uint64_t keyCount() const;
+  std::uint64_t postingCount() const;
+  std::uint64_t keyAt(std::size_t i) const;  // the i-th smallest key
+  std::size_t fileBytes() const;
+};
+
+#endif  // POSITIONINDEX_H
@@ -0,0 +1,196 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILE_HAS_RDTSC 1
+#endif
+
+namespace {
+
+constexpr int zoneCount = static_cast<int>(ProfileZone::Count);
+constexpr std::size_t maxTraceEvents = 1 << 20;  // per thread
+
+const std::array<const char*, zoneCount> zoneNames = {
+    "moveGeneration", "attackedSquares", "pinDetection", "evaluation",
+    "tableProbe",     "tableStore",      "searchNode"};
+
+struct TraceEvent {
+  ProfileZone zone;
+  std::uint64_t start;
+  std::uint64_t end;
+};
+
+struct ThreadProfile {
+  int threadId = 0;
+  // only the owning thread writes these, relaxed atomics just keep readers
+  // on other threads well defined
+  std::array<std::atomic<std::uint64_t>, zoneCount> calls{};
+  std::array<std::atomic<std::uint64_t>, zoneCount> ticks{};
+  std::mutex eventsMutex;  // only taken while tracing
+  std::vector<TraceEvent> events;
+};
+
+std::mutex registryMutex;
+std::vector<std::shared_ptr<ThreadProfile>> registry;  // outlives threads
+std::atomic<bool> tracing{false};
+
+ThreadProfile& localProfile() {
+  thread_local std::shared_ptr<ThreadProfile> profile = [] {
+    auto created = std::make_shared<ThreadProfile>();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    created->threadId = static_cast<int>(registry.size());
+    registry.push_back(created);
+    return created;
+  }();
+  return *profile;
+}
+
+void bump(std::atomic<std::uint64_t>& counter, std::uint64_t amount) {
+  counter.store(counter.load(std::memory_order_relaxed) + amount,
+                std::memory_order_relaxed);
+}
+
+double nanosecondsPerTick() {  // measured once, the first time it's needed
+  static const double ratio = [] {
+#ifdef PROFILE_HAS_RDTSC
+    auto wallStart = std::chrono::steady_clock::now();
+    std::uint64_t tickStart = profileTicks();
+    while (std::chrono::steady_clock::now() - wallStart <
+           std::chrono::milliseconds(20)) {
+    }
+    double nanoseconds = std::chrono::duration<double, std::nano>(
+                             std::chrono::steady_clock::now() - wallStart)
+                             .count();
+    return nanoseconds / static_cast<double>(profileTicks() - tickStart);
+#else
+    return 1.0;  // ticks are already nanoseconds
+#endif
+  }();
+  return ratio;
+}
+
+}  // namespace
+
+std::uint64_t profileTicks() {
+#ifdef PROFILE_HAS_RDTSC
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+void profileRecord(ProfileZone zone, std::uint64_t startTicks,
+                   std::uint64_t endTicks) {
+  ThreadProfile& profile = localProfile();
+  int z = static_cast<int>(zone);
+  bump(profile.calls[z], 1);
+  bump(profile.ticks[z], endTicks - startTicks);
+  if (tracing.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(profile.eventsMutex);
+    if (profile.events.size() < maxTraceEvents) {
+      profile.events.push_back({zone, startTicks, endTicks});
+    }
+  }
+}
+
+void profileCount(ProfileZone zone) {
+  bump(localProfile().calls[static_cast<int>(zone)], 1);
+}
+
+bool profileEnabled() {
+#ifdef CHESS_PROFILE
+  return true;
+#else
+  return false;
+#endif
+}
+
+void profileReset() {
+  std::lock_guard<std::mutex> lock(registryMutex);
+  for (auto& profile : registry) {
+    for (int z = 0; z < zoneCount; ++z) {
+      profile->calls[z].store(0, std::memory_order_relaxed);
+      profile->ticks[z].store(0, std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> eventsLock(profile->eventsMutex);
+    profile->events.clear();
+  }
+}
+
+void profileSetTracing(bool on) { tracing.store(on); }
+
+std::string profileReportJson() {
+  std::array<std::uint64_t, zoneCount> calls{};
+  std::array<std::uint64_t, zoneCount> ticks{};
+  int threads = 0;
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    threads = static_cast<int>(registry.size());
+    for (auto& profile : registry) {
+      for (int z = 0; z < zoneCount; ++z) {
+        calls[z] += profile->calls[z].load(std::memory_order_relaxed);
+        ticks[z] += profile->ticks[z].load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  std::ostringstream json;
+  json << "{\n  \"enabled\": " << (profileEnabled() ? "true" : "false")
+       << ",\n  \"threads\": " << threads << ",\n  \"zones\": {\n";
+  double nsPerTick = profileEnabled() ? nanosecondsPerTick() : 1.0;
+  for (int z = 0; z < zoneCount; ++z) {
+    double totalNs = ticks[z] * nsPerTick;
+    json << "    \"" << zoneNames[z] << "\": {\"calls\": " << calls[z]
+         << ", \"total_ns\": " << static_cast<std::uint64_t>(totalNs)
+         << ", \"ns_per_call\": " << (calls[z] ? totalNs / calls[z] : 0)
+         << "}" << (z + 1 < zoneCount ? "," : "") << "\n";
+  }
+  json << "  }\n}\n";
+  return json.str();
+}
+
+bool profileWriteJson(const std::string& path) {
+  std::ofstream file(path);
+  file << profileReportJson();
+  return static_cast<bool>(file);
+}
+
+bool profileWriteChromeTrace(const std::string& path) {
+  std::ofstream file(path);
+  file << "{\"traceEvents\": [\n";
+  double usPerTick = profileEnabled() ? nanosecondsPerTick() / 1000 : 0.001;
+  bool first = true;
+  std::uint64_t origin = UINT64_MAX;
+  std::lock_guard<std::mutex> lock(registryMutex);
+  for (auto& profile : registry) {
+    std::lock_guard<std::mutex> eventsLock(profile->eventsMutex);
+    for (const TraceEvent& event : profile->events) {
+      origin = std::min(origin, event.start);
+    }
+  }
+  for (auto& profile : registry) {
+    std::lock_guard<std::mutex> eventsLock(profile->eventsMutex);
+    for (const TraceEvent& event : profile->events) {
+      file << (first ? "" : ",\n") << "{\"name\": \""
+           << zoneNames[static_cast<int>(event.zone)]
+           << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << profile->threadId
+           << ", \"ts\": " << (event.start - origin) * usPerTick
+           << ", \"dur\": " << (event.end - event.start) * usPerTick << "}";
+      first = false;
+    }
+  }
+  file << "\n]}\n";
+  return static_cast<bool>(file);
+}
@@ -0,0 +1,60 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <string>
+
+// hot path instrumentation. build with -DCHESS_PROFILE=ON to turn it on,
+// otherwise PROFILE_SCOPE and PROFILE_COUNT compile to nothing and the
+// export functions just report that profiling is off.
+//
+// every thread keeps its own counters, so recording never takes a lock.
+// times are inclusive (a zone's time includes any zones nested inside it).
+
+enum class ProfileZone {
+  MoveGeneration,   // Board::generateAllMoves
+  AttackedSquares,  // Board::findAttackedSquares
+  PinDetection,     // Board::findPinsToKing
+  Evaluation,       // evaluate
+  TableProbe,       // TranspositionTable::probe
+  TableStore,       // TranspositionTable::store
+  SearchNode,       // count only, one per node searched
+  Count
+};
+
+std::uint64_t profileTicks();  // cycle counter where there is one
+void profileRecord(ProfileZone zone, std::uint64_t startTicks,
+                   std::uint64_t endTicks);
+void profileCount(ProfileZone zone);
+
+bool profileEnabled();  // whether this build was made with CHESS_PROFILE
+void profileReset();
+void profileSetTracing(bool on);  // also keep every timed scope for a trace
+std::string profileReportJson();  // totals per zone across all threads
+bool profileWriteJson(const std::string& path);
+bool profileWriteChromeTrace(
+    const std::string& path);  // open in chrome://tracing or Perfetto
+
+class ProfileScope {
+ private:
+  ProfileZone zone;
+  std::uint64_t start;
+
+ public:
+  explicit ProfileScope(ProfileZone zone)
+      : zone(zone), start(profileTicks()) {}
+  ~ProfileScope() { profileRecord(zone, start, profileTicks()); }
+};
+
+#define PROFILE_JOIN_NAME(a, b) a##b
+#define PROFILE_SCOPE_NAME(line) PROFILE_JOIN_NAME(profileScope, line)
+
+#ifdef CHESS_PROFILE
+#define PROFILE_SCOPE(zone) ProfileScope PROFILE_SCOPE_NAME(__LINE__)(zone)
+#define PROFILE_COUNT(zone) profileCount(zone)
+#else
+#define PROFILE_SCOPE(zone) ((void)0)
+#define PROFILE_COUNT(zone) ((void)0)
+#endif
+
+#endif  // PROFILER_H
@@ -0,0 +1,532 @@
+#include "Search.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+
+#include "Evaluate.h"
+#include "Profiler.h"
+
+namespace {
+
+constexpr int INFINITE_SCORE = MATE_SCORE + 1;
+
+bool sameMove(const moveType& a, const moveType& b) {
+  return a.from == b.from && a.to == b.to && a.promotion == b.promotion;
+}
+
+int captureValue(int id) {  // rough value used for ordering captures
+  constexpr int values[7] = {0, 1, 5, 3, 3, 9, 0};
+  return values[id % 8];
+}
+
+bool isQuiet(const Board& position, const moveType& move) {
+  return !position.getPiece(move.to) && move.typeOfMove != 4 &&
+         move.typeOfMove != 5;
+}
+
+// pawns and a king only. passing is often the best move there (zugzwang), so
+// null move pruning would cut nodes it shouldn't
+bool onlyPawnsLeft(const Board& position) {
+  int side = position.isBlackToMove() ? 1 : 0;
+  for (int i = 0; i < 64; ++i) {
+    int id = position.getPiece(i);
+    if (id && id / 8 == side && id % 8 != 1 && id % 8 != 6) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// how much shallower a late quiet move is searched, more the later it comes
+// in the order and the deeper the node
+int lateMoveReduction(int depth, int moveNumber) {
+  static const auto table = []() {
+    std::array<std::array<int, 64>, 64> reductions{};
+    for (int d = 1; d < 64; ++d) {
+      for (int m = 1; m < 64; ++m) {
+        reductions[d][m] =
+            static_cast<int>(0.75 + std::log(d) * std::log(m) / 2.25);
+      }
+    }
+    return reductions;
+  }();
+  return table[std::min(depth, 63)][std::min(moveNumber, 63)];
+}
+
+constexpr int FUTILITY_MARGIN[3] = {0, 200, 450};  // by depth left
+constexpr int ASPIRATION_WINDOW = 25;
+
+}  // namespace
+
+Search::Search(const std::atomic<bool>& stopFlag, TranspositionTable* table,
+               const std::atomic<bool>* ponderHit)
+    : stopFlag(stopFlag), table(table), ponderHit(ponderHit) {}
+
+long long Search::getNodes() const { return nodes; }
+
+const TimeManager& Search::getTimeManager() const { return timeManager; }
+
+bool Search::shouldStop() {
+  if (aborted) {
+    return true;
+  }
+  // checked on every node so a stop request lands well inside a millisecond
+  auto now = std::chrono::steady_clock::now();
+  if (pondering && ponderHit->load(std::memory_order_relaxed)) {
+    startClock(now);
+  }
+  if (stopFlag.load(std::memory_order_relaxed) ||
+      (hasDeadline && now >= deadline) ||
+      (nodeLimit && nodes >= nodeLimit)) {
+    aborted = true;
+  } else if (reportIntervalMs &&
+             now - lastReport >= std::chrono::milliseconds(reportIntervalMs)) {
+    report(false);
+  }
+  return aborted;
+}
+
+void Search::startClock(std::chrono::steady_clock::time_point now) {
+  pondering = false;
+  clockOffsetMs = static_cast<int>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(now - startTime)
+          .count());
+  hasDeadline = moveTimeMs > 0 || timeManager.isActive();
+  deadline = now + std::chrono::milliseconds(timeManager.isActive()
+                                                 ? timeManager.getHardMs()
+                                                 : moveTimeMs);
+}
+
+void Search::report(bool completed) {
+  auto now = std::chrono::steady_clock::now();
+  lastReport = now;
+  latest.nodes = nodes;
+  latest.timeMs = static_cast<int>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(now - startTime)
+          .count());
+  latest.completed = completed;
+  if (reporter && *reporter) {
+    (*reporter)(latest);
+  }
+}
+
+void Search::orderMoves(const Board& position, std::vector<moveType>& moves,
+                        const moveType* bestFirst) {
+  auto score = [&](const moveType& move) {
+    if (bestFirst && sameMove(move, *bestFirst)) {
+      return 1000;
+    }
+    int value = 0;
+    if (move.typeOfMove == 2 || move.typeOfMove == 4 ||
+        position.getPiece(move.to)) {
+      // most valuable victim, least valuable attacker
+      int victim = move.typeOfMove == 4 ? 1 : position.getPiece(move.to);
+      value += 100 + captureValue(victim) * 10 -
+               captureValue(position.getPiece(move.from));
+    }
+    if (move.typeOfMove == 5) {
+      value += 50 + captureValue(move.promotion);
+    }
+    return value;
+  };
+  std::stable_sort(moves.begin(), moves.end(),
+                   [&](const moveType& a, const moveType& b) {
+                     return score(a) > score(b);
+                   });
+}
+
+void Search::extendPvFromTable(const Board& root, std::vector<moveType>& pv) {
+  // cutoffs from the table leave the pv short, so follow the stored best
+  // moves to fill it back out for the analysis display
+  if (!table || pv.empty()) {
+    return;
+  }
+  Board position = root;
+  for (const moveType& move : pv) {
+    position.makeMove(move);
+  }
+  ttEntry entry;
+  while (pv.size() < 32 && table->probe(position.getPositionKey(), entry) &&
+         entry.from != -1) {
+    // the entry could be another position's with the same key, so make sure
+    // the move can be played here before following it
+    moveType move{entry.from, entry.to,
+                  position.moveKind(entry.from, entry.to), entry.promotion};
+    if (!position.isLegal(move)) {
+      break;
+    }
+    pv.push_back(move);
+    position.makeMove(move);
+  }
+}
+
+int Search::quiescence(const Board& position, int alpha, int beta, int ply) {
+  nodes++;
+  PROFILE_COUNT(ProfileZone::SearchNode);
+  if (shouldStop()) {
+    return 0;
+  }
+  GameStatus status = position.getStatus();
+  if (status == GameStatus::Checkmate) {
+    return -MATE_SCORE + ply;
+  }
+  if (status != GameStatus::Ongoing) {
+    return 0;
+  }
+
+  int standPat = evaluate(position);
+  if (standPat >= beta) {
+    return standPat;
+  }
+  alpha = std::max(alpha, standPat);
+
+  std::vector<moveType> moves;
+  for (const moveType& move : position.getMoveList()) {
+    // only captures and queen promotions, quiet moves are left to the eval
+    if (position.getPiece(move.to) || move.typeOfMove == 4 ||
+        (move.typeOfMove == 5 && move.promotion == 5)) {
+      moves.push_back(move);
+    }
+  }
+  orderMoves(position, moves, nullptr);
+
+  for (const moveType& move : moves) {
+    Board child = position;
+    child.makeMove(move);
+    int score = -quiescence(child, -beta, -alpha, ply + 1);
+    if (aborted) {
+      return 0;
+    }
+    if (score >= beta) {
+      return score;
+    }
+    alpha = std::max(alpha, score);
+  }
+  return alpha;
+}
+
+int Search::negamax(const Board& position, int depth, int alpha, int beta,
+                    int ply, std::vector<moveType>& pv, bool pvNode,
+                    bool allowNull) {
+  pv.clear();
+  GameStatus status = position.getStatus();
+  if (status == GameStatus::Checkmate) {
+    nodes++;
+    return -MATE_SCORE + ply;
+  }
+  // inside the search one repetition is as good as three, nobody would
+  // play into it hoping for something else
+  if (status != GameStatus::Ongoing || position.getRepetitions()) {
+    nodes++;
+    return 0;
+  }
+  // if we can go back to an earlier position, a draw is the least we get
+  if (alpha < 0 && position.hasUpcomingRepetition(ply)) {
+    alpha = 0;
+    if (alpha >= beta) {
+      nodes++;
+      return alpha;
+    }
+  }
+  if (depth <= 0) {
+    return quiescence(position, alpha, beta, ply);
+  }
+  nodes++;
+  PROFILE_COUNT(ProfileZone::SearchNode);
+  if (shouldStop()) {
+    return 0;
+  }
+
+  int originalAlpha = alpha;
+  moveType ttMove{-1, -1, 0};
+  ttEntry entry;
+  if (table && table->probe(position.getPositionKey(), entry)) {
+    int score = scoreFromTable(entry.score, ply);
+    if (entry.depth >= depth &&
+        (entry.flag == TranspositionTable::EXACT ||
+         (entry.flag == TranspositionTable::LOWER_BOUND && score >= beta) ||
+         (entry.flag == TranspositionTable::UPPER_BOUND && score <= alpha))) {
+      return score;
+    }
+    ttMove = moveType{entry.from, entry.to, 0, entry.promotion};
+  }
+
+  // the pruning below only happens away from the principal variation, and
+  // never in check or near a mate score
+  bool inCheck = position.kingInCheck();
+  bool canPrune = !pvNode && !inCheck &&
+                  std::abs(alpha) < MATE_SCORE - 1000 &&
+                  std::abs(beta) < MATE_SCORE - 1000;
+  int staticEval = 0;
+  if (canPrune && (features.nullMove || features.futility)) {
+    staticEval = evaluate(position);
+  }
+
+  if (features.nullMove && canPrune && allowNull && depth >= 3 &&
+      staticEval >= beta && !onlyPawnsLeft(position)) {
+    Board child = position;
+    child.makeNullMove();
+    std::vector<moveType> nullPv;
+    int reduction = 2 + depth / 6;
+    int score = -negamax(child, depth - 1 - reduction, -beta, -beta + 1,
+                         ply + 1, nullPv, false, false);
+    if (aborted) {
+      return 0;
+    }
+    if (score >= beta) {
+      return score >= MATE_SCORE - 1000 ? beta : score;  // don't trust mates
+                                                         // found by passing
+    }
+  }
+
+  bool futile = features.futility && canPrune && depth <= 2 &&
+                staticEval + FUTILITY_MARGIN[depth] <= alpha;
+
+  std::vector<moveType> moves = position.getMoveList();
+  orderMoves(position, moves, ttMove.from != -1 ? &ttMove : nullptr);
+
+  int bestScore = -INFINITE_SCORE;
+  const moveType* bestMove = nullptr;
+  std::vector<moveType> childPv;
+  int searched = 0;
+  for (const moveType& move : moves) {
+    Board child = position;
+    child.makeMove(move);
+    bool quiet = isQuiet(position, move);
+    bool givesCheck = child.kingInCheck();
+    if (futile && searched > 0 && quiet && !givesCheck) {
+      bestScore = std::max(bestScore, staticEval + FUTILITY_MARGIN[depth]);
+      continue;
+    }
+
+    int score;
+    if (searched == 0) {
+      score =
+          -negamax(child, depth - 1, -beta, -alpha, ply + 1, childPv, pvNode);
+    } else {
+      int reduction = 0;
+      if (features.lmr && depth >= 3 && searched >= (pvNode ? 5 : 3) &&
+          quiet && !inCheck && !givesCheck) {
+        reduction = std::clamp(lateMoveReduction(depth, searched), 0,
+                               depth - 2);
+      }
+      // with pvs the later moves only have to show they're no better than
+      // alpha, which a null window does more cheaply
+      int windowBeta = features.pvs ? alpha + 1 : beta;
+      score = -negamax(child, depth - 1 - reduction, -windowBeta, -alpha,
+                       ply + 1, childPv, false);
+      if (reduction && score > alpha && !aborted) {
+        score = -negamax(child, depth - 1, -windowBeta, -alpha, ply + 1,
+                         childPv, false);
+      }
+      if (features.pvs && score > alpha && score < beta && !aborted) {
+        score = -negamax(child, depth - 1, -beta, -alpha, ply + 1, childPv,
+                         pvNode);
+      }
+    }
+    searched++;
+    if (aborted) {
+      return 0;
+    }
+    if (score > bestScore) {
+      bestScore = score;
+      bestMove = &move;
+      if (score > alpha) {
+        alpha = score;
+        pv.assign(1, move);
+        pv.insert(pv.end(), childPv.begin(), childPv.end());
+      }
+    }
+    if (alpha >= beta) {
+      break;
+    }
+  }
+
+  if (table) {
+    std::uint8_t flag = TranspositionTable::EXACT;
+    if (bestScore <= originalAlpha) {
+      flag = TranspositionTable::UPPER_BOUND;
+    } else if (bestScore >= beta) {
+      flag = TranspositionTable::LOWER_BOUND;
+    }
+    table->store(position.getPositionKey(), depth,
+                 scoreToTable(bestScore, ply), flag, bestMove);
+  }
+  return bestScore;
+}
+
+int Search::searchRoot(const Board& root, const std::vector<moveType>& moves,
+                       int depth, int alpha, int beta,
+                       std::vector<moveType>& pv,
+                       const moveType* previousBest) {
+  int bestScore = -INFINITE_SCORE;
+  std::vector<moveType> childPv;
+  pv.clear();
+  for (std::size_t i = 0; i < moves.size(); ++i) {
+    const moveType& move = moves[i];
+    Board child = root;
+    child.makeMove(move);
+    int score;
+    if (i == 0 || !features.pvs) {
+      score = -negamax(child, depth - 1, -beta, -alpha, 1, childPv, i == 0);
+    } else {
+      score =
+          -negamax(child, depth - 1, -alpha - 1, -alpha, 1, childPv, false);
+      if (score > alpha && score < beta && !aborted) {
+        score = -negamax(child, depth - 1, -beta, -alpha, 1, childPv, true);
+      }
+    }
+    if (aborted) {
+      return 0;
+    }
+    if (score > bestScore) {
+      // kept even when it's below the window, so a fail low still has a
+      // move to widen the window around
+      bestScore = score;
+      pv.assign(1, move);
+      pv.insert(pv.end(), childPv.begin(), childPv.end());
+    }
+    if (score > alpha) {
+      alpha = score;
+      if (previousBest && depth > 1 && !sameMove(move, *previousBest)) {
+        // a new best move mid iteration is already a safe lower bound
+        latest.depth = depth;
+        latest.score = score;
+        latest.pv = pv;
+      }
+    }
+    if (alpha >= beta) {
+      break;
+    }
+  }
+  return bestScore;
+}
+
+moveType Search::think(
+    const Board& root, const SearchLimits& limits,
+    const std::function<void(const SearchInfo&)>& onIteration) {
+  startTime = std::chrono::steady_clock::now();
+  lastReport = startTime;
+  timeManager.start(limits);
+  moveTimeMs = limits.moveTimeMs;
+  pondering = limits.ponder && ponderHit &&
+              !ponderHit->load(std::memory_order_relaxed);
+  hasDeadline = false;
+  if (!pondering) {
+    startClock(startTime);
+  }
+  reportIntervalMs = limits.reportIntervalMs;
+  nodeLimit = limits.nodes;
+  reporter = &onIteration;
+  features = limits.features;
+  aborted = false;
+  nodes = 0;
+  latest = SearchInfo{};
+  if (table) {
+    table->newSearch();
+  }
+
+  std::vector<moveType> rootMoves = root.getMoveList();
+  if (rootMoves.empty()) {
+    return moveType{-1, -1, 0};
+  }
+  moveType bestMove = rootMoves[0];
+  ttEntry entry;
+  if (table && table->probe(root.getPositionKey(), entry)) {
+    for (const moveType& move : rootMoves) {
+      if (move.from == entry.from && move.to == entry.to &&
+          move.promotion == entry.promotion) {
+        bestMove = move;  // start from what the last search thought
+      }
+    }
+  }
+  orderMoves(root, rootMoves, &bestMove);
+  int lineCount =
+      std::clamp(limits.multiPv, 1, static_cast<int>(rootMoves.size()));
+
+  for (int depth = 1; depth <= limits.depth; ++depth) {
+    // multipv searches the root once per line, each time leaving out the
+    // moves already picked. the table carries over between passes so the
+    // later ones are mostly cutoffs
+    std::vector<SearchLine> lines;
+    std::vector<moveType> remaining = rootMoves;
+    for (int pass = 0; pass < lineCount; ++pass) {
+      SearchLine line;
+      // the best line starts in a narrow window around the last score and
+      // widens on whichever side it fell out of. the other lines have no
+      // score of their own to start from
+      int window = ASPIRATION_WINDOW;
+      bool aspirate = features.aspiration && pass == 0 && depth >= 4 &&
+                      std::abs(latest.score) < MATE_SCORE - 1000;
+      int alpha = aspirate ? latest.score - window : -INFINITE_SCORE;
+      int beta = aspirate ? latest.score + window : INFINITE_SCORE;
+      while (true) {
+        line.score = searchRoot(root, remaining, depth, alpha, beta, line.pv,
+                                pass == 0 ? &bestMove : nullptr);
+        if (aborted || (line.score > alpha && line.score < beta)) {
+          break;
+        }
+        window *= 2;
+        if (line.score <= alpha) {
+          alpha = window > 500 ? -INFINITE_SCORE : line.score - window;
+        } else {
+          beta = window > 500 ? INFINITE_SCORE : line.score + window;
+        }
+      }
+      if (aborted) {
+        break;
+      }
+      remaining.erase(std::find_if(
+          remaining.begin(), remaining.end(),
+          [&](const moveType& move) { return sameMove(move, line.pv[0]); }));
+      lines.push_back(std::move(line));
+    }
+    if (aborted) {
+      break;  // a half searched iteration can't be trusted
+    }
+
+    bool bestMoveChanged = !sameMove(lines[0].pv[0], bestMove);
+    bestMove = lines[0].pv[0];
+    // next depth tries the lines in order first, then everything else
+    rootMoves.clear();
+    for (SearchLine& line : lines) {
+      rootMoves.push_back(line.pv[0]);
+      extendPvFromTable(root, line.pv);
+    }
+    rootMoves.insert(rootMoves.end(), remaining.begin(), remaining.end());
+    if (table) {
+      table->store(root.getPositionKey(), depth,
+                   scoreToTable(lines[0].score, 0), TranspositionTable::EXACT,
+                   &bestMove);
+    }
+    latest.depth = depth;
+    latest.score = lines[0].score;
+    latest.pv = lines[0].pv;
+    latest.lines = std::move(lines);
+    report(true);
+    if (latest.score >= MATE_SCORE - 1000 || rootMoves.size() == 1) {
+      break;  // found a forced mate, or there's nothing to think about
+    }
+    timeManager.iterationDone(depth > 1 && bestMoveChanged, latest.timeMs);
+    if (pondering && ponderHit->load(std::memory_order_relaxed)) {
+      startClock(std::chrono::steady_clock::now());
+    }
+    // the iterations searched while pondering count as work done, the time
+    // they took doesn't come off the clock
+    if (!pondering &&
+        !timeManager.startNextIteration(latest.timeMs - clockOffsetMs)) {
+      break;
+    }
+  }
+  // a ponder search that ran out of things to do still can't move before
+  // the opponent has
+  while (pondering && !stopFlag.load(std::memory_order_relaxed) &&
+         !ponderHit->load(std::memory_order_relaxed)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  reporter = nullptr;
+  return bestMove;
+}
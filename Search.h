@@ -0,0 +1,116 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#include "Board.h"
+#include "TimeManager.h"
+#include "TranspositionTable.h"
+
+struct SearchFeatures {  // the selective parts of the search, all on by
+                        // default. chess_selectivity times them one by one
+  bool pvs = true;       // null window for every move after the first, and a
+                         // full one again only if it beats alpha
+  bool nullMove = true;  // pass, and if a shallower search still beats beta
+                         // give up on the node. not in check or with only
+                         // pawns left, where passing would be best
+  bool lmr = true;       // late quiet moves searched shallower first
+  bool futility = true;  // quiet moves skipped near the leaves when the eval
+                         // is too far below alpha for them to matter
+  bool aspiration = true;  // root searched in a window around the last
+                           // depth's score, widened when it falls outside
+};
+
+struct SearchLimits {
+  int depth = 64;       // deepest iteration to search
+  int moveTimeMs = 0;   // 0 means no time limit
+  int timeLeftMs = 0;   // clock of the side to move, 0 if there's no clock.
+                        // the time manager picks how much of it to use
+  int incrementMs = 0;
+  int movesToGo = 0;  // moves until the next time control, 0 for the rest
+                      // of the game
+  long long nodes = 0;  // 0 means no node limit
+  int reportIntervalMs = 0;  // also report mid iteration this often, 0 only
+                             // reports finished iterations
+  int multiPv = 1;  // how many of the best moves to find lines for
+  SearchFeatures features;
+  bool ponder = false;  // searching the position after the reply we expect,
+                        // on the opponent's time. no time limit until the
+                        // ponder hit flag is set, then the clock limits run
+                        // from that moment. the move isn't returned before
+                        // the hit or a stop
+};
+struct SearchLine {  // one of the best moves and where it leads
+  int score = 0;
+  std::vector<moveType> pv;
+};
+struct SearchInfo {  // what we know after each finished iteration
+  int depth = 0;
+  int score = 0;  // centipawns from the point of view of the side to move
+  long long nodes = 0;
+  int timeMs = 0;
+  bool completed = true;  // false for reports sent in the middle of a depth
+  std::vector<moveType> pv;  // principal variation, pv[0] is the best move
+  std::vector<SearchLine> lines;  // best first, as many as multiPv asked
+                                  // for. lines[0] matches score and pv once
+                                  // the iteration is done
+};
+
+class Search {
+ private:
+  const std::atomic<bool>& stopFlag;  // set by another thread to abort
+  TranspositionTable* table;  // optional, shared between searches
+  const std::atomic<bool>* ponderHit;  // set when the expected reply was
+                                       // played, optional
+  std::chrono::steady_clock::time_point startTime;
+  std::chrono::steady_clock::time_point deadline;
+  bool hasDeadline = false;
+  int moveTimeMs = 0;
+  bool pondering = false;  // still waiting for the hit, no clock yet
+  int clockOffsetMs = 0;   // from startTime to when the clock started
+  long long nodeLimit = 0;
+  bool aborted = false;
+  long long nodes = 0;
+  int reportIntervalMs = 0;
+  std::chrono::steady_clock::time_point lastReport;
+  const std::function<void(const SearchInfo&)>* reporter = nullptr;
+  SearchInfo latest;  // best line known so far, sent with each report
+  TimeManager timeManager;
+  SearchFeatures features;
+
+  void report(bool completed);
+  void extendPvFromTable(const Board& root, std::vector<moveType>& pv);
+  int searchRoot(const Board& root, const std::vector<moveType>& moves,
+                 int depth, int alpha, int beta, std::vector<moveType>& pv,
+                 const moveType* previousBest);  // best score among moves,
+                                                 // previousBest is set for
+                                                 // the first multipv pass
+  int negamax(const Board& position, int depth, int alpha, int beta, int ply,
+              std::vector<moveType>& pv, bool pvNode,
+              bool allowNull = true);  // pvNode is true along the first
+                                       // moves searched from the root,
+                                       // allowNull is false straight after
+                                       // a null move
+  int quiescence(const Board& position, int alpha, int beta, int ply);
+  void orderMoves(const Board& position, std::vector<moveType>& moves,
+                  const moveType* bestFirst);
+  bool shouldStop();
+  void startClock(std::chrono::steady_clock::time_point now);
+
+ public:
+  explicit Search(const std::atomic<bool>& stopFlag,
+                  TranspositionTable* table = nullptr,
+                  const std::atomic<bool>* ponderHit = nullptr);
+  moveType think(const Board& root, const SearchLimits& limits,
+                 const std::function<void(const SearchInfo&)>&
+                     onIteration);  // iterative deepening, onIteration is
+                                    // called after every completed depth
+                                    // and every reportIntervalMs
+  long long getNodes() const;
+  const TimeManager& getTimeManager() const;
+};
+
+#endif  // SEARCH_H
@@ -0,0 +1,76 @@
+#include "SelfPlay.h"
+
+#include <fstream>
+#include <sstream>
+
+#include "TranspositionTable.h"
+
+SelfPlayGame playGame(const Board& start, const PlayerConfig& white,
+                      const PlayerConfig& black,
+                      const std::atomic<bool>& stopFlag, int maxPlies) {
+  SelfPlayGame game;
+  Board position = start;
+  TranspositionTable whiteTable(white.hashMegabytes);
+  TranspositionTable blackTable(black.hashMegabytes);
+
+  while (true) {
+    GameStatus status = position.getStatus();
+    if (status == GameStatus::Checkmate) {
+      game.outcome = position.isBlackToMove() ? GameOutcome::WhiteWins
+                                              : GameOutcome::BlackWins;
+      game.reason = "checkmate";
+      return game;
+    }
+    if (status != GameStatus::Ongoing) {
+      game.outcome = GameOutcome::Draw;
+      game.reason = statusText(status);
+      return game;
+    }
+    if (static_cast<int>(game.moves.size()) >= maxPlies) {
+      game.outcome = GameOutcome::Draw;
+      game.reason = "move limit";
+      return game;
+    }
+    if (stopFlag.load(std::memory_order_relaxed)) {
+      game.reason = "stopped";
+      return game;
+    }
+
+    bool blackToMove = position.isBlackToMove();
+    const PlayerConfig& player = blackToMove ? black : white;
+    Search search(stopFlag, blackToMove ? &blackTable : &whiteTable);
+    int score = 0;
+    moveType move =
+        search.think(position, player.limits, [&](const SearchInfo& info) {
+          if (info.completed) {
+            score = info.score;
+          }
+        });
+    if (move.from < 0) {
+      game.reason = "stopped";
+      return game;
+    }
+    position.makeMove(move);
+    game.moves.push_back(move);
+    game.scores.push_back(score);
+  }
+}
+
+std::vector<Board> loadOpenings(const std::string& path) {
+  std::vector<Board> openings;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    std::string placement, side, castling, enPassant;
+    if (!(fields >> placement >> side >> castling >> enPassant)) {
+      continue;
+    }
+    Board board;
+    if (board.loadFen(placement + " " + side + " " + castling + " " +
+                      enPassant + " 0 1")) {
+      openings.push_back(board);
+    }
+  }
+  return openings;
+}
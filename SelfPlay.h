@@ -0,0 +1,38 @@
+#ifndef SELFPLAY_H
+#define SELFPLAY_H
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Board.h"
+#include "Search.h"
+
+struct PlayerConfig {  // one side of an engine vs engine game
+  std::string name = "engine";
+  SearchLimits limits;
+  std::size_t hashMegabytes = 16;
+};
+
+enum class GameOutcome { WhiteWins, BlackWins, Draw, Unfinished };
+
+struct SelfPlayGame {
+  GameOutcome outcome = GameOutcome::Unfinished;
+  std::string reason;  // "checkmate", "stalemate", "fifty moves" etc
+  std::vector<moveType> moves;
+  std::vector<int> scores;  // search score for each move, from the point of
+                            // view of the side that played it
+};
+
+// plays one game from start, each side searching with its own table. stops
+// early (Unfinished) if stopFlag gets set
+SelfPlayGame playGame(const Board& start, const PlayerConfig& white,
+                      const PlayerConfig& black,
+                      const std::atomic<bool>& stopFlag, int maxPlies = 400);
+
+// reads an EPD/FEN file, one position per line. only the first four fields
+// are used, so EPD operations after them are ignored
+std::vector<Board> loadOpenings(const std::string& path);
+
+#endif  // SELFPLAY_H
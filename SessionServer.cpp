@@ -0,0 +1,339 @@
+#include "SessionServer.h"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#include "Search.h"
+
+namespace {
+
+constexpr std::size_t MAX_LINE = 512;  // a fen is under 100, anything much
+                                       // longer isn't a request
+
+std::string statusWord(GameStatus status) {
+  std::string word = statusText(status);
+  std::replace(word.begin(), word.end(), ' ', '_');
+  return word;
+}
+
+std::string error(std::uint64_t id, const std::string& reason) {
+  return "error " + std::to_string(id) + " " + reason;
+}
+
+}  // namespace
+
+bool requestSessionId(const std::string& line, std::uint64_t& id) {
+  std::istringstream words(line);
+  std::string command;
+  return static_cast<bool>(words >> command >> id);
+}
+
+SessionShard::SessionShard(const ServerConfig& config,
+                           std::atomic<long long>& sessionCount)
+    : config(config), sessionCount(sessionCount), table(config.hashMegabytes) {}
+
+void SessionShard::playMove(gameSession& session, Board& board,
+                            const moveType& move) {
+  session.earlierKeys.push_back(board.getPositionKey());
+  board.makeMove(move);
+  if (board.getHalfmoveClock() == 0) {
+    session.earlierKeys.clear();  // nothing before a capture or pawn move
+                                  // can come back
+  }
+  session.position = board.snapshot();
+}
+
+std::string SessionShard::handle(const std::string& line) {
+  std::istringstream words(line);
+  std::string command;
+  std::uint64_t id = 0;
+  if (!(words >> command >> id)) {
+    return "error - bad request";
+  }
+  std::string ok = "ok " + std::to_string(id);
+
+  if (command == "new") {
+    Board board;
+    std::string fen;
+    std::getline(words >> std::ws, fen);
+    if (!fen.empty() && !board.loadFen(fen)) {
+      return error(id, "bad fen");
+    }
+    int kings[2] = {0, 0};
+    for (int i = 0; i < 64; ++i) {
+      if (board.getPiece(i) % 8 == 6) {
+        kings[board.getPiece(i) / 8]++;
+      }
+    }
+    if (kings[0] != 1 || kings[1] != 1) {
+      return error(id, "needs one king each");  // the move generator
+                                                // assumes it
+    }
+    auto found = sessions.find(id);
+    if (found == sessions.end()) {
+      if (sessionCount.fetch_add(1) >= config.maxSessions) {
+        sessionCount.fetch_sub(1);
+        return error(id, "too many sessions");
+      }
+      found = sessions.emplace(id, gameSession{}).first;
+    }
+    found->second.position = board.snapshot();
+    found->second.earlierKeys.clear();
+    return ok + " " + board.toFen();
+  }
+
+  auto found = sessions.find(id);
+  if (found == sessions.end()) {
+    return error(id, "no such session");
+  }
+  gameSession& session = found->second;
+  if (command == "end") {
+    sessions.erase(found);
+    sessionCount.fetch_sub(1);
+    return ok;
+  }
+
+  Board board;
+  board.restore(session.position, session.earlierKeys);
+  if (command == "fen") {
+    return ok + " " + board.toFen();
+  }
+  if (command == "status") {
+    return ok + " " + statusWord(board.getStatus()) +
+           (board.isBlackToMove() ? " black" : " white");
+  }
+  if (command == "moves") {
+    std::string reply = ok;
+    for (const moveType& move : board.getMoveList()) {
+      reply += " " + moveToText(move);
+    }
+    return reply;
+  }
+  if (command == "move" || command == "go") {
+    if (board.getStatus() != GameStatus::Ongoing) {
+      return error(id, "game is over");
+    }
+    moveType chosen{-1, -1, 0};
+    if (command == "move") {
+      std::string text;
+      words >> text;
+      chosen = moveFromText(text);
+      chosen.typeOfMove = board.moveKind(chosen.from, chosen.to);
+      if (chosen.typeOfMove == 5 && chosen.promotion == 0) {
+        chosen.promotion = 5;  // "e7e8" means a queen
+      }
+      if (!board.isLegal(chosen)) {
+        return error(id, "illegal move");
+      }
+    } else {
+      long long nodes = 0;
+      words >> nodes;
+      SearchLimits limits;
+      limits.nodes = std::clamp(nodes, 1LL, config.maxEngineNodes);
+      Search search(stopFlag, &table);
+      chosen = search.think(board, limits, [](const SearchInfo&) {});
+    }
+    playMove(session, board, chosen);
+    return ok + " " + moveToText(chosen) + " " +
+           statusWord(board.getStatus());
+  }
+  return error(id, "unknown command");
+}
+
+struct SessionServer::Connection {
+  int fd;
+  std::string readBuffer;  // only the poll thread touches this
+  std::mutex writeMutex;   // workers answer from their own threads
+  std::atomic<bool> broken{false};
+
+  explicit Connection(int fd) : fd(fd) {}
+  ~Connection() { ::close(fd); }  // after the last queued answer is sent
+
+  void send(const std::string& text) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    std::size_t sent = 0;
+    while (!broken && sent < text.size()) {
+      ssize_t result = ::send(fd, text.data() + sent, text.size() - sent,
+                              MSG_NOSIGNAL);
+      if (result <= 0) {
+        // gone, or hasn't read anything for the whole send timeout. either
+        // way it loses the connection rather than holding a worker up
+        broken = true;
+        shutdown(fd, SHUT_RDWR);
+        return;
+      }
+      sent += static_cast<std::size_t>(result);
+    }
+  }
+};
+
+SessionServer::SessionServer(const ServerConfig& config) : config(config) {
+  if (pipe(wakePipe) != 0) {
+    std::cout << "couldn't make the wake up pipe" << std::endl;
+  }
+  int workerCount = std::max(1, config.workers);
+  for (int i = 0; i < workerCount; ++i) {
+    shards.push_back(
+        std::make_unique<SessionShard>(this->config, sessionCount));
+    queues.push_back(std::make_unique<BoundedQueue<Job>>(config.queueSize));
+  }
+  for (int i = 0; i < workerCount; ++i) {
+    workers.emplace_back(&SessionServer::workerLoop, this, i);
+  }
+}
+
+SessionServer::~SessionServer() {
+  for (auto& queue : queues) {
+    queue->close();
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  if (listenFd >= 0) {
+    ::close(listenFd);
+  }
+  ::close(wakePipe[0]);
+  ::close(wakePipe[1]);
+}
+
+bool SessionServer::listenTcp(int port) {
+  listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  int yes = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(static_cast<std::uint16_t>(port));
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (listenFd < 0 ||
+      bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) !=
+          0 ||
+      listen(listenFd, 128) != 0) {
+    std::cout << "couldn't listen on port " << port << ": "
+              << std::strerror(errno) << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool SessionServer::listenUnix(const std::string& path) {
+  listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    std::cout << "socket path is too long: " << path << std::endl;
+    return false;
+  }
+  std::strcpy(address.sun_path, path.c_str());
+  unlink(path.c_str());  // left over from a server that didn't clean up
+  if (listenFd < 0 ||
+      bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) !=
+          0 ||
+      listen(listenFd, 128) != 0) {
+    std::cout << "couldn't listen on " << path << ": " << std::strerror(errno)
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void SessionServer::workerLoop(int index) {
+  Job job;
+  while (queues[index]->pop(job)) {
+    std::string reply = shards[index]->handle(job.line);
+    reply += '\n';
+    job.connection->send(reply);
+    requestCount.fetch_add(1, std::memory_order_relaxed);
+    job.connection.reset();  // don't hold the socket open while waiting
+  }
+}
+
+void SessionServer::run() {
+  std::vector<pollfd> polled;
+  std::vector<std::shared_ptr<Connection>> connections;  // lines up with
+                                                         // polled from 2
+  polled.push_back({wakePipe[0], POLLIN, 0});
+  polled.push_back({listenFd, POLLIN, 0});
+  char buffer[4096];
+  while (true) {
+    if (poll(polled.data(), polled.size(), -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (polled[0].revents) {
+      break;  // stop() was called
+    }
+    if (polled[1].revents & POLLIN) {
+      int fd = accept(listenFd, nullptr, nullptr);
+      if (fd >= 0) {
+        timeval timeout{1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        int yes = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        polled.push_back({fd, POLLIN, 0});
+        connections.push_back(std::make_shared<Connection>(fd));
+      }
+    }
+    for (std::size_t i = 2; i < polled.size(); ++i) {
+      if (!polled[i].revents) {
+        continue;
+      }
+      Connection& connection = *connections[i - 2];
+      ssize_t count = recv(polled[i].fd, buffer, sizeof(buffer), 0);
+      if (count > 0) {
+        connection.readBuffer.append(buffer, static_cast<std::size_t>(count));
+        std::size_t start = 0;
+        std::size_t end;
+        while ((end = connection.readBuffer.find('\n', start)) !=
+               std::string::npos) {
+          std::string line = connection.readBuffer.substr(start, end - start);
+          start = end + 1;
+          if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+          }
+          std::uint64_t id;
+          if (!requestSessionId(line, id)) {
+            connection.send("error - bad request\n");
+            continue;
+          }
+          // the same session always goes to the same worker, which is
+          // what keeps its requests in order
+          std::size_t worker =
+              (id * 0x9E3779B97F4A7C15ULL >> 32) % queues.size();
+          queues[worker]->push(Job{connections[i - 2], std::move(line)});
+        }
+        connection.readBuffer.erase(0, start);
+      }
+      if (count <= 0 || connection.broken ||
+          connection.readBuffer.size() > MAX_LINE) {
+        // closed, or sending something that isn't lines. queued requests
+        // still finish, the socket closes after the last one
+        shutdown(polled[i].fd, SHUT_RD);
+        polled.erase(polled.begin() + i);
+        connections.erase(connections.begin() + (i - 2));
+        --i;
+      }
+    }
+  }
+}
+
+void SessionServer::stop() {
+  char byte = 0;
+  ssize_t ignored = write(wakePipe[1], &byte, 1);
+  (void)ignored;
+}
+
+long long SessionServer::getRequestCount() const { return requestCount; }
+
+long long SessionServer::getSessionCount() const { return sessionCount; }
@@ -0,0 +1,97 @@
+#ifndef SESSIONSERVER_H
+#define SESSIONSERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Board.h"
+#include "BoundedQueue.h"
+#include "TranspositionTable.h"
+
+struct ServerConfig {
+  int workers = 4;
+  long long maxSessions = 100000;  // across all workers
+  std::size_t queueSize = 1024;    // requests waiting per worker
+  int hashMegabytes = 4;           // per worker, for engine replies
+  long long maxEngineNodes = 200000;
+};
+struct gameSession {  // all a session keeps between requests
+  positionSnapshot position;
+  std::vector<std::uint64_t> earlierKeys;  // since the last capture or pawn
+                                           // move, at most ~100 of them
+};
+
+// the sessions that hash to one worker. only that worker's thread touches
+// them, so requests for a session are handled in the order they came in
+// without any locking. one line in, one line out:
+//   new <id> [fen]        ok <id> <fen>
+//   move <id> <e2e4>      ok <id> <e2e4> <status>
+//   go <id> <nodes>       ok <id> <move> <status>  (engine plays a move)
+//   moves <id>            ok <id> <move> <move> ...
+//   status <id>           ok <id> <status> <white|black>
+//   fen <id>              ok <id> <fen>
+//   end <id>              ok <id>
+// anything that fails answers "error <id> <reason>"
+class SessionShard {
+ private:
+  const ServerConfig& config;
+  std::atomic<long long>& sessionCount;  // shared by the shards for the limit
+  std::unordered_map<std::uint64_t, gameSession> sessions;
+  TranspositionTable table;
+  std::atomic<bool> stopFlag{false};  // never set, Search wants one
+
+  void playMove(gameSession& session, Board& board, const moveType& move);
+
+ public:
+  SessionShard(const ServerConfig& config,
+               std::atomic<long long>& sessionCount);
+  std::string handle(const std::string& line);
+};
+
+bool requestSessionId(const std::string& line,
+                      std::uint64_t& id);  // the second word of a request
+
+// accepts connections on a local tcp port or unix socket. one thread reads
+// every connection with poll and hands each request line to the worker that
+// owns its session, the worker answers on the same connection. requests on
+// one connection can be answered out of order when they're for different
+// sessions, which is why every answer carries the session id
+class SessionServer {
+ private:
+  struct Connection;
+  struct Job {
+    std::shared_ptr<Connection> connection;
+    std::string line;
+  };
+
+  ServerConfig config;
+  int listenFd = -1;
+  int wakePipe[2] = {-1, -1};  // stop() writes here to break out of poll
+  std::atomic<long long> sessionCount{0};
+  std::atomic<long long> requestCount{0};
+  std::vector<std::unique_ptr<SessionShard>> shards;
+  std::vector<std::unique_ptr<BoundedQueue<Job>>> queues;
+  std::vector<std::thread> workers;
+
+  void workerLoop(int index);
+
+ public:
+  explicit SessionServer(const ServerConfig& config);
+  ~SessionServer();
+  SessionServer(const SessionServer&) = delete;
+  SessionServer& operator=(const SessionServer&) = delete;
+
+  bool listenTcp(int port);  // on 127.0.0.1 only
+  bool listenUnix(const std::string& path);
+  void run();   // serves on the calling thread until stop
+  void stop();  // safe from any thread or a signal handler
+  long long getRequestCount() const;
+  long long getSessionCount() const;
+};
+
+#endif  // SESSIONSERVER_H
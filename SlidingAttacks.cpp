@@ -0,0 +1,460 @@
+#include "SlidingAttacks.h"
+
+#include <mutex>
+#include <random>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#include <immintrin.h>
+#define SLIDER_X86
+#endif
+
+// the kogge-stone kernel is built for avx2 as well as the baseline, the same
+// way as the batch evaluator
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && \
+    defined(__linux__)
+#define SLIDER_TARGETS __attribute__((target_clones("avx2", "default")))
+#else
+#define SLIDER_TARGETS
+#endif
+
+namespace {
+
+// same order as sliders in Board.cpp: up, up right, right, down right, down,
+// down left, left, up left. even ones are rook directions, odd ones bishop
+constexpr int directionX[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+constexpr int directionY[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+
+constexpr std::array<std::array<std::uint64_t, 8>, 64> makeRays() {
+  std::array<std::array<std::uint64_t, 8>, 64> rays{};
+  for (int square = 0; square < 64; ++square) {
+    for (int dir = 0; dir < 8; ++dir) {
+      int x = square % 8 + directionX[dir];
+      int y = square / 8 + directionY[dir];
+      for (; x >= 0 && x < 8 && y >= 0 && y < 8;
+           x += directionX[dir], y += directionY[dir]) {
+        rays[square][dir] |= 1ULL << (x + 8 * y);
+      }
+    }
+  }
+  return rays;
+}
+
+int popcount(std::uint64_t bits) {
+  int count = 0;
+  for (; bits; bits &= bits - 1) {
+    count++;
+  }
+  return count;
+}
+
+// --- loop ---
+
+std::uint64_t loopAttacks(int square, std::uint64_t occupied,
+                          int firstDirection) {
+  std::uint64_t attacks = 0;
+  for (int dir = firstDirection; dir < 8; dir += 2) {
+    std::uint64_t ray = sliderRays[square][dir];
+    // nearest square first: up the board is down the bit order
+    bool towardsH1 = dir >= 2 && dir <= 5;
+    while (ray) {
+      int i = towardsH1 ? lowestBit(ray) : highestBit(ray);
+      attacks |= 1ULL << i;
+      if (occupied >> i & 1) {
+        break;
+      }
+      ray &= ~(1ULL << i);
+    }
+  }
+  return attacks;
+}
+
+std::uint64_t loopRook(int square, std::uint64_t occupied) {
+  return loopAttacks(square, occupied, 0);
+}
+
+std::uint64_t loopBishop(int square, std::uint64_t occupied) {
+  return loopAttacks(square, occupied, 1);
+}
+
+// --- kogge-stone ---
+
+constexpr std::uint64_t FILE_A = 0x0101010101010101ULL;
+constexpr std::uint64_t NOT_A = ~FILE_A;
+constexpr std::uint64_t NOT_H = ~(FILE_A << 7);
+
+#if defined(__GNUC__) || defined(__clang__)
+
+// the four rays of a rook or bishop side by side. the first two lanes
+// shift up the bit order (towards h1), the last two down it
+typedef std::uint64_t lanes4 __attribute__((vector_size(32)));
+
+SLIDER_TARGETS
+std::uint64_t koggeStoneFill(std::uint64_t piece, std::uint64_t occupied,
+                             bool bishop) {
+  const lanes4 up = {~0ULL, ~0ULL, 0, 0};
+  const lanes4 down = ~up;
+  lanes4 step = bishop ? lanes4{9, 7, 7, 9} : lanes4{1, 8, 1, 8};
+  lanes4 mask = bishop ? lanes4{NOT_A, NOT_H, NOT_A, NOT_H}
+                       : lanes4{NOT_A, ~0ULL, NOT_H, ~0ULL};
+  lanes4 gen = {piece, piece, piece, piece};
+  lanes4 pro = lanes4{~occupied, ~occupied, ~occupied, ~occupied} & mask;
+  // fill 1, 2 then 4 squares further each round, through empty squares only
+  lanes4 amount = step;
+  for (int round = 0; round < 3; ++round) {
+    gen |= pro & (((gen << amount) & up) | ((gen >> amount) & down));
+    pro &= ((pro << amount) & up) | ((pro >> amount) & down);
+    amount += amount;
+  }
+  lanes4 attacks = (((gen << step) & up) | ((gen >> step) & down)) & mask;
+  return attacks[0] | attacks[1] | attacks[2] | attacks[3];
+}
+
+std::uint64_t koggeStoneRook(int square, std::uint64_t occupied) {
+  return koggeStoneFill(1ULL << square, occupied, false);
+}
+
+std::uint64_t koggeStoneBishop(int square, std::uint64_t occupied) {
+  return koggeStoneFill(1ULL << square, occupied, true);
+}
+
+#else
+
+// one ray at a time where there are no vector extensions
+std::uint64_t koggeStoneRay(std::uint64_t gen, std::uint64_t empty, int step,
+                            std::uint64_t mask) {
+  auto shift = [&](std::uint64_t bits, int amount) {
+    return amount > 0 ? bits << amount : bits >> -amount;
+  };
+  std::uint64_t pro = empty & mask;
+  gen |= pro & shift(gen, step);
+  pro &= shift(pro, step);
+  gen |= pro & shift(gen, 2 * step);
+  pro &= shift(pro, 2 * step);
+  gen |= pro & shift(gen, 4 * step);
+  return shift(gen, step) & mask;
+}
+
+std::uint64_t koggeStoneRook(int square, std::uint64_t occupied) {
+  std::uint64_t piece = 1ULL << square;
+  return koggeStoneRay(piece, ~occupied, 1, NOT_A) |
+         koggeStoneRay(piece, ~occupied, 8, ~0ULL) |
+         koggeStoneRay(piece, ~occupied, -1, NOT_H) |
+         koggeStoneRay(piece, ~occupied, -8, ~0ULL);
+}
+
+std::uint64_t koggeStoneBishop(int square, std::uint64_t occupied) {
+  std::uint64_t piece = 1ULL << square;
+  return koggeStoneRay(piece, ~occupied, 9, NOT_A) |
+         koggeStoneRay(piece, ~occupied, 7, NOT_H) |
+         koggeStoneRay(piece, ~occupied, -7, NOT_A) |
+         koggeStoneRay(piece, ~occupied, -9, NOT_H);
+}
+
+#endif
+
+// --- magic and pext ---
+
+struct slidingTable {
+  std::uint64_t mask;  // squares that can block, without the edges
+  std::uint64_t magic;
+  int shift;
+  std::uint64_t* attacks;  // 1 << popcount(mask) entries
+};
+
+struct slidingTables {
+  slidingTable rook[64];
+  slidingTable bishop[64];
+  std::vector<std::uint64_t> attacks;
+};
+
+// found by the search in buildTables and kept here, searching for them again
+// takes about a second. buildTables checks each one and only searches if it
+// doesn't work
+constexpr std::uint64_t rookMagics[64] = {
+    0x0280132180004001ULL, 0x0140001000200040ULL, 0x0880200010000880ULL,
+    0x2080080005801000ULL, 0x0200041020080200ULL, 0x0200041041084200ULL,
+    0x0400080081124410ULL, 0x2180042100004080ULL, 0x8000800099644000ULL,
+    0x0802003040820100ULL, 0x0105801001862000ULL, 0x0101002008100100ULL,
+    0x1000800400080080ULL, 0x0804800200040080ULL, 0x2001800200800900ULL,
+    0x00160004088204c1ULL, 0x228000c001402000ULL, 0x8510004000200050ULL,
+    0x3001848020029000ULL, 0x0280808010000801ULL, 0x0109010010040800ULL,
+    0x8000808004000200ULL, 0x8000040081021028ULL, 0x40040a0009004884ULL,
+    0x80c0004280008035ULL, 0x0010004040002000ULL, 0x1101200500410070ULL,
+    0x8410100080080080ULL, 0x000c080080800400ULL, 0x4012008080040002ULL,
+    0x4000040101000200ULL, 0x0061010200008044ULL, 0x0080804010800020ULL,
+    0x3000201008400040ULL, 0x4112008012002444ULL, 0x0848000880801000ULL,
+    0x00a8008008800400ULL, 0x200200280a00500cULL, 0x080a221024004801ULL,
+    0xc400008042000104ULL, 0x8000400080028022ULL, 0x0220008040018020ULL,
+    0x4000200011010040ULL, 0x10060040210a0010ULL, 0x40820020904a0004ULL,
+    0x0030040002008080ULL, 0x0200020801840010ULL, 0x0084c04100820004ULL,
+    0x4802010080c2a600ULL, 0x0000400080201880ULL, 0x2040801000200080ULL,
+    0x0180200842001200ULL, 0x0013510008000500ULL, 0x0182000c00808a80ULL,
+    0x1000524821302400ULL, 0x3800040108488200ULL, 0x104a004810210082ULL,
+    0x0004210010420082ULL, 0xc424110008200241ULL, 0x90101000a0088501ULL,
+    0x0182000420100802ULL, 0x4822001001080402ULL, 0x05d0080090012204ULL,
+    0x2008140089042846ULL,
+};
+constexpr std::uint64_t bishopMagics[64] = {
+    0x0c08081028882700ULL, 0x0208088820424040ULL, 0x2188480100202561ULL,
+    0x0004104610800140ULL, 0x9004504100002000ULL, 0x0a010108c0010041ULL,
+    0x3800491028200000ULL, 0x0000802101202002ULL, 0x81020410b0810100ULL,
+    0x0408082808404040ULL, 0x0106220084008008ULL, 0x0040182841001082ULL,
+    0x158404504000800eULL, 0x0888810108432808ULL, 0x0100020811180808ULL,
+    0x0801420a02410400ULL, 0x1320559102103101ULL, 0x0182002002240102ULL,
+    0xa910000200260020ULL, 0x0008010628210000ULL, 0x8002000402114461ULL,
+    0x0000204410080800ULL, 0x0400500205100900ULL, 0x2002014880840100ULL,
+    0x01e1100108102148ULL, 0x0410090044115400ULL, 0x4004084010104040ULL,
+    0x0202002008008220ULL, 0x0001001105004020ULL, 0x0001081022080400ULL,
+    0x2018842000820806ULL, 0x40008e0000210401ULL, 0x2314104102082200ULL,
+    0x0002100500101109ULL, 0x1224040201411200ULL, 0x0202004040040102ULL,
+    0x0040002022020080ULL, 0x2020004081210080ULL, 0x0442020404004401ULL,
+    0x0408c08a00090104ULL, 0x0898a21821004003ULL, 0xb004189210424820ULL,
+    0x8008131088031000ULL, 0x0009010148010500ULL, 0x2100084104000040ULL,
+    0x110102108200a100ULL, 0x0010120801144060ULL, 0x0002020a24200200ULL,
+    0x0020880808040000ULL, 0x0a8b041201040103ULL, 0x0140120205114002ULL,
+    0x6282000242021201ULL, 0x080080140d0c0122ULL, 0x0181102011810200ULL,
+    0x0804041032420400ULL, 0x0020842c00414142ULL, 0x06498028010c2082ULL,
+    0x0062202084042010ULL, 0x8100000211008800ULL, 0x6000000000840400ULL,
+    0x0018000008210100ULL, 0x00040011a0010100ULL, 0x0820090210020204ULL,
+    0x0402482804858200ULL,
+};
+
+slidingTables magicTables;
+slidingTables pextTables;
+std::once_flag magicBuilt;
+std::once_flag pextBuilt;
+
+// the squares a piece on square could be blocked by. the last square of a
+// ray never blocks anything further, so it's left out
+std::uint64_t blockerMask(int square, int firstDirection) {
+  std::uint64_t mask = 0;
+  for (int dir = firstDirection; dir < 8; dir += 2) {
+    std::uint64_t ray = sliderRays[square][dir];
+    bool towardsH1 = dir >= 2 && dir <= 5;
+    if (ray) {
+      ray &= ~(1ULL << (towardsH1 ? highestBit(ray) : lowestBit(ray)));
+    }
+    mask |= ray;
+  }
+  return mask;
+}
+
+std::uint64_t softwarePext(std::uint64_t bits, std::uint64_t mask) {
+  std::uint64_t result = 0;
+  for (std::uint64_t bit = 1; mask; mask &= mask - 1, bit <<= 1) {
+    if (bits & mask & -mask) {
+      result |= bit;
+    }
+  }
+  return result;
+}
+
+// fills in one piece type's tables. with magics it searches for a magic
+// number per square that maps every blocker set to its own slot (or one with
+// the same attacks), with pext the slot is just the blockers' bits packed
+// together
+void buildTables(slidingTable (&tables)[64], int firstDirection,
+                 const std::uint64_t* knownMagics, std::uint64_t* next,
+                 bool magic) {
+  std::mt19937_64 random(728);  // fixed, so every run builds the same table
+  std::vector<std::uint64_t> blockers;
+  std::vector<std::uint64_t> reference;
+  std::vector<int> tried;
+  for (int square = 0; square < 64; ++square) {
+    slidingTable& table = tables[square];
+    table.mask = blockerMask(square, firstDirection);
+    int bits = popcount(table.mask);
+    table.shift = 64 - bits;
+    table.attacks = next;
+    next += 1ULL << bits;
+
+    // every subset of the mask (carry rippler)
+    blockers.clear();
+    reference.clear();
+    std::uint64_t subset = 0;
+    do {
+      blockers.push_back(subset);
+      reference.push_back(loopAttacks(square, subset, firstDirection));
+      subset = (subset - table.mask) & table.mask;
+    } while (subset);
+
+    if (!magic) {
+      table.magic = 0;
+      for (std::size_t i = 0; i < blockers.size(); ++i) {
+        table.attacks[softwarePext(blockers[i], table.mask)] = reference[i];
+      }
+      continue;
+    }
+    tried.assign(blockers.size(), 0);
+    for (int attempt = 1;; ++attempt) {
+      // few set bits make better magics
+      std::uint64_t candidate = attempt == 1 ? knownMagics[square]
+                                             : random() & random() & random();
+      if (attempt > 1 && popcount((table.mask * candidate) >> 56) < 6) {
+        continue;
+      }
+      bool works = true;
+      for (std::size_t i = 0; works && i < blockers.size(); ++i) {
+        std::size_t slot = (blockers[i] * candidate) >> table.shift;
+        if (tried[slot] < attempt) {
+          tried[slot] = attempt;
+          table.attacks[slot] = reference[i];
+        } else if (table.attacks[slot] != reference[i]) {
+          works = false;
+        }
+      }
+      if (works) {
+        table.magic = candidate;
+        break;
+      }
+    }
+  }
+}
+
+void buildAll(slidingTables& tables, bool magic) {
+  tables.attacks.assign(102400 + 5248, 0);  // 2^popcount(mask) summed over
+                                            // the squares
+  buildTables(tables.rook, 0, rookMagics, tables.attacks.data(), magic);
+  buildTables(tables.bishop, 1, bishopMagics, tables.attacks.data() + 102400,
+              magic);
+}
+
+std::uint64_t magicRook(int square, std::uint64_t occupied) {
+  const slidingTable& table = magicTables.rook[square];
+  return table.attacks[((occupied & table.mask) * table.magic) >> table.shift];
+}
+
+std::uint64_t magicBishop(int square, std::uint64_t occupied) {
+  const slidingTable& table = magicTables.bishop[square];
+  return table.attacks[((occupied & table.mask) * table.magic) >> table.shift];
+}
+
+#ifdef SLIDER_X86
+
+__attribute__((target("bmi2"))) std::uint64_t pextRook(
+    int square, std::uint64_t occupied) {
+  const slidingTable& table = pextTables.rook[square];
+  return table.attacks[_pext_u64(occupied, table.mask)];
+}
+
+__attribute__((target("bmi2"))) std::uint64_t pextBishop(
+    int square, std::uint64_t occupied) {
+  const slidingTable& table = pextTables.bishop[square];
+  return table.attacks[_pext_u64(occupied, table.mask)];
+}
+
+bool cpuHasBmi2() {
+  unsigned a, b, c, d;
+  return __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b >> 8 & 1);
+}
+
+// zen 1 and 2 do pext in microcode, tens of cycles, so magics win there
+bool cpuHasSlowPext() {
+  unsigned a, b, c, d;
+  if (!__get_cpuid(0, &a, &b, &c, &d) || b != 0x68747541) {  // "Auth"enticAMD
+    return false;
+  }
+  __get_cpuid(1, &a, &b, &c, &d);
+  unsigned family = a >> 8 & 0xf;
+  if (family == 0xf) {
+    family += a >> 20 & 0xff;
+  }
+  return family < 0x19;
+}
+
+#else
+
+bool cpuHasBmi2() { return false; }
+bool cpuHasSlowPext() { return false; }
+
+#endif
+
+SliderBackend selected = SliderBackend::Loop;
+
+// switches to the best backend while the program starts, before main. until
+// then (other static initialisers) the loop kernel is used
+struct startupSelection {
+  startupSelection() { setSliderBackend(fastestSliderBackend()); }
+} startup;
+
+}  // namespace
+
+constexpr std::array<std::array<std::uint64_t, 8>, 64> sliderRays = makeRays();
+
+sliderKernels activeSliders = {loopRook, loopBishop};
+
+std::uint64_t occupancyOf(const std::array<int, 64>& squares) {
+  std::uint64_t occupied = 0;
+  for (int i = 0; i < 64; ++i) {
+    occupied |= static_cast<std::uint64_t>(squares[i] != 0) << i;
+  }
+  return occupied;
+}
+
+bool sliderBackendSupported(SliderBackend backend) {
+  return backend != SliderBackend::Pext || cpuHasBmi2();
+}
+
+SliderBackend fastestSliderBackend() {
+  if (cpuHasBmi2() && !cpuHasSlowPext()) {
+    return SliderBackend::Pext;
+  }
+  return SliderBackend::Magic;
+}
+
+bool setSliderBackend(SliderBackend backend) {
+  if (!sliderBackendSupported(backend)) {
+    return false;
+  }
+  switch (backend) {
+    case SliderBackend::Loop:
+      activeSliders = {loopRook, loopBishop};
+      break;
+    case SliderBackend::KoggeStone:
+      activeSliders = {koggeStoneRook, koggeStoneBishop};
+      break;
+    case SliderBackend::Magic:
+      std::call_once(magicBuilt, [] { buildAll(magicTables, true); });
+      activeSliders = {magicRook, magicBishop};
+      break;
+    case SliderBackend::Pext:
+#ifdef SLIDER_X86
+      std::call_once(pextBuilt, [] { buildAll(pextTables, false); });
+      activeSliders = {pextRook, pextBishop};
+#endif
+      break;
+  }
+  selected = backend;
+  return true;
+}
+
+SliderBackend getSliderBackend() { return selected; }
+
+const char* sliderBackendName(SliderBackend backend) {
+  switch (backend) {
+    case SliderBackend::Loop:
+      return "loop";
+    case SliderBackend::KoggeStone:
+      return "kogge-stone";
+    case SliderBackend::Magic:
+      return "magic";
+    case SliderBackend::Pext:
+      return "pext";
+  }
+  return "?";
+}
+
+bool sliderBackendFromName(const std::string& name, SliderBackend& backend) {
+  for (SliderBackend candidate :
+       {SliderBackend::Loop, SliderBackend::KoggeStone, SliderBackend::Magic,
+        SliderBackend::Pext}) {
+    if (name == sliderBackendName(candidate)) {
+      backend = candidate;
+      return true;
+    }
+  }
+  return false;
+}
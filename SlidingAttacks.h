@@ -0,0 +1,79 @@
+#ifndef SLIDINGATTACKS_H
+#define SLIDINGATTACKS_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+// rook and bishop attacks as bitboards (bit i is board index i, so bit 0 is
+// a8) worked out from the set of occupied squares. the attack set includes
+// the first piece in the way on each ray, whichever colour it is. there are
+// a few interchangeable ways of computing them, the fastest one this cpu has
+// is picked when the program starts and setSliderBackend switches to another
+enum class SliderBackend {
+  Loop,        // steps along each ray, the reference the others are checked
+               // against
+  KoggeStone,  // parallel prefix fill of all four rays at once, no tables
+  Magic,       // fancy magic bitboards, ~840 KB of tables
+  Pext         // bmi2 pext index into the same size of tables
+};
+
+struct sliderKernels {
+  std::uint64_t (*rook)(int square, std::uint64_t occupied);
+  std::uint64_t (*bishop)(int square, std::uint64_t occupied);
+};
+extern sliderKernels activeSliders;  // the selected backend's
+
+inline std::uint64_t rookAttackBits(int square, std::uint64_t occupied) {
+  return activeSliders.rook(square, occupied);
+}
+inline std::uint64_t bishopAttackBits(int square, std::uint64_t occupied) {
+  return activeSliders.bishop(square, occupied);
+}
+inline std::uint64_t queenAttackBits(int square, std::uint64_t occupied) {
+  return activeSliders.rook(square, occupied) |
+         activeSliders.bishop(square, occupied);
+}
+
+extern const std::array<std::array<std::uint64_t, 8>, 64> sliderRays;
+inline std::uint64_t rayBits(int square, int direction) {
+  return sliderRays[square][direction];  // every square from square to the
+                                         // edge along sliders[direction]
+                                         // (Board.cpp), not including square
+}
+
+inline int lowestBit(std::uint64_t bits) {  // bits can't be 0
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(bits);
+#else
+  int i = 0;
+  while (!(bits >> i & 1)) {
+    i++;
+  }
+  return i;
+#endif
+}
+inline int highestBit(std::uint64_t bits) {  // bits can't be 0
+#if defined(__GNUC__) || defined(__clang__)
+  return 63 - __builtin_clzll(bits);
+#else
+  int i = 63;
+  while (!(bits >> i & 1)) {
+    i--;
+  }
+  return i;
+#endif
+}
+std::uint64_t occupancyOf(const std::array<int, 64>& squares);
+
+bool sliderBackendSupported(SliderBackend backend);  // false for pext on cpus
+                                                     // without bmi2
+SliderBackend fastestSliderBackend();  // from cpuid
+bool setSliderBackend(
+    SliderBackend backend);  // builds its tables the first time. call before
+                             // starting any threads, false if unsupported
+SliderBackend getSliderBackend();
+const char* sliderBackendName(SliderBackend backend);
+bool sliderBackendFromName(const std::string& name, SliderBackend& backend);
+
+#endif  // SLIDINGATTACKS_H
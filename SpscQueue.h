@@ -0,0 +1,45 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// lock free ring buffer for one producer thread and one consumer thread. the
+// producer only ever writes tail and the consumer only ever writes head, so
+// neither side has to wait on the other
+template <typename T, std::size_t Capacity>
+class SpscQueue {
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "SpscQueue capacity must be a power of two");
+
+ private:
+  std::array<T, Capacity> slots;
+  alignas(64) std::atomic<std::size_t> head{0};  // next slot to read
+  alignas(64) std::atomic<std::size_t> tail{0};  // next slot to write
+
+ public:
+  bool push(T item) {  // returns false if the queue is full
+    std::size_t currentTail = tail.load(std::memory_order_relaxed);
+    std::size_t nextTail = (currentTail + 1) & (Capacity - 1);
+    if (nextTail == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    slots[currentTail] = std::move(item);
+    tail.store(nextTail, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T& item) {  // returns false if the queue is empty
+    std::size_t currentHead = head.load(std::memory_order_relaxed);
+    if (currentHead == tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = std::move(slots[currentHead]);
+    head.store((currentHead + 1) & (Capacity - 1), std::memory_order_release);
+    return true;
+  }
+};
+
+#endif  // SPSCQUEUE_H
@@ -0,0 +1,205 @@
+#include "TaskScheduler.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+thread_local TaskScheduler* currentScheduler = nullptr;
+thread_local int currentIndex = -1;
+
+}  // namespace
+
+TaskScheduler::TaskScheduler(int threads, bool pin) {
+  if (threads <= 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (int i = 0; i < threads; ++i) {
+    workers.push_back(std::make_unique<worker>());
+    workers.back()->random = 0x9e3779b9u * (i + 1);
+  }
+  // every deque exists before any worker can go looking in them
+  for (int i = 0; i < threads; ++i) {
+    workers[i]->thread = std::thread(&TaskScheduler::workerLoop, this, i, pin);
+  }
+}
+
+TaskScheduler::~TaskScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto& w : workers) {
+    w->thread.join();
+  }
+  task* work;
+  for (auto& w : workers) {
+    while (w->deque.pop(work)) {
+      delete work;
+    }
+  }
+  for (task* left : injected) {
+    delete left;
+  }
+}
+
+int TaskScheduler::threadCount() const {
+  return static_cast<int>(workers.size());
+}
+
+long long TaskScheduler::tasksRun() const {
+  long long total = 0;
+  for (const auto& w : workers) {
+    total += w->tasksRun.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+long long TaskScheduler::steals() const {
+  long long total = 0;
+  for (const auto& w : workers) {
+    total += w->steals.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+int TaskScheduler::currentWorker() { return currentIndex; }
+
+void TaskScheduler::submit(task* work) {
+  // counted before it can be found, so a sleeping worker that sees the count
+  // at 0 can't miss it
+  queuedTasks.fetch_add(1);
+  if (currentScheduler == this) {
+    workers[currentIndex]->deque.push(work);
+  } else {
+    std::lock_guard<std::mutex> lock(injectedMutex);
+    injected.push_back(work);
+    injectedCount.fetch_add(1);
+  }
+  if (sleeping.load() > 0) {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    wake.notify_one();
+  }
+}
+
+bool TaskScheduler::findTask(int self, task*& work) {
+  if (self >= 0 && workers[self]->deque.pop(work)) {
+    queuedTasks.fetch_sub(1);
+    return true;
+  }
+  if (injectedCount.load(std::memory_order_relaxed) > 0) {
+    std::lock_guard<std::mutex> lock(injectedMutex);
+    if (!injected.empty()) {
+      work = injected.front();
+      injected.pop_front();
+      injectedCount.fetch_sub(1);
+      queuedTasks.fetch_sub(1);
+      return true;
+    }
+  }
+  // one pass over the others from a random start, so thieves spread out
+  int count = static_cast<int>(workers.size());
+  std::uint32_t random = 0;
+  if (self >= 0) {
+    std::uint32_t& state = workers[self]->random;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    random = state;
+  }
+  for (int i = 0; i < count; ++i) {
+    int victim = static_cast<int>((random + i) % count);
+    if (victim != self && workers[victim]->deque.steal(work)) {
+      queuedTasks.fetch_sub(1);
+      if (self >= 0) {
+        workers[self]->steals.fetch_add(1, std::memory_order_relaxed);
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+void TaskScheduler::execute(task* work) {
+  TaskGroup* group = work->group;
+  if (!group->cancelled.load(std::memory_order_relaxed)) {
+    work->work();
+  }
+  delete work;
+  if (currentIndex >= 0) {
+    workers[currentIndex]->tasksRun.fetch_add(1, std::memory_order_relaxed);
+  }
+  // after the last one the group may be gone as soon as its waiter sees 0,
+  // so only the scheduler's own mutex is touched from here on
+  if (group->pending.fetch_sub(1) == 1) {
+    std::lock_guard<std::mutex> lock(doneMutex);
+    done.notify_all();
+  }
+}
+
+void TaskScheduler::workerLoop(int index, bool pin) {
+  currentScheduler = this;
+  currentIndex = index;
+#ifdef __linux__
+  if (pin) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(index % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  }
+#else
+  (void)pin;
+#endif
+  task* work;
+  while (!stopping.load(std::memory_order_relaxed)) {
+    bool found = false;
+    for (int tries = 0; tries < 64 && !found; ++tries) {
+      found = findTask(index, work);
+      if (!found) {
+        std::this_thread::yield();
+      }
+    }
+    if (found) {
+      execute(work);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    sleeping.fetch_add(1);
+    wake.wait(lock, [this] { return queuedTasks.load() > 0 || stopping; });
+    sleeping.fetch_sub(1);
+  }
+}
+
+TaskGroup::TaskGroup(TaskScheduler& scheduler) : scheduler(scheduler) {}
+
+TaskGroup::~TaskGroup() { wait(); }
+
+void TaskGroup::run(std::function<void()> work) {
+  pending.fetch_add(1);
+  scheduler.submit(new TaskScheduler::task{std::move(work), this});
+}
+
+void TaskGroup::wait() {
+  if (currentScheduler == &scheduler) {
+    TaskScheduler::task* work;
+    while (pending.load() > 0) {
+      if (scheduler.findTask(currentIndex, work)) {
+        scheduler.execute(work);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    return;
+  }
+  std::unique_lock<std::mutex> lock(scheduler.doneMutex);
+  scheduler.done.wait(lock, [this] { return pending.load() == 0; });
+}
+
+void TaskGroup::cancel() { cancelled.store(true); }
+
+bool TaskGroup::isCancelled() const {
+  return cancelled.load(std::memory_order_relaxed);
+}
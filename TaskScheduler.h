@@ -0,0 +1,128 @@
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "WorkStealingDeque.h"
+
+class TaskGroup;
+
+// a fixed set of worker threads sharing uneven work. a task started on a
+// worker goes on that worker's own deque (WorkStealingDeque.h) and it takes
+// its newest task back first, so a task that splits itself keeps working
+// depth first on warm data. a worker with nothing left steals the oldest
+// task from another one, which for split work is the biggest piece. tasks
+// started from outside the pool go on one locked queue, so a big job should
+// start as a few tasks that split themselves (parallelFor does). workers
+// with nothing to do sleep until something is started
+class TaskScheduler {
+ private:
+  struct task {
+    std::function<void()> work;
+    TaskGroup* group;
+  };
+  struct alignas(64) worker {
+    WorkStealingDeque<task*> deque;
+    std::thread thread;
+    std::atomic<long long> tasksRun{0};
+    std::atomic<long long> steals{0};
+    std::uint32_t random;  // picks who to steal from
+  };
+
+  std::vector<std::unique_ptr<worker>> workers;
+  std::mutex injectedMutex;
+  std::deque<task*> injected;  // started from outside the pool
+  std::atomic<long long> injectedCount{0};
+  std::atomic<long long> queuedTasks{0};  // started and not picked up yet
+  std::atomic<int> sleeping{0};
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+  std::mutex doneMutex;  // TaskGroup::wait outside the pool sleeps on these
+  std::condition_variable done;
+  std::atomic<bool> stopping{false};
+
+  void submit(task* work);
+  bool findTask(int self, task*& work);  // self is -1 outside the pool
+  void execute(task* work);
+  void workerLoop(int index, bool pin);
+
+  friend class TaskGroup;
+
+ public:
+  explicit TaskScheduler(int threads = 0,  // 0 is one per core
+                         bool pin = false);  // each worker on its own core,
+                                             // linux only
+  ~TaskScheduler();  // wait for the groups first, tasks left are dropped
+  TaskScheduler(const TaskScheduler&) = delete;
+  TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+  int threadCount() const;
+  long long tasksRun() const;
+  long long steals() const;  // tasks a worker took from another's deque
+  static int currentWorker();  // index of the calling worker in its pool, -1
+                               // on any other thread
+};
+
+// tasks that are waited for together. wait() on a worker runs other tasks
+// while it waits instead of blocking, so tasks can start groups of their own
+// and wait for them. cancel() stops tasks that haven't started from running,
+// ones already running can look at isCancelled() and give up early
+class TaskGroup {
+ private:
+  TaskScheduler& scheduler;
+  std::atomic<long long> pending{0};
+  std::atomic<bool> cancelled{false};
+
+  friend class TaskScheduler;
+
+ public:
+  explicit TaskGroup(TaskScheduler& scheduler);
+  ~TaskGroup();  // waits
+  TaskGroup(const TaskGroup&) = delete;
+  TaskGroup& operator=(const TaskGroup&) = delete;
+
+  void run(std::function<void()> work);
+  void wait();
+  void cancel();
+  bool isCancelled() const;
+};
+
+// calls function(first, last) over pieces of [first, last) no bigger than
+// grain. the range is halved with one half started as a task, so idle workers
+// steal big halves and split them further themselves
+template <typename Function>
+void parallelFor(TaskGroup& group, std::size_t first, std::size_t last,
+                 std::size_t grain, const Function& function) {
+  grain = std::max<std::size_t>(grain, 1);
+  while (last > first && last - first > grain) {
+    std::size_t middle = first + (last - first) / 2;
+    group.run([&group, middle, last, grain, &function]() {
+      parallelFor(group, middle, last, grain, function);
+    });
+    last = middle;
+  }
+  if (first < last && !group.isCancelled()) {
+    function(first, last);
+  }
+}
+
+template <typename Function>
+void parallelFor(TaskScheduler& scheduler, std::size_t first,
+                 std::size_t last, std::size_t grain,
+                 const Function& function) {
+  TaskGroup group(scheduler);
+  parallelFor(group, first, last, grain, function);
+  group.wait();
+}
+
+#endif  // TASKSCHEDULER_H
@@ -0,0 +1,64 @@
+#include "TimeManager.h"
+
+#include <algorithm>
+
+#include "Search.h"
+
+void TimeManager::start(const SearchLimits& limits) {
+  active = limits.timeLeftMs > 0;
+  bestMoveChanges = 0;
+  lastIterationMs = previousIterationMs = lastIterationEnd = 0;
+  if (!active) {
+    return;
+  }
+  int usable = std::max(1, limits.timeLeftMs - MOVE_OVERHEAD_MS);
+  int movesToGo = limits.movesToGo > 0 ? std::min(limits.movesToGo, 50)
+                                       : DEFAULT_MOVES_TO_GO;
+  softMs = std::min(usable, usable / movesToGo + limits.incrementMs * 3 / 4);
+  // up to four times the normal share when the position needs it, but never
+  // so much of the clock that the next few moves are left short
+  hardMs = std::min(usable, std::max(softMs, std::min(softMs * 4, usable / 3)));
+  if (limits.moveTimeMs > 0) {
+    hardMs = std::min(hardMs, limits.moveTimeMs);
+    softMs = std::min(softMs, hardMs);
+  }
+}
+
+bool TimeManager::isActive() const { return active; }
+
+int TimeManager::getSoftMs() const {
+  // a best move that keeps changing gets up to twice the time, one that has
+  // held for a while lets us move early
+  double scale = std::clamp(0.7 + 0.8 * bestMoveChanges, 0.7, 2.0);
+  return std::min(hardMs, static_cast<int>(softMs * scale));
+}
+
+int TimeManager::getHardMs() const { return hardMs; }
+
+void TimeManager::iterationDone(bool bestMoveChanged, int elapsedMs) {
+  bestMoveChanges = bestMoveChanges / 2 + bestMoveChanged;
+  previousIterationMs = lastIterationMs;
+  lastIterationMs = elapsedMs - lastIterationEnd;
+  lastIterationEnd = elapsedMs;
+}
+
+bool TimeManager::startNextIteration(int elapsedMs) const {
+  if (!active) {
+    return true;
+  }
+  if (elapsedMs >= getSoftMs()) {
+    return false;
+  }
+  // each depth costs about as much more than the last as the last did over
+  // the one before, which is the effective branching factor
+  double growth = 3;
+  if (previousIterationMs > 0) {
+    growth = std::clamp(
+        static_cast<double>(lastIterationMs) / previousIterationMs, 1.5, 6.0);
+  }
+  double nextIterationMs = lastIterationMs * growth;
+  // don't start a depth that can't finish, and only start one that runs well
+  // past the soft limit if it's likely to end near it
+  return elapsedMs + nextIterationMs <= hardMs &&
+         elapsedMs + nextIterationMs / 2 <= getSoftMs();
+}
@@ -0,0 +1,36 @@
+#ifndef TIMEMANAGER_H
+#define TIMEMANAGER_H
+
+struct SearchLimits;
+
+// turns the time left on the clock into a budget for one move. the soft
+// limit is where we'd like to stop and is only checked between iterations,
+// the hard limit is checked at every node and never gets passed
+class TimeManager {
+ private:
+  bool active = false;
+  int softMs = 0;
+  int hardMs = 0;
+  double bestMoveChanges = 0;  // decays by half each iteration
+  int lastIterationMs = 0;
+  int previousIterationMs = 0;
+  int lastIterationEnd = 0;
+
+ public:
+  static constexpr int MOVE_OVERHEAD_MS = 30;  // kept back for the time it
+                                               // takes the move to reach the
+                                               // clock
+  static constexpr int DEFAULT_MOVES_TO_GO = 30;  // sudden death guess
+
+  void start(const SearchLimits& limits);
+  bool isActive() const;  // false when the search has no clock to go by
+  int getSoftMs() const;  // scaled by how settled the best move is
+  int getHardMs() const;
+  void iterationDone(bool bestMoveChanged, int elapsedMs);
+  bool startNextIteration(int elapsedMs) const;  // false if we're past the
+                                                 // soft limit, or the next
+                                                 // depth wouldn't finish
+                                                 // before the hard one
+};
+
+#endif  // TIMEMANAGER_H
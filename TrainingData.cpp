@@ -0,0 +1,276 @@
+#include "TrainingData.h"
+
+#include <cstring>
+
+#include "PackedPosition.h"
+
+namespace {
+
+void putVarint(std::vector<std::uint8_t>& out, std::uint32_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<std::uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<std::uint8_t>(value));
+}
+
+bool getVarint(const std::vector<std::uint8_t>& in, std::size_t& offset,
+               std::uint32_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (offset >= in.size()) {
+      return false;
+    }
+    std::uint8_t byte = in[offset++];
+    value |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// scores close to zero get the short varints whatever their sign
+std::uint32_t zigzag(int value) {
+  return (static_cast<std::uint32_t>(value) << 1) ^
+         static_cast<std::uint32_t>(value >> 31);
+}
+
+int unzigzag(std::uint32_t value) {
+  return static_cast<int>(value >> 1) ^ -static_cast<int>(value & 1);
+}
+
+std::uint32_t checksum(const std::vector<std::uint8_t>& bytes) {
+  std::uint32_t hash = 2166136261u;
+  for (std::uint8_t byte : bytes) {
+    hash = (hash ^ byte) * 16777619u;
+  }
+  return hash;
+}
+
+int findMoveIndex(const std::vector<moveType>& moves, const moveType& move) {
+  for (std::size_t i = 0; i < moves.size(); ++i) {
+    if (moves[i].from == move.from && moves[i].to == move.to &&
+        moves[i].promotion == move.promotion) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+}  // namespace
+
+bool encodeGame(const Board& start, const SelfPlayGame& game,
+                const std::vector<bool>& sampled, trainingChunk& chunk) {
+  if (game.outcome == GameOutcome::Unfinished ||
+      sampled.size() != game.moves.size()) {
+    return false;
+  }
+  // replay from the unpacked start so the move indices match what the reader
+  // will see
+  packedPosition packed = packPosition(start);
+  Board position;
+  if (!unpackPosition(packed, position)) {
+    return false;
+  }
+  std::vector<std::uint8_t> bytes(sizeof(packed));
+  std::memcpy(bytes.data(), &packed, sizeof(packed));
+  bytes.push_back(static_cast<std::uint8_t>(game.outcome));
+  putVarint(bytes, static_cast<std::uint32_t>(game.moves.size()));
+
+  std::uint32_t positions = 0;
+  for (std::size_t ply = 0; ply < game.moves.size(); ++ply) {
+    // no position has more than 218 legal moves, so the index fits in a byte
+    int index = findMoveIndex(position.getMoveList(), game.moves[ply]);
+    if (index < 0) {
+      return false;
+    }
+    bytes.push_back(static_cast<std::uint8_t>(index));
+    if (sampled[ply]) {
+      putVarint(bytes, zigzag(game.scores[ply]) << 1 | 1);
+      positions++;
+    } else {
+      bytes.push_back(0);
+    }
+    position.makeMove(game.moves[ply]);
+  }
+
+  chunk.payload.insert(chunk.payload.end(), bytes.begin(), bytes.end());
+  chunk.games++;
+  chunk.positions += positions;
+  return true;
+}
+
+bool TrainingWriter::open(const std::string& path) {
+  file.open(path, std::ios::binary | std::ios::app);
+  return file.is_open();
+}
+
+bool TrainingWriter::write(const trainingChunk& chunk) {
+  if (chunk.games == 0) {
+    return true;
+  }
+  trainingChunkHeader header{TRAINING_MAGIC,
+                             static_cast<std::uint32_t>(chunk.payload.size()),
+                             chunk.games, chunk.positions,
+                             checksum(chunk.payload)};
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(chunk.payload.data()),
+             chunk.payload.size());
+  file.flush();  // a whole chunk is on disk before the next one starts
+  bytesWritten += sizeof(header) + chunk.payload.size();
+  return static_cast<bool>(file);
+}
+
+long long TrainingWriter::getBytesWritten() const { return bytesWritten; }
+
+bool TrainingReader::open(const std::string& path) {
+  file.open(path, std::ios::binary);
+  return file.is_open();
+}
+
+long long TrainingReader::getBadChunks() const { return badChunks; }
+
+bool TrainingReader::readChunk() {
+  while (true) {
+    trainingChunkHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+      return false;
+    }
+    if (header.magic != TRAINING_MAGIC) {
+      badChunks++;  // lost track of where chunks start, nothing more to read
+      return false;
+    }
+    payload.resize(header.payloadBytes);
+    if (!file.read(reinterpret_cast<char*>(payload.data()),
+                   header.payloadBytes)) {
+      return false;  // the writer was stopped part way through this one
+    }
+    if (checksum(payload) != header.checksum) {
+      badChunks++;
+      continue;
+    }
+    offset = 0;
+    gamesLeft = header.games;
+    return true;
+  }
+}
+
+bool TrainingReader::startGame() {
+  while (gamesLeft == 0) {
+    if (!readChunk()) {
+      return false;
+    }
+  }
+  gamesLeft--;
+  packedPosition packed;
+  if (offset + sizeof(packed) + 1 > payload.size()) {
+    badChunks++;
+    gamesLeft = 0;
+    return startGame();
+  }
+  std::memcpy(&packed, payload.data() + offset, sizeof(packed));
+  offset += sizeof(packed);
+  outcome = static_cast<GameOutcome>(payload[offset++]);
+  if (!getVarint(payload, offset, pliesLeft) ||
+      !unpackPosition(packed, position)) {
+    badChunks++;
+    gamesLeft = 0;
+    return startGame();
+  }
+  return true;
+}
+
+bool TrainingReader::next(trainingSample& sample) {
+  while (true) {
+    while (pliesLeft == 0) {
+      if (!startGame()) {
+        return false;
+      }
+    }
+    pliesLeft--;
+    std::uint32_t tag;
+    std::vector<moveType> moves = position.getMoveList();
+    if (offset >= payload.size() || payload[offset] >= moves.size()) {
+      badChunks++;
+      pliesLeft = 0;
+      gamesLeft = 0;
+      continue;
+    }
+    moveType move = moves[payload[offset++]];
+    if (!getVarint(payload, offset, tag)) {
+      badChunks++;
+      pliesLeft = 0;
+      gamesLeft = 0;
+      continue;
+    }
+    bool keep = tag & 1;
+    if (keep) {
+      sample.position = position;
+      sample.score = unzigzag(tag >> 1);
+      sample.outcome = outcome;
+    }
+    position.makeMove(move);
+    if (keep) {
+      return true;
+    }
+  }
+}
+
+bool TrainingReader::nextGame(std::vector<std::uint8_t>& bytes) {
+  pliesLeft = 0;
+  while (true) {
+    while (gamesLeft == 0) {
+      if (!readChunk()) {
+        return false;
+      }
+    }
+    gamesLeft--;
+    std::size_t end = offset + sizeof(packedPosition) + 1;
+    std::uint32_t plies = 0, tag;
+    bool whole = end <= payload.size() && getVarint(payload, end, plies);
+    for (std::uint32_t ply = 0; whole && ply < plies; ++ply) {
+      end++;  // the move index
+      whole = getVarint(payload, end, tag);
+    }
+    if (!whole) {
+      badChunks++;
+      gamesLeft = 0;
+      continue;
+    }
+    bytes.assign(payload.begin() + offset, payload.begin() + end);
+    offset = end;
+    return true;
+  }
+}
+
+bool decodeGame(const std::vector<std::uint8_t>& bytes, Board& start,
+                std::vector<moveType>& moves) {
+  packedPosition packed;
+  if (bytes.size() < sizeof(packed) + 1) {
+    return false;
+  }
+  std::memcpy(&packed, bytes.data(), sizeof(packed));
+  if (!unpackPosition(packed, start)) {
+    return false;
+  }
+  std::size_t offset = sizeof(packed) + 1;  // skips the outcome
+  std::uint32_t plies, tag;
+  if (!getVarint(bytes, offset, plies)) {
+    return false;
+  }
+  Board position = start;
+  moves.clear();
+  for (std::uint32_t ply = 0; ply < plies; ++ply) {
+    std::vector<moveType> legal = position.getMoveList();
+    if (offset >= bytes.size() || bytes[offset] >= legal.size()) {
+      return false;
+    }
+    moves.push_back(legal[bytes[offset++]]);
+    if (!getVarint(bytes, offset, tag)) {
+      return false;
+    }
+    position.makeMove(moves.back());
+  }
+  return true;
+}
@@ -0,0 +1,87 @@
+#ifndef TRAININGDATA_H
+#define TRAININGDATA_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Board.h"
+#include "SelfPlay.h"
+
+// training data is a file of chunks, each one a header followed by whole
+// games. a game is stored as its packed start position and then one byte per
+// move (its index in getMoveList), so positions cost a few bytes each instead
+// of a full board. new chunks can be appended to an existing file at any time
+// and a chunk cut short by a crash is just ignored when reading.
+
+constexpr std::uint32_t TRAINING_MAGIC = 0x31445443;  // "CTD1"
+
+struct trainingChunkHeader {
+  std::uint32_t magic;
+  std::uint32_t payloadBytes;
+  std::uint32_t games;
+  std::uint32_t positions;  // sampled ones, not every ply
+  std::uint32_t checksum;   // fnv-1a of the payload
+};
+
+struct trainingChunk {  // games waiting to be written
+  std::vector<std::uint8_t> payload;
+  std::uint32_t games = 0;
+  std::uint32_t positions = 0;
+};
+
+struct trainingSample {  // one position read back from the file
+  Board position;
+  int score;            // search score from the side to move's point of view
+  GameOutcome outcome;  // how the game ended
+};
+
+// adds a finished game to the chunk. sampled says which positions (the one
+// before each move) to keep, it should be as long as game.moves. returns false
+// for games that can't be stored (unfinished ones)
+bool encodeGame(const Board& start, const SelfPlayGame& game,
+                const std::vector<bool>& sampled, trainingChunk& chunk);
+
+// the start position and moves of a game handed out by
+// TrainingReader::nextGame. false if the bytes don't replay
+bool decodeGame(const std::vector<std::uint8_t>& bytes, Board& start,
+                std::vector<moveType>& moves);
+
+class TrainingWriter {
+ private:
+  std::ofstream file;
+  long long bytesWritten = 0;
+
+ public:
+  bool open(const std::string& path);  // appends if the file already exists
+  bool write(const trainingChunk& chunk);
+  long long getBytesWritten() const;
+};
+
+class TrainingReader {
+ private:
+  std::ifstream file;
+  std::vector<std::uint8_t> payload;
+  std::size_t offset = 0;
+  std::uint32_t gamesLeft = 0;
+  // the game currently being replayed
+  Board position;
+  GameOutcome outcome = GameOutcome::Draw;
+  std::uint32_t pliesLeft = 0;
+  long long badChunks = 0;
+
+  bool readChunk();
+  bool startGame();
+
+ public:
+  bool open(const std::string& path);
+  bool next(trainingSample& sample);  // false at the end of the file
+  bool nextGame(std::vector<std::uint8_t>&
+                    bytes);  // the next whole game still encoded, finding
+                             // where it ends doesn't need a replay. don't
+                             // mix with next
+  long long getBadChunks() const;     // checksum failures or damaged games
+};
+
+#endif  // TRAININGDATA_H
@@ -0,0 +1,233 @@
+#include "TranspositionTable.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Evaluate.h"
+#include "Profiler.h"
+
+namespace {
+
+constexpr char FILE_MAGIC[4] = {'C', 'T', 'T', '1'};
+constexpr std::uint32_t FILE_VERSION = 1;
+
+std::size_t entriesFor(std::size_t megabytes) {
+  std::size_t count = megabytes * 1024 * 1024 / sizeof(ttEntry);
+  std::size_t powerOfTwo = 1;
+  while (powerOfTwo * 2 <= count) {
+    powerOfTwo *= 2;
+  }
+  return powerOfTwo;
+}
+
+}  // namespace
+
+TranspositionTable::TranspositionTable(std::size_t megabytes) {
+  resize(megabytes);
+}
+
+TranspositionTable::~TranspositionTable() { closeFile(); }
+
+void TranspositionTable::resize(std::size_t megabytes) {
+  closeFile();
+  memory.assign(entriesFor(megabytes), ttEntry{});
+  entries = memory.data();
+  entryCount = memory.size();
+  generation = 0;
+}
+
+void TranspositionTable::clear() {
+  std::fill(entries, entries + entryCount, ttEntry{});
+  generation = 0;
+}
+
+std::uint64_t TranspositionTable::checksum() const {
+  // fnv style over whole words, a few ms for a 16 MB table
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(entries);
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+  for (std::size_t i = 0; i < entryCount * sizeof(ttEntry); i += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, bytes + i, 8);
+    hash = (hash ^ word) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+#ifndef _WIN32
+bool TranspositionTable::openFile(const std::string& path,
+                                  std::size_t megabytes) {
+  std::size_t count = entriesFor(megabytes);
+  std::size_t bytes = sizeof(ttFileHeader) + count * sizeof(ttEntry);
+  int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    std::cout << "couldn't open " << path << std::endl;
+    return false;
+  }
+  if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+    // two engines writing one table would corrupt each other's entries
+    std::cout << path << " is already in use" << std::endl;
+    ::close(fd);
+    return false;
+  }
+  struct stat info;
+  bool rightSize =
+      fstat(fd, &info) == 0 && static_cast<std::size_t>(info.st_size) == bytes;
+  if (!rightSize && ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+    std::cout << "couldn't resize " << path << std::endl;
+    ::close(fd);
+    return false;
+  }
+  void* mapping =
+      mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mapping == MAP_FAILED) {
+    std::cout << "couldn't map " << path << std::endl;
+    ::close(fd);
+    return false;
+  }
+
+  closeFile();
+  memory.clear();
+  memory.shrink_to_fit();
+  header = static_cast<ttFileHeader*>(mapping);
+  entries = reinterpret_cast<ttEntry*>(header + 1);
+  entryCount = count;
+  mappedBytes = bytes;
+  fileDescriptor = fd;
+
+  // anything that doesn't check out is thrown away rather than trusted, a
+  // bad score in the table would quietly change the search
+  const char* problem = nullptr;
+  if (!rightSize) {
+    problem = "new, truncated or a different size";
+  } else if (std::memcmp(header->magic, FILE_MAGIC, 4) != 0) {
+    problem = "not a table file";
+  } else if (header->version != FILE_VERSION ||
+             header->entrySize != sizeof(ttEntry) ||
+             header->entryCount != count ||
+             header->keyCheck != Board().getPositionKey()) {
+    problem = "made by a different version";
+  } else if (header->clean != 1) {
+    problem = "wasn't closed properly";
+  } else if (header->checksum != checksum()) {
+    problem = "checksum doesn't match";
+  }
+  if (problem) {
+    std::cout << path << ": " << problem << ", starting empty" << std::endl;
+    std::memset(header, 0, sizeof(ttFileHeader));
+    std::memcpy(header->magic, FILE_MAGIC, 4);
+    header->version = FILE_VERSION;
+    header->entrySize = sizeof(ttEntry);
+    header->entryCount = count;
+    header->keyCheck = Board().getPositionKey();
+    std::fill(entries, entries + entryCount, ttEntry{});
+  }
+  generation = header->generation;
+  header->clean = 0;
+  msync(header, sizeof(ttFileHeader), MS_SYNC);
+  return true;
+}
+
+void TranspositionTable::closeFile() {
+  if (!header) {
+    return;
+  }
+  header->generation = generation;
+  header->checksum = checksum();
+  header->clean = 1;
+  msync(header, mappedBytes, MS_SYNC);
+  munmap(header, mappedBytes);
+  ::close(fileDescriptor);  // also drops the lock
+  header = nullptr;
+  mappedBytes = 0;
+  fileDescriptor = -1;
+  memory.assign(entryCount, ttEntry{});
+  entries = memory.data();
+}
+#else
+bool TranspositionTable::openFile(const std::string& path,
+                                  std::size_t megabytes) {
+  std::cout << "table files aren't supported on this platform yet" << std::endl;
+  return false;
+}
+
+void TranspositionTable::closeFile() {}
+#endif
+
+bool TranspositionTable::isFileBacked() const { return header != nullptr; }
+
+void TranspositionTable::newSearch() { generation++; }
+
+bool TranspositionTable::probe(std::uint64_t key, ttEntry& entry) const {
+  PROFILE_SCOPE(ProfileZone::TableProbe);
+  const ttEntry& slot = entries[key & (entryCount - 1)];
+  if (slot.flag && slot.key == key) {
+    entry = slot;
+    return true;
+  }
+  return false;
+}
+
+void TranspositionTable::store(std::uint64_t key, int depth, int score,
+                               std::uint8_t flag, const moveType* bestMove) {
+  PROFILE_SCOPE(ProfileZone::TableStore);
+  ttEntry& slot = entries[key & (entryCount - 1)];
+  // keep deeper results from this search, anything older can go
+  if (slot.flag && slot.key != key && slot.generation == generation &&
+      slot.depth > depth) {
+    return;
+  }
+  if (bestMove) {
+    slot.from = static_cast<std::int8_t>(bestMove->from);
+    slot.to = static_cast<std::int8_t>(bestMove->to);
+    slot.promotion = static_cast<std::uint8_t>(bestMove->promotion);
+  } else if (slot.key != key) {
+    slot.from = -1;  // same position keeps the move it already had
+    slot.to = -1;
+    slot.promotion = 0;
+  }
+  slot.key = key;
+  slot.score = static_cast<std::int16_t>(score);
+  slot.depth = static_cast<std::int8_t>(depth);
+  slot.flag = flag;
+  slot.generation = generation;
+}
+
+int TranspositionTable::hashfull() const {
+  int used = 0;
+  int sample = entryCount < 1000 ? static_cast<int>(entryCount) : 1000;
+  for (int i = 0; i < sample; ++i) {
+    if (entries[i].flag && entries[i].generation == generation) {
+      used++;
+    }
+  }
+  return used * 1000 / sample;
+}
+
+int scoreToTable(int score, int ply) {
+  if (score > MATE_SCORE - 1000) {
+    return score + ply;
+  }
+  if (score < -MATE_SCORE + 1000) {
+    return score - ply;
+  }
+  return score;
+}
+
+int scoreFromTable(int score, int ply) {
+  if (score > MATE_SCORE - 1000) {
+    return score - ply;
+  }
+  if (score < -MATE_SCORE + 1000) {
+    return score + ply;
+  }
+  return score;
+}
@@ -0,0 +1,83 @@
+#ifndef TRANSPOSITIONTABLE_H
+#define TRANSPOSITIONTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Board.h"
+
+struct ttEntry {
+  std::uint64_t key = 0;
+  std::int16_t score = 0;
+  std::int8_t depth = 0;
+  std::uint8_t flag = 0;  // 0 empty, 1 exact, 2 lower bound, 3 upper bound
+  std::int8_t from = -1;  // best move found, -1 if there wasn't one
+  std::int8_t to = -1;
+  std::uint8_t promotion = 0;
+  std::uint8_t generation = 0;  // which search stored it, for replacement
+};
+struct ttFileHeader {  // start of a table file, the entries follow it
+  char magic[4];            // "CTT1"
+  std::uint32_t version;
+  std::uint32_t entrySize;  // sizeof(ttEntry) when the file was made
+  std::uint32_t clean;      // 1 once closed properly, 0 while it's in use
+  std::uint64_t entryCount;
+  std::uint64_t keyCheck;   // key of the starting position, so a file made
+                            // with different zobrist keys counts as stale
+  std::uint64_t checksum;   // of the entries, written on close
+  std::uint8_t generation;
+  std::uint8_t padding[23];  // keeps the entries 16 byte aligned
+};
+static_assert(sizeof(ttFileHeader) % sizeof(ttEntry) == 0,
+              "ttFileHeader should keep the entries aligned");
+
+// remembers results of earlier searches by position key. lives in the engine
+// so a search on the next position starts warm instead of from nothing. it
+// can also be backed by a memory mapped file (openFile), so it survives
+// restarts too
+class TranspositionTable {
+ private:
+  ttEntry* entries = nullptr;  // points into memory or into the mapping
+  std::size_t entryCount = 0;
+  std::vector<ttEntry> memory;
+  ttFileHeader* header = nullptr;  // the whole mapping, null when in memory
+  std::size_t mappedBytes = 0;
+  int fileDescriptor = -1;  // held open for the lock while it's mapped
+  std::uint8_t generation = 0;
+
+  std::uint64_t checksum() const;
+
+ public:
+  static constexpr std::uint8_t EXACT = 1;
+  static constexpr std::uint8_t LOWER_BOUND = 2;
+  static constexpr std::uint8_t UPPER_BOUND = 3;
+
+  explicit TranspositionTable(std::size_t megabytes = 16);
+  ~TranspositionTable();
+  TranspositionTable(const TranspositionTable&) = delete;
+  TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+  void resize(std::size_t megabytes);  // back in memory, empty
+  void clear();
+  bool openFile(const std::string& path,
+                std::size_t megabytes);  // keeps whatever the file had if it
+                                         // checks out, otherwise starts it
+                                         // empty. false if it can't be
+                                         // mapped, the table stays as it was
+  void closeFile();  // writes the checksum and goes back to memory
+  bool isFileBacked() const;
+  void newSearch();  // ages the table so old entries get replaced first
+  bool probe(std::uint64_t key, ttEntry& entry) const;
+  void store(std::uint64_t key, int depth, int score, std::uint8_t flag,
+             const moveType* bestMove);
+  int hashfull() const;  // permille of the table used by the current search
+};
+
+// mate scores are stored relative to the node rather than the root, so they
+// stay right when the same position turns up at a different ply
+int scoreToTable(int score, int ply);
+int scoreFromTable(int score, int ply);
+
+#endif  // TRANSPOSITIONTABLE_H
@@ -0,0 +1,103 @@
+#ifndef WORKSTEALINGDEQUE_H
+#define WORKSTEALINGDEQUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Chase-Lev deque: the thread that owns it pushes and pops at the bottom, any
+// other thread can steal from the top. the owner only pays for an atomic
+// compare when it takes the last item and a thief might be after it too.
+// T has to be something an atomic can hold, the scheduler keeps pointers.
+// a full ring is copied into one twice the size, the old rings are kept until
+// the deque goes because a thief may still be reading one
+template <typename T>
+class WorkStealingDeque {
+ private:
+  struct Ring {
+    std::int64_t capacity;  // a power of two
+    std::unique_ptr<std::atomic<T>[]> items;
+
+    explicit Ring(std::int64_t capacity)
+        : capacity(capacity), items(new std::atomic<T>[capacity]) {}
+    T get(std::int64_t i) const {
+      return items[i & (capacity - 1)].load(std::memory_order_relaxed);
+    }
+    void put(std::int64_t i, T item) {
+      items[i & (capacity - 1)].store(item, std::memory_order_relaxed);
+    }
+  };
+
+  alignas(64) std::atomic<std::int64_t> top{0};  // next to steal
+  alignas(64) std::atomic<std::int64_t> bottom{0};  // next free slot
+  std::atomic<Ring*> ring;
+  std::vector<std::unique_ptr<Ring>> rings;  // every one made, owner only
+
+ public:
+  explicit WorkStealingDeque(std::int64_t capacity = 256) {
+    rings.push_back(std::make_unique<Ring>(capacity));
+    ring.store(rings.back().get(), std::memory_order_relaxed);
+  }
+  WorkStealingDeque(const WorkStealingDeque&) = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  void push(T item) {  // owner only
+    std::int64_t b = bottom.load(std::memory_order_relaxed);
+    std::int64_t t = top.load(std::memory_order_acquire);
+    Ring* current = ring.load(std::memory_order_relaxed);
+    if (b - t > current->capacity - 1) {
+      rings.push_back(std::make_unique<Ring>(current->capacity * 2));
+      Ring* bigger = rings.back().get();
+      for (std::int64_t i = t; i < b; ++i) {
+        bigger->put(i, current->get(i));
+      }
+      ring.store(bigger, std::memory_order_release);
+      current = bigger;
+    }
+    current->put(b, item);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+  }
+
+  bool pop(T& item) {  // owner only, newest first. false if it's empty
+    std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    Ring* current = ring.load(std::memory_order_relaxed);
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t t = top.load(std::memory_order_relaxed);
+    if (t > b) {
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return false;
+    }
+    item = current->get(b);
+    if (t == b) {  // the last one, a thief may be taking it as well
+      bool won = top.compare_exchange_strong(t, t + 1,
+                                             std::memory_order_seq_cst,
+                                             std::memory_order_relaxed);
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return won;
+    }
+    return true;
+  }
+
+  bool steal(T& item) {  // any thread, oldest first. false if it's empty or
+                         // another thread got there first
+    std::int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t b = bottom.load(std::memory_order_acquire);
+    if (t >= b) {
+      return false;
+    }
+    item = ring.load(std::memory_order_acquire)->get(t);
+    return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed);
+  }
+
+  bool looksEmpty() const {  // a guess, it can change straight after
+    return bottom.load(std::memory_order_relaxed) <=
+           top.load(std::memory_order_relaxed);
+  }
+};
+
+#endif  // WORKSTEALINGDEQUE_H
@@ -0,0 +1,45 @@
+# writes the files listed in FILES (comma separated, relative to INPUT_DIR)
+# into OUTPUT as byte arrays, so the game carries its images inside the
+# executable. run at build time by the add_custom_command in CMakeLists.txt
+
+string(REPLACE "," ";" FILES "${FILES}")
+set(arrays "")
+set(table "")
+set(index 0)
+set(line "")  # cmake regexes have no {n}, so spell out 64 hex digits
+foreach (i RANGE 63)
+    string(APPEND line "[0-9a-f]")
+endforeach ()
+foreach (name ${FILES})
+    file(READ "${INPUT_DIR}/${name}" hex HEX)
+    string(LENGTH "${hex}" length)
+    math(EXPR size "${length} / 2")
+    # a line break every 32 bytes, then 0x.. for every byte
+    string(REGEX REPLACE "(${line})" "\\1\n    " bytes "${hex}")
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${bytes}")
+    string(APPEND arrays
+            "const unsigned char file${index}[] = {\n    ${bytes}};\n")
+    string(APPEND table "    {\"${name}\", file${index}, ${size}},\n")
+    math(EXPR index "${index} + 1")
+endforeach ()
+
+file(WRITE "${OUTPUT}.tmp"
+        "// made from ${INPUT_DIR} by cmake/EmbedFiles.cmake, don't edit\n\n"
+        "#include \"EmbeddedImages.h\"\n\n"
+        "namespace {\n\n"
+        "${arrays}\n"
+        "const embeddedFile files[] = {\n${table}};\n\n"
+        "}  // namespace\n\n"
+        "const embeddedFile* findEmbeddedImage(const std::string& name) {\n"
+        "  for (const embeddedFile& file : files) {\n"
+        "    if (name == file.name) {\n"
+        "      return &file;\n"
+        "    }\n"
+        "  }\n"
+        "  return nullptr;\n"
+        "}\n")
+# only touch the real file when something changed, so nothing rebuilds for
+# no reason
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different "${OUTPUT}.tmp"
+        "${OUTPUT}")
+file(REMOVE "${OUTPUT}.tmp")
@@ -1,7 +1,38 @@
+#include <iostream>
+#include <string>
+
+#include "Evaluate.h"
 #include "Game.h"
+#include "SlidingAttacks.h"
 
-int main() {
+int main(int argc, char** argv) {
   Game game;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--cache" && i + 1 < argc) {
+      game.useAnalysisCache(argv[++i]);  // e.g. --cache analysis.tt
+    } else if (arg == "--eval" && i + 1 < argc) {
+      if (!loadEvalParams(argv[++i])) {  // weights from chess_tune
+        return 1;
+      }
+    } else if (arg == "--index" && i + 1 < argc) {
+      if (!game.useGameIndex(argv[++i])) {  // from chess_index
+        return 1;
+      }
+    } else if (arg == "--sliders" && i + 1 < argc) {
+      SliderBackend backend;  // picked by cpuid unless this says otherwise
+      if (!sliderBackendFromName(argv[++i], backend) ||
+          !setSliderBackend(backend)) {
+        std::cout << "can't use sliders " << argv[i] << std::endl;
+        return 1;
+      }
+    } else {
+      std::cout << "usage: ChessGame [--cache file] [--eval file] "
+                   "[--index file] [--sliders loop|kogge-stone|magic|pext]"
+                << std::endl;
+      return 1;
+    }
+  }
   game.loadSprites();
   game.run();
 
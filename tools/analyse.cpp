@@ -0,0 +1,166 @@
+// prints the engine's best lines for a position, one line per multipv slot
+// for every finished depth. --compare searches the same position with a
+// single line first so the cost of the extra lines can be seen. --cache
+// keeps the table in a file between runs, and --cache-compare times each
+// depth from an empty file and again from the file the first run left.
+//
+//   chess_analyse --fen "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3" --multipv 3
+//   chess_analyse --depth 6 --multipv 4 --compare
+//   chess_analyse --depth 7 --cache analysis.tt --cache-compare
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Evaluate.h"
+#include "Search.h"
+#include "TranspositionTable.h"
+
+namespace {
+
+struct AnalysisRun {
+  long long nodes = 0;
+  double seconds = 0;
+  std::vector<int> depthMs;  // time to finish each depth, from 1
+};
+
+AnalysisRun analyse(const Board& board, int depth, int moveTimeMs,
+                    int multiPv, int hashMegabytes,
+                    const std::string& cachePath, bool print) {
+  std::atomic<bool> stop{false};
+  TranspositionTable table(hashMegabytes);
+  if (!cachePath.empty()) {
+    table.openFile(cachePath, hashMegabytes);
+  }
+  Search search(stop, &table);
+  AnalysisRun run;
+  SearchLimits limits;
+  limits.depth = depth;
+  limits.moveTimeMs = moveTimeMs;
+  limits.multiPv = multiPv;
+  auto start = std::chrono::steady_clock::now();
+  search.think(board, limits, [&](const SearchInfo& info) {
+    if (!info.completed) {
+      return;
+    }
+    run.depthMs.push_back(info.timeMs);
+    if (!print) {
+      return;
+    }
+    for (std::size_t i = 0; i < info.lines.size(); ++i) {
+      std::cout << "depth " << info.depth << " multipv " << i + 1
+                << " score " << info.lines[i].score << " nodes "
+                << info.nodes << " time " << info.timeMs << " pv";
+      for (const moveType& move : info.lines[i].pv) {
+        std::cout << " " << moveToText(move);
+      }
+      std::cout << std::endl;
+    }
+  });
+  run.nodes = search.getNodes();
+  run.seconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+  return run;
+}
+
+void printRun(const std::string& name, const AnalysisRun& run) {
+  std::cout << name << ": " << run.nodes << " nodes in " << run.seconds
+            << " s, " << static_cast<long long>(run.nodes / run.seconds)
+            << " nodes/s" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string fen;
+  int depth = 6;
+  int moveTimeMs = 0;
+  int multiPv = 3;
+  int hashMegabytes = 16;
+  bool compare = false;
+  std::string cachePath;
+  bool cacheCompare = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--compare") {
+      compare = true;
+    } else if (arg == "--cache-compare") {
+      cacheCompare = true;
+    } else if (arg == "--cache" && i + 1 < argc) {
+      cachePath = argv[++i];
+    } else if (arg == "--fen" && i + 1 < argc) {
+      fen = argv[++i];
+    } else if (arg == "--depth" && i + 1 < argc) {
+      depth = std::stoi(argv[++i]);
+    } else if (arg == "--movetime" && i + 1 < argc) {
+      moveTimeMs = std::stoi(argv[++i]);
+    } else if (arg == "--multipv" && i + 1 < argc) {
+      multiPv = std::stoi(argv[++i]);
+    } else if (arg == "--hash" && i + 1 < argc) {
+      hashMegabytes = std::stoi(argv[++i]);
+    } else if (arg == "--eval" && i + 1 < argc) {
+      if (!loadEvalParams(argv[++i])) {
+        return 1;
+      }
+    } else {
+      std::cout << "usage: chess_analyse [--fen fen] [--depth n]"
+                   " [--movetime ms] [--multipv n] [--hash mb] [--compare]"
+                   " [--cache file] [--cache-compare] [--eval file]"
+                << std::endl;
+      return 1;
+    }
+  }
+  Board board;
+  if (!fen.empty() && !board.loadFen(fen)) {
+    std::cout << "couldn't read fen: " << fen << std::endl;
+    return 1;
+  }
+  if (board.getStatus() != GameStatus::Ongoing) {
+    std::cout << "game is over: " << statusText(board.getStatus())
+              << std::endl;
+    return 1;
+  }
+
+  if (cacheCompare) {
+    if (cachePath.empty()) {
+      std::cout << "--cache-compare needs --cache file" << std::endl;
+      return 1;
+    }
+    std::remove(cachePath.c_str());
+    AnalysisRun cold = analyse(board, depth, moveTimeMs, multiPv,
+                               hashMegabytes, cachePath, false);
+    AnalysisRun warm = analyse(board, depth, moveTimeMs, multiPv,
+                               hashMegabytes, cachePath, true);
+    for (std::size_t i = 0; i < cold.depthMs.size(); ++i) {
+      std::cout << "depth " << i + 1 << ": cold " << cold.depthMs[i]
+                << " ms, warm "
+                << (i < warm.depthMs.size() ? warm.depthMs[i] : -1) << " ms"
+                << std::endl;
+    }
+    printRun("cold", cold);
+    printRun("warm", warm);
+    return 0;
+  }
+  if (compare) {
+    AnalysisRun single =
+        analyse(board, depth, moveTimeMs, 1, hashMegabytes, cachePath, false);
+    printRun("multipv 1", single);
+    AnalysisRun multi =
+        analyse(board, depth, moveTimeMs, multiPv, hashMegabytes, cachePath,
+                true);
+    printRun("multipv " + std::to_string(multiPv), multi);
+    std::cout << "time ratio " << multi.seconds / single.seconds
+              << ", nodes/s ratio "
+              << (multi.nodes / multi.seconds) / (single.nodes / single.seconds)
+              << std::endl;
+    return 0;
+  }
+  AnalysisRun run = analyse(board, depth, moveTimeMs, multiPv, hashMegabytes,
+                            cachePath, true);
+  printRun("multipv " + std::to_string(multiPv), run);
+  return 0;
+}
@@ -0,0 +1,187 @@
+// batch evaluation check and throughput test. makes a set of positions by
+// playing random games out from the openings, checks the vector kernel
+// against the scalar path and evaluate(), then times both.
+//
+//   chess_batch_eval --positions 200000 --threads 4
+//   chess_batch_eval --openings tools/openings.epd --time 2
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BatchEval.h"
+#include "Evaluate.h"
+#include "PackedPosition.h"
+#include "SelfPlay.h"
+
+namespace {
+
+std::vector<packedPosition> randomPositions(const std::vector<Board>& starts,
+                                            int count, unsigned seed) {
+  std::mt19937 random(seed);
+  std::vector<packedPosition> positions;
+  positions.reserve(count);
+  while (static_cast<int>(positions.size()) < count) {
+    Board board = starts[random() % starts.size()];
+    for (int ply = 0; ply < 120 && static_cast<int>(positions.size()) < count;
+         ++ply) {
+      std::vector<moveType> moves = board.getMoveList();
+      if (moves.empty() || board.getStatus() != GameStatus::Ongoing) {
+        break;
+      }
+      board.makeMove(moves[random() % moves.size()]);
+      positions.push_back(packPosition(board));
+    }
+  }
+  return positions;
+}
+
+std::vector<positionBlock> makeBlocks(
+    const std::vector<packedPosition>& positions) {
+  std::vector<positionBlock> blocks((positions.size() + BLOCK_SIZE - 1) /
+                                    BLOCK_SIZE);
+  for (std::size_t i = 0; i < positions.size(); ++i) {
+    blocks[i / BLOCK_SIZE].addPacked(positions[i]);
+  }
+  return blocks;
+}
+
+// runs every block through evalBlock on each thread until seconds are up,
+// returns positions per second over all threads
+template <typename Function>
+double measure(const std::vector<positionBlock>& blocks, int threads,
+               double seconds, Function evalBlock) {
+  std::atomic<long long> evaluated{0};
+  std::atomic<int> sink{0};
+  auto start = std::chrono::steady_clock::now();
+  auto until = start + std::chrono::duration<double>(seconds);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      int scores[BLOCK_SIZE];
+      long long done = 0;
+      int checksum = 0;
+      // each thread takes its own share of the blocks, so they don't share
+      // cache lines while writing scores
+      std::size_t first = blocks.size() * t / threads;
+      std::size_t last = blocks.size() * (t + 1) / threads;
+      if (first == last) {
+        return;
+      }
+      while (std::chrono::steady_clock::now() < until) {
+        for (std::size_t b = first; b < last; ++b) {
+          evalBlock(blocks[b], scores);
+          checksum += scores[0];
+          done += blocks[b].count;
+        }
+      }
+      evaluated += done;
+      sink += checksum;
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  double elapsed =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  return evaluated / elapsed;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string openingsPath;
+  int count = 100000;
+  int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  double seconds = 1.0;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--openings" && i + 1 < argc) {
+      openingsPath = argv[++i];
+    } else if (arg == "--positions" && i + 1 < argc) {
+      count = std::stoi(argv[++i]);
+    } else if (arg == "--threads" && i + 1 < argc) {
+      maxThreads = std::stoi(argv[++i]);
+    } else if (arg == "--time" && i + 1 < argc) {
+      seconds = std::stod(argv[++i]);
+    } else if (arg == "--seed" && i + 1 < argc) {
+      seed = std::stoul(argv[++i]);
+    } else {
+      std::cout << "usage: chess_batch_eval [--openings file.epd] "
+                   "[--positions n] [--threads n] [--time seconds] "
+                   "[--seed n]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  std::vector<Board> starts;
+  if (!openingsPath.empty()) {
+    starts = loadOpenings(openingsPath);
+  }
+  if (starts.empty()) {
+    starts.push_back(Board());
+  }
+  std::vector<packedPosition> positions =
+      randomPositions(starts, count, seed);
+
+  auto decodeStart = std::chrono::steady_clock::now();
+  std::vector<positionBlock> blocks = makeBlocks(positions);
+  double decodeSeconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - decodeStart)
+                             .count();
+
+  // every position goes through all three paths and they have to agree
+  int mismatches = 0;
+  int vectorScores[BLOCK_SIZE], scalarScores[BLOCK_SIZE];
+  for (std::size_t b = 0; b < blocks.size(); ++b) {
+    evaluateBlock(blocks[b], vectorScores);
+    evaluateBlockScalar(blocks[b], scalarScores);
+    for (int slot = 0; slot < blocks[b].count; ++slot) {
+      Board board;
+      unpackPosition(positions[b * BLOCK_SIZE + slot], board);
+      int expected = evaluate(board);
+      if (vectorScores[slot] != expected || scalarScores[slot] != expected) {
+        if (mismatches++ < 5) {
+          std::cout << "mismatch on " << board.toFen() << ": evaluate "
+                    << expected << " scalar " << scalarScores[slot]
+                    << " vector " << vectorScores[slot] << std::endl;
+        }
+      }
+    }
+  }
+  std::cout << positions.size() << " positions, " << mismatches
+            << " mismatches" << std::endl;
+  std::cout << "packing into blocks: "
+            << static_cast<long long>(positions.size() / decodeSeconds)
+            << " positions/s" << std::endl;
+
+  double scalar = measure(blocks, 1, seconds, evaluateBlockScalar);
+  std::cout << "scalar, 1 thread: " << static_cast<long long>(scalar)
+            << " positions/s" << std::endl;
+  std::vector<int> threadCounts;  // powers of two, then the full count
+  for (int threads = 1; threads < maxThreads; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(maxThreads);
+  double single = 0;
+  for (int threads : threadCounts) {
+    double rate = measure(blocks, threads, seconds, evaluateBlock);
+    if (threads == 1) {
+      single = rate;
+    }
+    std::cout << "vector, " << threads << " thread"
+              << (threads > 1 ? "s: " : ": ") << static_cast<long long>(rate)
+              << " positions/s (" << static_cast<long long>(rate / threads)
+              << " per core, " << rate / single << "x)" << std::endl;
+  }
+  std::cout << "vector over scalar: " << single / scalar << "x" << std::endl;
+  return mismatches ? 1 : 0;
+}
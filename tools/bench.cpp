@@ -0,0 +1,473 @@
+// micro benchmarks for the Board hot paths over a fixed set of positions.
+//
+//   chess_bench                          print a table
+//   chess_bench --json out.json          also save the results
+//   chess_bench --compare base.json [--threshold 10]
+//                                        flag anything slower than the
+//                                        baseline by more than threshold %
+//   chess_bench --sliders magic          with another sliding attack backend
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Board.h"
+#include "Profiler.h"
+#include "SlidingAttacks.h"
+
+namespace {
+
+std::atomic<long long> allocationCount{0};
+
+}  // namespace
+
+// every heap allocation in this program goes through here so each benchmark
+// can report allocations per operation
+void* operator new(std::size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  if (void* memory = std::malloc(size ? size : 1)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+
+struct BoardBenchAccess {
+  static void findAttackedSquares(Board& board) {
+    std::vector<moveType> attackingMoves;
+    if (board.isBlackToMove()) {
+      board.findAttackedSquares<false>(board.board, attackingMoves);
+    } else {
+      board.findAttackedSquares<true>(board.board, attackingMoves);
+    }
+  }
+  // runs the check on every en passant capture available, returns how many
+  static int enPassantLegalityCheck(Board& board) {
+    if (board.enPassantFile == -1) {
+      return 0;
+    }
+    bool blackToMove = board.isBlackToMove();
+    int row = 3 + blackToMove;
+    int checks = 0;
+    for (int dx : {-1, 1}) {
+      int col = board.enPassantFile + dx;
+      int index = row * 8 + col;
+      if (col < 0 || col > 7 || board.board[index] != 1 + blackToMove * 8) {
+        continue;
+      }
+      int target = index + (blackToMove ? 8 : -8) - dx;
+      if (blackToMove) {
+        board.enPassantLegalityCheck<true>(index, target);
+      } else {
+        board.enPassantLegalityCheck<false>(index, target);
+      }
+      checks++;
+    }
+    return checks;
+  }
+  static const std::array<int, 64>& squares(const Board& board) {
+    return board.board;
+  }
+  // what a search would pay without the cuckoo tables: walk the whole
+  // history looking for any earlier copy of the position
+  static bool scanHistory(const Board& board) {
+    for (std::uint64_t key : board.keyHistory) {
+      if (key == board.positionKey) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+namespace {
+
+struct Category {
+  std::string name;
+  std::vector<std::string> fens;
+};
+
+const std::vector<Category> corpus = {
+    {"opening",
+     {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+      "r1bqk1nr/pppp1ppp/2n5/2b1p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+      "rnbqkb1r/pp2pppp/3p1n2/8/3NP3/8/PPP2PPP/RNBQKB1R w KQkq - 1 5",
+      "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3"}},
+    {"middlegame",
+     {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 "
+      "10",
+      "r2q1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 9",
+      "2r2rk1/pp1bqppp/2n1pn2/3p4/3P4/P1NBPN2/1PQ2PPP/R4RK1 b - - 3 14"}},
+    {"endgame",
+     {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+      "8/8/4k3/8/2R5/8/4K3/8 w - - 0 1",
+      "8/5pk1/6p1/8/5P2/6PK/8/8 w - - 0 1",
+      "8/8/8/KPp4r/8/8/8/6k1 w - c6 0 1"}},
+    {"check",
+     {"rnbqkbnr/ppp2ppp/8/1B1pp3/4P3/8/PPPP1PPP/RNBQK1NR b KQkq - 1 3",
+      "4k3/8/8/8/8/8/4r3/R3K2R w KQ - 0 1",
+      "8/8/8/2k5/3Pp3/8/8/4K3 b - d3 0 1",
+      "r1bqkbnr/pppp1Qpp/2n5/4p3/2B1P3/8/PPPP1PPP/RNB1K1NR b KQkq - 0 4"}},
+};
+
+struct BenchCase {
+  std::string name;
+  std::function<long long(Board&)> run;  // returns operations it did
+  std::function<void(Board&)> prepare;   // optional, run once per position
+};
+
+// plays up to 20 quiet piece moves so there is some history to search
+void playReversibleMoves(Board& board) {
+  for (int ply = 0; ply < 20; ++ply) {
+    std::vector<moveType> quietMoves;
+    for (const moveType& move : board.getMoveList()) {
+      if (move.typeOfMove == 1 && board.getPiece(move.from) % 8 != 1) {
+        quietMoves.push_back(move);
+      }
+    }
+    if (quietMoves.empty()) {
+      return;
+    }
+    // vary the pick so pieces don't just bounce back and forth
+    board.makeMove(quietMoves[ply % quietMoves.size()]);
+  }
+}
+
+struct BenchResult {
+  std::string name;
+  std::string category;
+  double nsPerOp = 0;
+  double allocsPerOp = 0;
+  double opsPerSecond = 0;
+};
+
+volatile long long sink = 0;  // keeps results alive so nothing is optimised out
+
+// the legal moves of each benched position, so the single move checks below
+// have something to ask about without timing the list being built
+std::map<std::uint64_t, std::vector<moveType>>& candidateMoves() {
+  static std::map<std::uint64_t, std::vector<moveType>> moves;
+  return moves;
+}
+
+void collectCandidates(Board& board) {
+  candidateMoves()[board.getPositionKey()] = board.getMoveList();
+}
+
+std::vector<BenchCase> benchCases() {
+  return {
+      {"generateAllMoves",
+       [](Board& board) {
+         board.generateAllMoves();
+         sink = sink + board.getAllLegalMoves().size();
+         return 1LL;
+       }},
+      {"findCheckingMoves",
+       [](Board& board) {
+         board.findCheckingMoves();
+         return 1LL;
+       }},
+      {"findPinsToKing",
+       [](Board& board) {
+         board.findPinsToKing(board.isBlackToMove());
+         return 1LL;
+       }},
+      {"findAttackedSquares",
+       [](Board& board) {
+         BoardBenchAccess::findAttackedSquares(board);
+         // the king's moves depend on these squares, so put them back
+         board.findCheckingMoves();
+         return 1LL;
+       }},
+      {"enPassantLegalityCheck",
+       [](Board& board) {
+         return static_cast<long long>(
+             BoardBenchAccess::enPassantLegalityCheck(board));
+       }},
+      {"legalMoves",  // one call per piece of the side to move
+       [](Board& board) {
+         long long calls = 0;
+         const auto& squares = BoardBenchAccess::squares(board);
+         bool blackToMove = board.isBlackToMove();
+         for (int i = 0; i < 64; ++i) {
+           if (squares[i] && squares[i] / 8 == blackToMove) {
+             sink = sink + board.legalMoves(i, squares[i], squares).size();
+             calls++;
+           }
+         }
+         return calls;
+       }},
+      {"isLegal",  // one hash or killer move checked on its own
+       [](Board& board) {
+         const auto& moves = candidateMoves()[board.getPositionKey()];
+         for (const moveType& move : moves) {
+           sink = sink + board.isLegal(move);
+         }
+         return static_cast<long long>(moves.size());
+       },
+       collectCandidates},
+      {"generateThenSearch",  // the same check by generating every move
+       [](Board& board) {
+         const auto& moves = candidateMoves()[board.getPositionKey()];
+         for (const moveType& move : moves) {
+           board.generateAllMoves();
+           bool found = false;
+           for (const pieceMoves& piece : board.getAllLegalMoves()) {
+             for (const moveType& legal : piece.moves) {
+               found |= legal.from == move.from && legal.to == move.to;
+             }
+           }
+           sink = sink + found;
+         }
+         return static_cast<long long>(moves.size());
+       },
+       collectCandidates},
+      {"setupTurn",  // everything a new turn costs
+       [](Board& board) {
+         board.setupTurn();
+         return 1LL;
+       }},
+      {"hasUpcomingRepetition",  // cuckoo lookup done at each search node
+       [](Board& board) {
+         sink = sink + board.hasUpcomingRepetition(4);
+         return 1LL;
+       },
+       playReversibleMoves},
+      {"historyScan",  // the naive per node alternative, for comparison
+       [](Board& board) {
+         sink = sink + BoardBenchAccess::scanHistory(board);
+         return 1LL;
+       },
+       playReversibleMoves},
+      {"copyBoard",  // what keeping a whole Board per ply would cost
+       [](Board& board) {
+         Board copy = board;
+         sink = sink + copy.getHalfmoveClock();
+         return 1LL;
+       }},
+      {"takeSnapshot",
+       [](Board& board) {
+         positionSnapshot snapshot = board.snapshot();
+         sink = sink + snapshot.halfmoveClock;
+         return 1LL;
+       }},
+      {"copySnapshot",  // one history entry, what stepping through a game
+                        // copies before the restore
+       [](Board& board) {
+         static positionSnapshot copies[16];
+         positionSnapshot snapshot = board.snapshot();
+         for (int i = 0; i < 16; ++i) {
+           snapshot.halfmoveClock = i;
+           copies[i] = snapshot;
+         }
+         sink = sink + copies[15].halfmoveClock;
+         return 16LL;
+       }},
+      {"restoreSnapshot",  // rebuilding moves, pins and checks from one
+       [](Board& board) {
+         board.restore(board.snapshot());
+         sink = sink + board.getAllLegalMoves().size();
+         return 1LL;
+       }},
+      {"profileScope",  // cost of one empty timed scope, 0 when compiled out
+       [](Board&) {
+         for (int i = 0; i < 16; ++i) {
+           PROFILE_SCOPE(ProfileZone::Evaluation);
+           sink = sink + 1;
+         }
+         return 16LL;
+       }},
+  };
+}
+
+BenchResult runCase(const BenchCase& benchCase, const Category& category,
+                    double minSeconds) {
+  std::vector<Board> positions;
+  for (const std::string& fen : category.fens) {
+    positions.emplace_back();
+    positions.back().loadFen(fen);
+    if (benchCase.prepare) {
+      benchCase.prepare(positions.back());
+    }
+  }
+
+  long long ops = 0;
+  long long allocations = 0;
+  double seconds = 0;
+  while (seconds < minSeconds) {
+    long long allocationsBefore = allocationCount.load();
+    auto start = std::chrono::steady_clock::now();
+    for (int repeat = 0; repeat < 100; ++repeat) {
+      for (Board& board : positions) {
+        ops += benchCase.run(board);
+      }
+    }
+    seconds += std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - start)
+                   .count();
+    allocations += allocationCount.load() - allocationsBefore;
+    if (ops == 0) {
+      break;  // nothing in this category exercises it
+    }
+  }
+
+  BenchResult result;
+  result.name = benchCase.name;
+  result.category = category.name;
+  if (ops) {
+    result.nsPerOp = seconds * 1e9 / ops;
+    result.allocsPerOp = static_cast<double>(allocations) / ops;
+    result.opsPerSecond = ops / seconds;
+  }
+  return result;
+}
+
+std::string resultKey(const std::string& name, const std::string& category) {
+  return name + "/" + category;
+}
+
+void writeJson(const std::vector<BenchResult>& results,
+               const std::string& path) {
+  std::ofstream file(path);
+  file << "{\n  \"profiling\": " << (profileEnabled() ? "true" : "false")
+       << ",\n  \"benchmarks\": [\n";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const BenchResult& r = results[i];
+    // one entry per line, --compare reads them back line by line
+    file << "    {\"name\": \"" << r.name << "\", \"category\": \""
+         << r.category << "\", \"ns_per_op\": " << r.nsPerOp
+         << ", \"allocs_per_op\": " << r.allocsPerOp
+         << ", \"ops_per_sec\": " << r.opsPerSecond << "}"
+         << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  file << "  ]\n}\n";
+}
+
+std::string jsonField(const std::string& line, const std::string& field) {
+  std::string marker = "\"" + field + "\": ";
+  auto start = line.find(marker);
+  if (start == std::string::npos) {
+    return "";
+  }
+  start += marker.size();
+  if (line[start] == '"') {
+    return line.substr(start + 1, line.find('"', start + 1) - start - 1);
+  }
+  return line.substr(start, line.find_first_of(",}", start) - start);
+}
+
+std::map<std::string, double> readBaseline(const std::string& path) {
+  std::map<std::string, double> baseline;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::string name = jsonField(line, "name");
+    std::string ns = jsonField(line, "ns_per_op");
+    if (!name.empty() && !ns.empty()) {
+      baseline[resultKey(name, jsonField(line, "category"))] = std::stod(ns);
+    }
+  }
+  return baseline;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string jsonPath, comparePath, filter;
+  double threshold = 10;  // percent
+  double minSeconds = 0.2;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    if (arg == "--json") {
+      jsonPath = argv[i + 1];
+    } else if (arg == "--compare") {
+      comparePath = argv[i + 1];
+    } else if (arg == "--threshold") {
+      threshold = std::stod(argv[i + 1]);
+    } else if (arg == "--time") {
+      minSeconds = std::stod(argv[i + 1]);
+    } else if (arg == "--filter") {
+      filter = argv[i + 1];
+    } else if (arg == "--sliders") {
+      SliderBackend backend;
+      if (!sliderBackendFromName(argv[i + 1], backend) ||
+          !setSliderBackend(backend)) {
+        std::cout << "can't use sliders " << argv[i + 1]
+                  << " (loop, kogge-stone, magic or pext)" << std::endl;
+        return 1;
+      }
+    } else {
+      std::cout << "usage: chess_bench [--json out.json] [--compare "
+                   "baseline.json] [--threshold percent] [--time seconds] "
+                   "[--filter name] [--sliders name]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  std::vector<BenchResult> results;
+  std::cout << "profiling instrumentation "
+            << (profileEnabled() ? "on" : "off") << ", sliders "
+            << sliderBackendName(getSliderBackend()) << std::endl;
+  std::cout << "sizeof(Board) " << sizeof(Board)
+            << " bytes plus its vectors and sets, sizeof(positionSnapshot) "
+            << sizeof(positionSnapshot) << " bytes" << std::endl;
+  std::cout << std::left << std::setw(26) << "benchmark" << std::setw(12)
+            << "positions" << std::right << std::setw(12) << "ns/op"
+            << std::setw(12) << "allocs/op" << std::setw(14) << "ops/s"
+            << std::endl;
+  for (const BenchCase& benchCase : benchCases()) {
+    if (!filter.empty() && benchCase.name.find(filter) == std::string::npos) {
+      continue;
+    }
+    for (const Category& category : corpus) {
+      BenchResult result = runCase(benchCase, category, minSeconds);
+      if (result.opsPerSecond == 0) {
+        continue;
+      }
+      results.push_back(result);
+      std::cout << std::left << std::setw(26) << result.name << std::setw(12)
+                << result.category << std::right << std::fixed
+                << std::setprecision(1) << std::setw(12) << result.nsPerOp
+                << std::setprecision(2) << std::setw(12) << result.allocsPerOp
+                << std::setprecision(0) << std::setw(14)
+                << result.opsPerSecond << std::endl;
+    }
+  }
+
+  if (!jsonPath.empty()) {
+    writeJson(results, jsonPath);
+  }
+
+  int regressions = 0;
+  if (!comparePath.empty()) {
+    std::map<std::string, double> baseline = readBaseline(comparePath);
+    std::cout << std::endl << "compared with " << comparePath << std::endl;
+    for (const BenchResult& result : results) {
+      auto old = baseline.find(resultKey(result.name, result.category));
+      if (old == baseline.end() || old->second <= 0) {
+        continue;
+      }
+      double change = (result.nsPerOp / old->second - 1) * 100;
+      bool regressed = change > threshold;
+      regressions += regressed;
+      std::cout << std::left << std::setw(26) << result.name << std::setw(12)
+                << result.category << std::right << std::setprecision(1)
+                << std::setw(8) << std::showpos << change << "%"
+                << std::noshowpos << (regressed ? "  REGRESSION" : "")
+                << std::endl;
+    }
+  }
+  return regressions ? 1 : 0;
+}
@@ -0,0 +1,265 @@
+// self-play training data. every core plays games from the openings (with a
+// few random moves first so no two games are the same), one task each on a
+// TaskScheduler, keeps a sample of the quiet positions with their search
+// score and the game result, and appends them to a compressed chunked file.
+//
+//   chess_datagen --openings tools/openings.epd --games 1000 --out train.bin
+//   chess_datagen --read train.bin
+
+#include <algorithm>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BoundedQueue.h"
+#include "Evaluate.h"
+#include "PackedPosition.h"
+#include "SelfPlay.h"
+#include "TaskScheduler.h"
+#include "TrainingData.h"
+
+namespace {
+
+struct DatagenOptions {
+  std::string openingsPath;
+  std::string outPath = "training.bin";
+  std::string readPath;
+  int games = 100;
+  int threads = std::max(1u, std::thread::hardware_concurrency());
+  int randomPlies = 8;
+  double sampleRate = 0.5;
+  std::size_t chunkBytes = 64 * 1024;
+  std::size_t queueChunks = 16;
+  PlayerConfig player;
+};
+
+// plays a few random moves so games from the same opening split up. returns
+// false if the random moves ended the game
+bool randomStart(Board& board, int plies, std::mt19937_64& random) {
+  for (int ply = 0; ply < plies; ++ply) {
+    std::vector<moveType> moves = board.getMoveList();
+    if (moves.empty()) {
+      return false;
+    }
+    board.makeMove(moves[random() % moves.size()]);
+  }
+  return board.getStatus() == GameStatus::Ongoing;
+}
+
+// keeps quiet positions only: nothing in check, no capture or promotion about
+// to happen and no mate scores, which is what eval tuning wants
+std::vector<bool> pickSamples(const Board& start, const SelfPlayGame& game,
+                              double rate, std::mt19937_64& random) {
+  std::uniform_real_distribution<double> coin(0, 1);
+  std::vector<bool> sampled(game.moves.size());
+  Board position = start;
+  for (std::size_t ply = 0; ply < game.moves.size(); ++ply) {
+    const moveType& move = game.moves[ply];
+    bool noisy = position.kingInCheck() || position.getPiece(move.to) ||
+                 move.typeOfMove == 4 || move.typeOfMove == 5 ||
+                 std::abs(game.scores[ply]) >= MATE_SCORE - 1000;
+    sampled[ply] = !noisy && coin(random) < rate;
+    position.makeMove(move);
+  }
+  return sampled;
+}
+
+int readBack(const std::string& path) {
+  TrainingReader reader;
+  if (!reader.open(path)) {
+    std::cout << "couldn't open " << path << std::endl;
+    return 1;
+  }
+  auto start = std::chrono::steady_clock::now();
+  long long positions = 0, whiteWins = 0, blackWins = 0, draws = 0;
+  double scoreSum = 0;
+  trainingSample sample;
+  while (reader.next(sample)) {
+    positions++;
+    scoreSum += std::abs(sample.score);
+    if (sample.outcome == GameOutcome::WhiteWins) {
+      whiteWins++;
+    } else if (sample.outcome == GameOutcome::BlackWins) {
+      blackWins++;
+    } else {
+      draws++;
+    }
+  }
+  double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  std::cout << positions << " positions (white wins " << whiteWins
+            << ", black wins " << blackWins << ", draws " << draws
+            << "), mean |score| " << (positions ? scoreSum / positions : 0)
+            << std::endl;
+  std::cout << "replayed at " << static_cast<long long>(positions / seconds)
+            << " positions/s, " << reader.getBadChunks() << " bad chunks"
+            << std::endl;
+  return reader.getBadChunks() ? 1 : 0;
+}
+
+void printUsage() {
+  std::cout << "usage: chess_datagen [--openings file.epd] [--games n]"
+               " [--threads n] [--out file]\n"
+               "         [--nodes n] [--depth n] [--random-plies n]"
+               " [--sample rate] [--chunk-kb n] [--queue n]\n"
+               "       chess_datagen --read file\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  DatagenOptions options;
+  options.player.limits.nodes = 5000;
+  options.player.hashMegabytes = 4;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    std::string value = i + 1 < argc ? argv[i + 1] : "";
+    if (arg == "--openings") {
+      options.openingsPath = value;
+    } else if (arg == "--out") {
+      options.outPath = value;
+    } else if (arg == "--read") {
+      options.readPath = value;
+    } else if (arg == "--games") {
+      options.games = std::stoi(value);
+    } else if (arg == "--threads") {
+      options.threads = std::max(1, std::stoi(value));
+    } else if (arg == "--nodes") {
+      options.player.limits.nodes = std::stoll(value);
+    } else if (arg == "--depth") {
+      options.player.limits.depth = std::stoi(value);
+    } else if (arg == "--random-plies") {
+      options.randomPlies = std::stoi(value);
+    } else if (arg == "--sample") {
+      options.sampleRate = std::stod(value);
+    } else if (arg == "--chunk-kb") {
+      options.chunkBytes = std::stoul(value) * 1024;
+    } else if (arg == "--queue") {
+      options.queueChunks = std::max(1ul, std::stoul(value));
+    } else {
+      printUsage();
+      return 1;
+    }
+    i++;
+  }
+  if (!options.readPath.empty()) {
+    return readBack(options.readPath);
+  }
+
+  std::vector<Board> openings;
+  if (!options.openingsPath.empty()) {
+    openings = loadOpenings(options.openingsPath);
+  }
+  if (openings.empty()) {
+    openings.push_back(Board());
+  }
+  TrainingWriter writer;
+  if (!writer.open(options.outPath)) {
+    std::cout << "couldn't open " << options.outPath << std::endl;
+    return 1;
+  }
+
+  // one task per game. each worker fills its own chunk and only touches the
+  // queue when it's full, the writer thread is the only one doing any disk io
+  BoundedQueue<trainingChunk> queue(options.queueChunks);
+  std::atomic<long long> gamesDone{0}, positionsDone{0};
+  std::atomic<bool> stopFlag{false};
+  auto startTime = std::chrono::steady_clock::now();
+
+  TaskScheduler scheduler(options.threads);
+  std::vector<std::mt19937_64> randoms;
+  for (int i = 0; i < options.threads; ++i) {
+    randoms.emplace_back(0x9e3779b97f4a7c15ULL * (i + 1));
+  }
+  std::vector<trainingChunk> chunks(options.threads);
+  auto playOne = [&](int gameIndex) {
+    std::mt19937_64& random = randoms[TaskScheduler::currentWorker()];
+    trainingChunk& chunk = chunks[TaskScheduler::currentWorker()];
+    Board start = openings[gameIndex % openings.size()];
+    if (!randomStart(start, options.randomPlies, random)) {
+      return;
+    }
+    SelfPlayGame game =
+        playGame(start, options.player, options.player, stopFlag);
+    std::uint32_t before = chunk.positions;
+    if (!encodeGame(start, game,
+                    pickSamples(start, game, options.sampleRate, random),
+                    chunk)) {
+      return;
+    }
+    gamesDone++;
+    positionsDone += chunk.positions - before;
+    if (chunk.payload.size() >= options.chunkBytes) {
+      queue.push(std::move(chunk));
+      chunk = trainingChunk();
+    }
+  };
+
+  std::atomic<bool> writeFailed{false};
+  std::thread writerThread([&] {
+    trainingChunk chunk;
+    while (queue.pop(chunk)) {
+      if (!writer.write(chunk)) {
+        writeFailed = true;
+      }
+    }
+  });
+
+  TaskGroup group(scheduler);
+  for (int game = 0; game < options.games; ++game) {
+    group.run([&playOne, game]() { playOne(game); });
+  }
+  std::atomic<bool> workersDone{false};
+  std::thread progress([&] {
+    auto last = std::chrono::steady_clock::now();
+    while (!workersDone) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      auto now = std::chrono::steady_clock::now();
+      if (now - last >= std::chrono::seconds(5)) {
+        last = now;
+        double seconds =
+            std::chrono::duration<double>(now - startTime).count();
+        std::cout << "games " << gamesDone << ", positions " << positionsDone
+                  << ", " << static_cast<long long>(positionsDone / seconds)
+                  << " positions/s" << std::endl;
+      }
+    }
+  });
+  group.wait();
+  for (trainingChunk& chunk : chunks) {
+    if (chunk.games) {
+      queue.push(std::move(chunk));
+    }
+  }
+  workersDone = true;
+  progress.join();
+  queue.close();
+  writerThread.join();
+
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - startTime)
+                       .count();
+  long long positions = positionsDone;
+  std::cout << gamesDone << " games, " << positions << " positions in "
+            << seconds << " s on " << options.threads << " threads"
+            << std::endl;
+  std::cout << static_cast<long long>(positions / seconds)
+            << " positions/s, " << writer.getBytesWritten() << " bytes written, "
+            << (positions ? static_cast<double>(writer.getBytesWritten()) /
+                                positions
+                          : 0)
+            << " bytes/position (" << sizeof(packedPosition)
+            << " for a packed position on its own)" << std::endl;
+  if (writeFailed) {
+    std::cout << "writing to " << options.outPath << " failed" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,180 @@
+// builds an index of which games reached which positions from PGN or training
+// files (PositionIndex.h) and looks positions up in it. building prints the
+// throughput and the size per position, and every run times random lookups,
+// half of them for positions that are in the index and half that aren't.
+//
+//   chess_index --in games.pgn --in more.pgn --out games.idx
+//   chess_index --index games.idx --line "e4 c5 Nf3 d6"
+//   chess_index --index games.idx --fen "<fen>" --limit 50
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Board.h"
+#include "Pgn.h"
+#include "PositionIndex.h"
+
+namespace {
+
+volatile std::uint64_t sink = 0;
+
+void timeQueries(const PositionIndex& index, int queries) {
+  std::mt19937_64 random(1);
+  std::vector<std::uint64_t> keys;
+  for (int i = 0; i < queries; ++i) {
+    keys.push_back(i % 2 && index.keyCount()
+                       ? index.keyAt(random() % index.keyCount())
+                       : random());
+  }
+  std::vector<double> times;
+  long long hits = 0;
+  std::uint64_t total = 0;
+  for (std::uint64_t key : keys) {
+    auto start = std::chrono::steady_clock::now();
+    const positionPosting* first;
+    std::size_t count = index.find(key, first);
+    for (std::size_t i = 0; i < count; ++i) {
+      total += first[i].game + first[i].ply;  // reads the postings too
+    }
+    times.push_back(std::chrono::duration<double, std::nano>(
+                        std::chrono::steady_clock::now() - start)
+                        .count());
+    hits += count > 0;
+  }
+  sink = sink + total;
+  std::sort(times.begin(), times.end());
+  double sum = 0;
+  for (double time : times) {
+    sum += time;
+  }
+  std::cout << queries << " lookups (" << hits << " found): mean "
+            << std::setprecision(0) << std::fixed << sum / times.size()
+            << " ns, p50 " << times[times.size() / 2] << " ns, p99 "
+            << times[times.size() * 99 / 100] << " ns, max " << times.back()
+            << " ns" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<std::string> inputs;
+  std::string outPath = "games.idx";
+  std::string indexPath;
+  std::string fen;
+  std::string line;
+  int threads = std::max(1u, std::thread::hardware_concurrency());
+  int queries = 100000;
+  int limit = 20;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--in" && i + 1 < argc) {
+      inputs.push_back(argv[++i]);
+    } else if (arg == "--out" && i + 1 < argc) {
+      outPath = argv[++i];
+    } else if (arg == "--index" && i + 1 < argc) {
+      indexPath = argv[++i];
+    } else if (arg == "--fen" && i + 1 < argc) {
+      fen = argv[++i];
+    } else if (arg == "--line" && i + 1 < argc) {
+      line = argv[++i];
+    } else if (arg == "--threads" && i + 1 < argc) {
+      threads = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--queries" && i + 1 < argc) {
+      queries = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--limit" && i + 1 < argc) {
+      limit = std::max(0, std::stoi(argv[++i]));
+    } else {
+      std::cout << "usage: chess_index [--in games.pgn|training.bin]... "
+                   "[--out file] [--threads n]\n"
+                   "                   [--index file] [--fen fen | --line "
+                   "\"e4 e5 Nf3\"] [--limit n] [--queries n]"
+                << std::endl;
+      return 1;
+    }
+  }
+  if (inputs.empty() && indexPath.empty()) {
+    std::cout << "nothing to do, give --in files to index or an --index"
+              << std::endl;
+    return 1;
+  }
+
+  if (!inputs.empty()) {
+    positionIndexStats stats;
+    auto start = std::chrono::steady_clock::now();
+    if (!buildPositionIndex(inputs, outPath, threads, stats)) {
+      return 1;
+    }
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    std::cout << std::fixed << std::setprecision(2) << stats.games
+              << " games (" << stats.brokenGames
+              << " cut short by a bad move), "
+              << stats.positions << " positions, " << stats.keys
+              << " distinct, on " << threads << " thread"
+              << (threads > 1 ? "s" : "") << std::endl
+              << "read " << stats.readSeconds << " s, replay "
+              << stats.replaySeconds << " s, sort " << stats.sortSeconds
+              << " s, write " << stats.writeSeconds << " s" << std::endl
+              << std::setprecision(0) << stats.games / seconds
+              << " games/s, " << stats.positions / seconds
+              << " positions/s overall" << std::endl
+              << outPath << ": " << stats.fileBytes << " bytes, "
+              << std::setprecision(1)
+              << static_cast<double>(stats.fileBytes) /
+                     std::max(1LL, stats.positions)
+              << " per position" << std::endl;
+    if (indexPath.empty()) {
+      indexPath = outPath;
+    }
+  }
+
+  PositionIndex index;
+  if (!index.open(indexPath)) {
+    return 1;
+  }
+  if (!fen.empty() || !line.empty()) {
+    Board position;
+    if (!fen.empty() && !position.loadFen(fen)) {
+      std::cout << "can't read the fen" << std::endl;
+      return 1;
+    }
+    if (!line.empty()) {
+      pgnGame game;
+      if (!fen.empty()) {
+        game.tags.push_back({"FEN", fen});
+      }
+      game.movetext = line;
+      std::vector<moveType> moves;
+      if (!pgnMoves(game, position, moves)) {
+        std::cout << "can't play the line after " << moves.size() << " moves"
+                  << std::endl;
+        return 1;
+      }
+      for (const moveType& move : moves) {
+        position.makeMove(move);
+      }
+    }
+    const positionPosting* first;
+    std::size_t count = index.find(position.getPositionKey(), first);
+    std::cout << position.toFen() << std::endl
+              << count << " of " << index.gameCount()
+              << " games reached it" << std::endl;
+    for (std::size_t i = 0; i < count && i < static_cast<std::size_t>(limit);
+         ++i) {
+      std::cout << "  game " << first[i].game + 1 << ", ply " << first[i].ply
+                << ": " << index.gameLabel(first[i].game) << std::endl;
+    }
+    if (count > static_cast<std::size_t>(limit)) {
+      std::cout << "  and " << count - limit << " more" << std::endl;
+    }
+  }
+  timeQueries(index, queries);
+  return 0;
+}
@@ -0,0 +1,211 @@
+// checks Board::isLegal and Board::isPseudoLegal against the full move
+// generator. every position in the perft trees of the usual test positions,
+// plus random games from the start, gets every from/to pair asked about, and
+// any move where the two disagree is printed. also times a check against
+// finding the move in a freshly generated list.
+//
+//   chess_legality                     perft trees to depth 3, 2000 games
+//   chess_legality --depth 4 --games 10000
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "Board.h"
+
+namespace {
+
+const std::vector<std::string> startPositions = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "8/8/8/KPp4r/8/8/8/6k1 w - c6 0 1",
+    "8/8/8/2k5/3Pp3/8/8/4K3 b - d3 0 1",
+    "4k3/8/8/8/8/8/4r3/R3K2R w KQ - 0 1",
+};
+
+struct CheckCounts {
+  long long positions = 0;
+  long long legalMoves = 0;
+  long long candidates = 0;  // moves isPseudoLegal let through
+  long long mismatches = 0;
+};
+
+// asks about every from/to pair, and every promotion piece where there is
+// one, and compares with the generator's list
+void checkPosition(const Board& board, CheckCounts& counts) {
+  std::set<std::tuple<int, int, int>> generated;
+  for (const moveType& move : board.getMoveList()) {
+    generated.insert({move.from, move.to, move.promotion});
+  }
+  counts.positions++;
+  counts.legalMoves += generated.size();
+
+  long long found = 0;
+  for (int from = 0; from < 64; ++from) {
+    for (int to = 0; to < 64; ++to) {
+      int kind = board.moveKind(from, to);
+      for (int type = 1; type <= 5; ++type) {
+        if (type != kind &&
+            board.isPseudoLegal(moveType{from, to, type, 0})) {
+          counts.mismatches++;
+          std::cout << board.toFen() << "  " << moveToText({from, to, type})
+                    << " pseudo legal as type " << type << ", generator says "
+                    << kind << std::endl;
+        }
+      }
+      if (!kind) {
+        continue;
+      }
+      std::vector<int> promotions = {0};
+      if (kind == 5) {
+        promotions = {5, 2, 3, 4};
+      }
+      for (int promotion : promotions) {
+        moveType move{from, to, kind, promotion};
+        counts.candidates++;
+        bool legal = board.isLegal(move);
+        found += legal;
+        if (legal != (generated.count({from, to, promotion}) == 1)) {
+          counts.mismatches++;
+          std::cout << board.toFen() << "  " << moveToText(move) << " isLegal "
+                    << legal << ", generator " << !legal << std::endl;
+        }
+      }
+    }
+  }
+  if (found != static_cast<long long>(generated.size())) {
+    counts.mismatches++;
+    std::cout << board.toFen() << "  generator has " << generated.size()
+              << " moves, isLegal found " << found << std::endl;
+  }
+}
+
+void walkTree(const Board& board, int depth, CheckCounts& counts) {
+  checkPosition(board, counts);
+  if (depth == 0) {
+    return;
+  }
+  for (const moveType& move : board.getMoveList()) {
+    Board child = board;
+    child.makeMove(move);
+    walkTree(child, depth - 1, counts);
+  }
+}
+
+void playRandomGames(int games, CheckCounts& counts) {
+  std::mt19937 random(1);
+  for (int game = 0; game < games; ++game) {
+    Board board;
+    for (int ply = 0; ply < 300; ++ply) {
+      checkPosition(board, counts);
+      std::vector<moveType> moves = board.getMoveList();
+      if (moves.empty() || board.getStatus() != GameStatus::Ongoing) {
+        break;
+      }
+      board.makeMove(moves[random() % moves.size()]);
+    }
+  }
+}
+
+// time for one yes or no on a move that is legal, each way
+void timeChecks() {
+  std::vector<Board> positions;
+  for (const std::string& fen : startPositions) {
+    Board board;
+    board.loadFen(fen);
+    positions.push_back(board);
+    for (const moveType& move : board.getMoveList()) {
+      positions.push_back(board);
+      positions.back().makeMove(move);
+    }
+  }
+  std::vector<std::vector<moveType>> moves;
+  for (const Board& board : positions) {
+    moves.push_back(board.getMoveList());
+  }
+
+  long long checks = 0;
+  long long agreed = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int repeat = 0; repeat < 20; ++repeat) {
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+      for (const moveType& move : moves[i]) {
+        agreed += positions[i].isLegal(move);
+        checks++;
+      }
+    }
+  }
+  double direct = std::chrono::duration<double, std::nano>(
+                      std::chrono::steady_clock::now() - start)
+                      .count() /
+                  checks;
+
+  start = std::chrono::steady_clock::now();
+  for (int repeat = 0; repeat < 20; ++repeat) {
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+      for (const moveType& move : moves[i]) {
+        Board& board = positions[i];
+        board.generateAllMoves();
+        for (const moveType& legal : board.getMoveList()) {
+          if (legal.from == move.from && legal.to == move.to &&
+              legal.promotion == move.promotion) {
+            agreed++;
+            break;
+          }
+        }
+      }
+    }
+  }
+  double generated = std::chrono::duration<double, std::nano>(
+                         std::chrono::steady_clock::now() - start)
+                         .count() /
+                     checks;
+  std::cout << "isLegal " << direct << " ns, generate then search "
+            << generated << " ns per move over " << positions.size()
+            << " positions (" << generated / direct << "x), " << agreed
+            << " of " << 2 * checks << " found legal" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int depth = 3;
+  int games = 2000;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--depth" && i + 1 < argc) {
+      depth = std::stoi(argv[++i]);
+    } else if (arg == "--games" && i + 1 < argc) {
+      games = std::stoi(argv[++i]);
+    } else {
+      std::cout << "usage: chess_legality [--depth n] [--games n]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  CheckCounts counts;
+  auto start = std::chrono::steady_clock::now();
+  for (const std::string& fen : startPositions) {
+    Board board;
+    board.loadFen(fen);
+    walkTree(board, depth, counts);
+  }
+  playRandomGames(games, counts);
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  std::cout << counts.positions << " positions, " << counts.legalMoves
+            << " legal moves, " << counts.candidates
+            << " pseudo legal candidates, " << counts.mismatches
+            << " mismatches in " << seconds << " s" << std::endl;
+  timeChecks();
+  return counts.mismatches ? 1 : 0;
+}
@@ -0,0 +1,252 @@
+// load generator for chess_server. every connection runs its own thread and
+// plays random games in a set of sessions, one request at a time: ask for
+// the legal moves, play one, now and then ask the engine for a reply. prints
+// the latency percentiles and requests per second over the whole run.
+//
+//   chess_loadgen --port 9000 --connections 8 --sessions 500 --seconds 10
+//   chess_loadgen --unix /tmp/chess.sock --engine-every 10 --engine-nodes 2000
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct LoadConfig {
+  int port = 9000;
+  std::string unixPath;
+  int connections = 8;
+  int sessions = 100;  // per connection
+  double seconds = 5;
+  int engineEvery = 0;  // every nth move is the engine's, 0 for never
+  long long engineNodes = 2000;
+  int maxPlies = 200;  // start the game again after this many
+};
+
+class LineClient {
+ private:
+  int fd = -1;
+  std::string buffer;
+
+ public:
+  ~LineClient() {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+
+  bool connectTo(const LoadConfig& config) {
+    if (config.unixPath.empty()) {
+      fd = socket(AF_INET, SOCK_STREAM, 0);
+      int yes = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+      sockaddr_in address{};
+      address.sin_family = AF_INET;
+      address.sin_port = htons(static_cast<std::uint16_t>(config.port));
+      address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      return connect(fd, reinterpret_cast<sockaddr*>(&address),
+                     sizeof(address)) == 0;
+    }
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, config.unixPath.c_str(),
+                 sizeof(address.sun_path) - 1);
+    return connect(fd, reinterpret_cast<sockaddr*>(&address),
+                   sizeof(address)) == 0;
+  }
+
+  bool request(const std::string& line, std::string& reply) {
+    std::string text = line + "\n";
+    std::size_t sent = 0;
+    while (sent < text.size()) {
+      ssize_t result = send(fd, text.data() + sent, text.size() - sent,
+                            MSG_NOSIGNAL);
+      if (result <= 0) {
+        return false;
+      }
+      sent += static_cast<std::size_t>(result);
+    }
+    std::size_t end;
+    while ((end = buffer.find('\n')) == std::string::npos) {
+      char chunk[4096];
+      ssize_t count = recv(fd, chunk, sizeof(chunk), 0);
+      if (count <= 0) {
+        return false;
+      }
+      buffer.append(chunk, static_cast<std::size_t>(count));
+    }
+    reply = buffer.substr(0, end);
+    buffer.erase(0, end + 1);
+    return true;
+  }
+};
+
+std::vector<std::string> splitWords(const std::string& line) {
+  std::istringstream stream(line);
+  std::vector<std::string> words;
+  std::string word;
+  while (stream >> word) {
+    words.push_back(word);
+  }
+  return words;
+}
+
+// plays random games until the deadline, returns false if the server went
+// away. latencies are in microseconds
+bool runConnection(const LoadConfig& config, int index,
+                   std::chrono::steady_clock::time_point deadline,
+                   std::vector<double>& latencies, long long& errors) {
+  LineClient client;
+  if (!client.connectTo(config)) {
+    std::cout << "couldn't connect: " << std::strerror(errno) << std::endl;
+    return false;
+  }
+  std::mt19937 random(index + 1);
+  std::uint64_t firstId = static_cast<std::uint64_t>(index) * config.sessions;
+  std::vector<int> plies(config.sessions, 0);
+  std::string reply;
+  auto timed = [&](const std::string& line) {
+    auto start = std::chrono::steady_clock::now();
+    if (!client.request(line, reply)) {
+      return false;
+    }
+    latencies.push_back(std::chrono::duration<double, std::micro>(
+                            std::chrono::steady_clock::now() - start)
+                            .count());
+    if (reply.compare(0, 3, "ok ") != 0) {
+      errors++;
+    }
+    return true;
+  };
+
+  for (int s = 0; s < config.sessions; ++s) {
+    if (!timed("new " + std::to_string(firstId + s))) {
+      return false;
+    }
+  }
+  for (int s = 0; std::chrono::steady_clock::now() < deadline;
+       s = (s + 1) % config.sessions) {
+    std::string id = std::to_string(firstId + s);
+    if (!timed("moves " + id)) {
+      return false;
+    }
+    std::vector<std::string> moves = splitWords(reply);
+    if (moves.size() <= 2 || plies[s] >= config.maxPlies) {
+      plies[s] = 0;
+      if (!timed("new " + id)) {
+        return false;
+      }
+      continue;
+    }
+    bool engineMove =
+        config.engineEvery > 0 && plies[s] % config.engineEvery ==
+                                      config.engineEvery - 1;
+    std::string line =
+        engineMove ? "go " + id + " " + std::to_string(config.engineNodes)
+                   : "move " + id + " " +
+                         moves[2 + random() % (moves.size() - 2)];
+    if (!timed(line)) {
+      return false;
+    }
+    plies[s]++;
+    std::vector<std::string> words = splitWords(reply);
+    if (words.size() < 4 || words[3] != "ongoing") {
+      plies[s] = config.maxPlies;  // over, start again next time round
+    }
+  }
+  for (int s = 0; s < config.sessions; ++s) {
+    client.request("end " + std::to_string(firstId + s), reply);
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  LoadConfig config;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--port" && i + 1 < argc) {
+      config.port = std::stoi(argv[++i]);
+    } else if (arg == "--unix" && i + 1 < argc) {
+      config.unixPath = argv[++i];
+    } else if (arg == "--connections" && i + 1 < argc) {
+      config.connections = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--sessions" && i + 1 < argc) {
+      config.sessions = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--seconds" && i + 1 < argc) {
+      config.seconds = std::stod(argv[++i]);
+    } else if (arg == "--engine-every" && i + 1 < argc) {
+      config.engineEvery = std::stoi(argv[++i]);
+    } else if (arg == "--engine-nodes" && i + 1 < argc) {
+      config.engineNodes = std::stoll(argv[++i]);
+    } else {
+      std::cout << "usage: chess_loadgen [--port n | --unix path]"
+                   " [--connections n] [--sessions n] [--seconds s]"
+                   " [--engine-every n] [--engine-nodes n]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  auto deadline = start + std::chrono::duration_cast<
+                              std::chrono::steady_clock::duration>(
+                              std::chrono::duration<double>(config.seconds));
+  std::vector<std::vector<double>> latencies(config.connections);
+  std::vector<long long> errors(config.connections, 0);
+  std::atomic<bool> failed{false};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < config.connections; ++i) {
+    threads.emplace_back([&, i] {
+      if (!runConnection(config, i, deadline, latencies[i], errors[i])) {
+        failed = true;
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  std::vector<double> all;
+  long long errorCount = 0;
+  for (int i = 0; i < config.connections; ++i) {
+    all.insert(all.end(), latencies[i].begin(), latencies[i].end());
+    errorCount += errors[i];
+  }
+  if (all.empty()) {
+    std::cout << "no requests got through" << std::endl;
+    return 1;
+  }
+  std::sort(all.begin(), all.end());
+  auto percentile = [&](double fraction) {
+    return all[std::min(all.size() - 1,
+                        static_cast<std::size_t>(fraction * all.size()))];
+  };
+  std::cout << all.size() << " requests in " << seconds << " s, "
+            << static_cast<long long>(all.size() / seconds) << " requests/s, "
+            << config.connections * config.sessions << " sessions, "
+            << errorCount << " errors\n"
+            << "latency us: p50 " << percentile(0.5) << "  p90 "
+            << percentile(0.9) << "  p99 " << percentile(0.99) << "  max "
+            << all.back() << std::endl;
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,197 @@
+// mate finder. solves a single position, or runs a suite of mate-in-n
+// positions (EPD with "dm n;") and reports nodes and time for each. with
+// --search the normal alpha-beta search is timed on the same positions,
+// at the depth the mate needs (up to --search-max moves, past that it takes
+// minutes).
+//
+//   chess_mate --suite tools/mates.epd
+//   chess_mate --suite tools/mates.epd --search
+//   chess_mate --fen "6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1" --moves 3
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Evaluate.h"
+#include "MateSolver.h"
+#include "Search.h"
+
+namespace {
+
+struct MateProblem {
+  std::string fen;
+  int mateIn;  // from the dm opcode, 0 if it didn't have one
+};
+
+std::vector<MateProblem> loadSuite(const std::string& path) {
+  std::vector<MateProblem> problems;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    std::string placement, side, castling, enPassant;
+    if (!(fields >> placement >> side >> castling >> enPassant)) {
+      continue;
+    }
+    MateProblem problem{placement + " " + side + " " + castling + " " +
+                            enPassant + " 0 1",
+                        0};
+    std::string op;
+    while (fields >> op) {
+      if (op == "dm") {
+        fields >> problem.mateIn;
+      }
+    }
+    problems.push_back(problem);
+  }
+  return problems;
+}
+
+std::string lineText(const std::vector<moveType>& line) {
+  std::string text;
+  for (const moveType& move : line) {
+    text += (text.empty() ? "" : " ") + moveToText(move);
+  }
+  return text;
+}
+
+// how long alpha-beta takes to see the same mate, for comparison
+void timeSearch(const Board& board, int mateIn, long long& nodes,
+                double& seconds, bool& found) {
+  std::atomic<bool> stop{false};
+  TranspositionTable table(16);
+  Search search(stop, &table);
+  SearchLimits limits;
+  limits.depth = 2 * mateIn - 1;
+  auto start = std::chrono::steady_clock::now();
+  int score = 0;
+  search.think(board, limits, [&](const SearchInfo& info) {
+    if (info.completed) {
+      score = info.score;
+    }
+  });
+  seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                          start)
+                .count();
+  nodes = search.getNodes();
+  found = score >= MATE_SCORE - 2 * mateIn;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string suitePath;
+  std::string fen;
+  MateLimits limits;
+  int moves = 0;
+  int hashMegabytes = 16;
+  bool compare = false;
+  int compareMax = 4;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--search") {
+      compare = true;
+    } else if (arg == "--all-moves") {
+      limits.checksOnly = false;
+    } else if (arg == "--suite" && i + 1 < argc) {
+      suitePath = argv[++i];
+    } else if (arg == "--fen" && i + 1 < argc) {
+      fen = argv[++i];
+    } else if (arg == "--moves" && i + 1 < argc) {
+      moves = std::stoi(argv[++i]);
+    } else if (arg == "--nodes" && i + 1 < argc) {
+      limits.nodes = std::stoll(argv[++i]);
+    } else if (arg == "--search-max" && i + 1 < argc) {
+      compareMax = std::stoi(argv[++i]);
+    } else if (arg == "--hash" && i + 1 < argc) {
+      hashMegabytes = std::stoi(argv[++i]);
+    } else {
+      std::cout << "usage: chess_mate (--suite file.epd | --fen fen) "
+                   "[--moves n] [--nodes n] [--hash mb] [--all-moves] "
+                   "[--search] [--search-max n]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  std::vector<MateProblem> problems;
+  if (!fen.empty()) {
+    problems.push_back({fen, 0});
+  } else if (!suitePath.empty()) {
+    problems = loadSuite(suitePath);
+  }
+  if (problems.empty()) {
+    std::cout << "no positions, pass --fen or --suite" << std::endl;
+    return 1;
+  }
+
+  MateSolver solver(hashMegabytes);
+  long long totalNodes = 0;
+  double totalSeconds = 0;
+  long long searchNodes = 0;
+  double searchSeconds = 0;
+  int solved = 0;
+  int wrong = 0;
+  for (const MateProblem& problem : problems) {
+    Board board;
+    if (!board.loadFen(problem.fen)) {
+      std::cout << "couldn't read fen: " << problem.fen << std::endl;
+      continue;
+    }
+    limits.moves = moves ? moves : (problem.mateIn ? problem.mateIn : 5);
+    auto start = std::chrono::steady_clock::now();
+    MateResult result = solver.solve(board, limits);
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    totalNodes += result.nodes;
+    totalSeconds += seconds;
+
+    std::cout << problem.fen << "\n  ";
+    if (result.status == MateStatus::Proven) {
+      std::cout << "mate in " << result.mateIn << ": " << lineText(result.line);
+      solved++;
+      if (problem.mateIn && result.mateIn != problem.mateIn) {
+        std::cout << "  (expected mate in " << problem.mateIn << ")";
+        wrong++;
+      }
+    } else if (result.status == MateStatus::Disproven) {
+      std::cout << "no mate in " << limits.moves;
+      if (problem.mateIn) {
+        std::cout << "  (expected mate in " << problem.mateIn << ")";
+        wrong++;
+      }
+    } else {
+      std::cout << "unknown, ran out of nodes";
+    }
+    std::cout << "\n  pn: " << result.nodes << " nodes " << seconds << " s";
+    if (compare && problem.mateIn > compareMax) {
+      std::cout << "   alpha-beta: skipped";
+    } else if (compare && problem.mateIn) {
+      long long nodes = 0;
+      double searchTime = 0;
+      bool found = false;
+      timeSearch(board, problem.mateIn, nodes, searchTime, found);
+      searchNodes += nodes;
+      searchSeconds += searchTime;
+      std::cout << "   alpha-beta: " << nodes << " nodes " << searchTime
+                << " s" << (found ? "" : " (didn't see it)");
+    }
+    std::cout << std::endl;
+  }
+  std::cout << "solved " << solved << "/" << problems.size();
+  if (wrong) {
+    std::cout << ", " << wrong << " different from the suite";
+  }
+  std::cout << "\npn total: " << totalNodes << " nodes " << totalSeconds
+            << " s" << std::endl;
+  if (compare) {
+    std::cout << "alpha-beta total: " << searchNodes << " nodes "
+              << searchSeconds << " s" << std::endl;
+  }
+  return wrong ? 1 : 0;
+}
@@ -0,0 +1,187 @@
+// move generator check and speed test.
+//
+//   chess_perft --depth 5
+//   chess_perft --fen "<fen>" --depth 4 --divide
+//   chess_perft --depth 5 --profile perft.json --trace perft_trace.json
+//   chess_perft --depth 5 --sliders kogge-stone
+//   chess_perft --depth 6 --threads 8 --pin
+//
+// spread over worker processes (PerftCluster.h), all on this machine or with
+// workers on others connecting to the coordinator:
+//   chess_perft --depth 7 --local 4
+//   chess_perft --depth 8 --listen 9100 --remote --timeout 600
+//   chess_perft --connect coordinator-host:9100
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "Board.h"
+#include "Perft.h"
+#include "PerftCluster.h"
+#include "Profiler.h"
+#include "SlidingAttacks.h"
+#include "TaskScheduler.h"
+
+int main(int argc, char** argv) {
+  std::string fen;
+  std::string profilePath, tracePath;
+  int depth = 5;
+  bool divide = false;
+  int threads = 1;
+  bool pin = false;
+  perftClusterConfig cluster;
+  bool distributed = false;
+  std::string connectTo;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--divide") {
+      divide = true;
+    } else if (arg == "--fen" && i + 1 < argc) {
+      fen = argv[++i];
+    } else if (arg == "--depth" && i + 1 < argc) {
+      depth = std::stoi(argv[++i]);
+    } else if (arg == "--profile" && i + 1 < argc) {
+      profilePath = argv[++i];
+    } else if (arg == "--trace" && i + 1 < argc) {
+      tracePath = argv[++i];
+    } else if (arg == "--sliders" && i + 1 < argc) {
+      SliderBackend backend;
+      if (!sliderBackendFromName(argv[++i], backend) ||
+          !setSliderBackend(backend)) {
+        std::cout << "can't use sliders " << argv[i]
+                  << " (loop, kogge-stone, magic or pext)" << std::endl;
+        return 1;
+      }
+    } else if (arg == "--threads" && i + 1 < argc) {
+      threads = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--pin") {
+      pin = true;
+    } else if (arg == "--local" && i + 1 < argc) {
+      cluster.localWorkers = std::max(0, std::stoi(argv[++i]));
+      distributed = true;
+    } else if (arg == "--listen" && i + 1 < argc) {
+      cluster.port = std::stoi(argv[++i]);
+      distributed = true;
+    } else if (arg == "--remote") {
+      cluster.remote = true;
+      distributed = true;
+    } else if (arg == "--split" && i + 1 < argc) {
+      cluster.splitDepth = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--timeout" && i + 1 < argc) {
+      cluster.timeoutSeconds = std::stod(argv[++i]);
+    } else if (arg == "--stall-every" && i + 1 < argc) {
+      cluster.stallEvery = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--connect" && i + 1 < argc) {
+      connectTo = argv[++i];
+    } else {
+      std::cout << "usage: chess_perft [--fen fen] [--depth n] [--divide] "
+                   "[--profile out.json] [--trace trace.json] "
+                   "[--sliders name]\n"
+                   "                   [--threads n] [--pin]\n"
+                   "                   [--local n] [--listen port] "
+                   "[--remote] [--split plies] [--timeout s] "
+                   "[--stall-every n]\n"
+                   "       chess_perft --connect host:port"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  if (!connectTo.empty()) {
+    std::size_t colon = connectTo.rfind(':');
+    if (colon == std::string::npos) {
+      std::cout << "--connect wants host:port" << std::endl;
+      return 1;
+    }
+    return runPerftWorker(connectTo.substr(0, colon),
+                          std::stoi(connectTo.substr(colon + 1)))
+               ? 0
+               : 1;
+  }
+
+  Board board;
+  if (!fen.empty() && !board.loadFen(fen)) {
+    std::cout << "couldn't read fen: " << fen << std::endl;
+    return 1;
+  }
+  if (!tracePath.empty()) {
+    profileSetTracing(true);
+  }
+
+  if (distributed) {
+    perftClusterResult result;
+    if (!runPerftCoordinator(board, depth, cluster, result)) {
+      return 1;
+    }
+    if (divide) {
+      for (const auto& [move, count] : result.divide) {
+        std::cout << moveToText(move) << ": " << count << std::endl;
+      }
+    }
+    std::cout << "depth " << depth << " nodes " << result.nodes << " time "
+              << result.seconds << " s  "
+              << static_cast<long long>(result.nodes / result.seconds)
+              << " nodes/s" << std::endl
+              << result.units << " units from " << result.splitLines
+              << " lines at split depth " << result.splitDepth << " ("
+              << result.splitSeconds << " s), " << result.unitNodes
+              << " nodes counted, " << result.reissued << " re-issued"
+              << std::endl;
+    for (const perftWorkerStats& worker : result.workers) {
+      std::cout << "  " << std::left << std::setw(24) << worker.name
+                << std::right << std::setw(6) << worker.units << " units"
+                << std::setw(4) << worker.late << " late" << std::setw(14)
+                << worker.nodes << " nodes  " << std::fixed
+                << std::setprecision(2) << worker.busySeconds << " s of "
+                << worker.connectedSeconds << " s busy ("
+                << std::setprecision(0)
+                << 100 * worker.busySeconds /
+                       std::max(1e-9, worker.connectedSeconds)
+                << "%)" << std::defaultfloat << std::setprecision(6)
+                << std::endl;
+    }
+    return 0;
+  }
+
+  std::unique_ptr<TaskScheduler> scheduler;
+  if (threads > 1) {
+    scheduler = std::make_unique<TaskScheduler>(threads, pin);
+  }
+  auto start = std::chrono::steady_clock::now();
+  long long nodes = 0;
+  if (divide) {
+    for (const auto& [move, count] : scheduler
+                                         ? perftDivide(board, depth, *scheduler)
+                                         : perftDivide(board, depth)) {
+      std::cout << moveToText(move) << ": " << count << std::endl;
+      nodes += count;
+    }
+  } else {
+    nodes = scheduler ? perft(board, depth, *scheduler) : perft(board, depth);
+  }
+  double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+
+  std::cout << "depth " << depth << " nodes " << nodes << " time " << seconds
+            << " s  " << static_cast<long long>(nodes / seconds)
+            << " nodes/s (sliders " << sliderBackendName(getSliderBackend())
+            << ", " << threads << " thread" << (threads > 1 ? "s" : "") << ")"
+            << std::endl;
+
+  if (!profilePath.empty()) {
+    if (!profileEnabled()) {
+      std::cout << "profiling is off in this build (configure with "
+                   "-DCHESS_PROFILE=ON)"
+                << std::endl;
+    }
+    profileWriteJson(profilePath);
+  }
+  if (!tracePath.empty()) {
+    profileWriteChromeTrace(tracePath);
+  }
+  return 0;
+}
@@ -0,0 +1,264 @@
+// what pondering buys. plays the Engine on a clock against a stand in for a
+// person: a small fixed node search that then sits out the rest of its think
+// time, the way the engine sees someone at the board. every game is played
+// once with pondering the way Game does it and once without, and for each
+// the depth the engine's moves reached and the clock time they took. with
+// pondering on it also times a miss: how long the ponder search takes to
+// give up once the real move is in, and how long the new search takes to
+// finish its first iteration.
+//
+//   chess_ponder --games 4 --clock 20000 --think 500
+//   chess_ponder --openings tools/openings.epd --opponent-nodes 50000
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Board.h"
+#include "ChessClock.h"
+#include "Engine.h"
+#include "Search.h"
+#include "SelfPlay.h"
+#include "TranspositionTable.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct PonderOptions {
+  int games = 2;
+  int clockMs = 20000;
+  int incrementMs = 200;
+  int thinkMs = 500;  // the opponent's time per move
+  long long opponentNodes = 20000;
+  int maxPlies = 60;
+};
+
+struct PonderTally {
+  int engineMoves = 0;
+  long long depths = 0;
+  double moveMs = 0;  // off the engine's clock
+  int hits = 0, misses = 0;
+  double savedMs = 0;
+  double abortMs = 0;  // misses, until the ponder search answered
+  int aborts = 0;
+  double restartMs = 0;  // misses, until the new search's first iteration
+  int restarts = 0;
+};
+
+double msSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+bool sameMove(const moveType& a, const moveType& b) {
+  return a.from == b.from && a.to == b.to && a.promotion == b.promotion;
+}
+
+void playPonderGame(const Board& start, bool engineBlack, bool ponder,
+                    const PonderOptions& options, PonderTally& tally) {
+  Engine engine;
+  TranspositionTable opponentTable(16);
+  std::atomic<bool> noStop{false};
+  ChessClock clock(options.clockMs, options.incrementMs);
+  Board board = start;
+  engine.newPosition(board);
+
+  SearchLimits engineLimits;
+  unsigned searchId = 0;
+  bool pondering = false;
+  moveType ponderMove{-1, -1, 0};
+  Clock::time_point ponderStart;
+  unsigned abortedId = 0;  // a missed ponder search not answered yet
+  Clock::time_point missTime;
+  bool timingRestart = false;
+
+  auto startSearch = [&](const Board& position, bool asPonder) {
+    SearchLimits limits = engineLimits;
+    limits.timeLeftMs = std::max(1, clock.remainingMs(engineBlack));
+    limits.incrementMs = clock.getIncrementMs();
+    limits.ponder = asPonder;
+    engine.newPosition(position);
+    searchId = engine.think(limits);
+  };
+  // everything the engine has sent, true once the move searchId is after
+  // has come in
+  auto drain = [&](EngineResult& move, int& depth) {
+    EngineResult result;
+    bool done = false;
+    while (engine.pollResult(result)) {
+      if (result.searchId == abortedId && result.isFinal) {
+        tally.abortMs += msSince(missTime);
+        tally.aborts++;
+        abortedId = 0;
+      }
+      if (result.searchId != searchId) {
+        continue;
+      }
+      if (!result.isFinal) {
+        if (result.info.completed) {
+          depth = result.info.depth;
+          if (timingRestart) {
+            tally.restartMs += msSince(missTime);
+            tally.restarts++;
+            timingRestart = false;
+          }
+        }
+        continue;
+      }
+      move = result;
+      done = true;
+    }
+    return done;
+  };
+
+  clock.start(board.isBlackToMove());
+  if (board.isBlackToMove() == engineBlack) {
+    startSearch(board, false);
+  }
+  for (int ply = 0; ply < options.maxPlies &&
+                    board.getStatus() == GameStatus::Ongoing;
+       ++ply) {
+    EngineResult result;
+    int depth = 0;
+    if (board.isBlackToMove() == engineBlack) {
+      Clock::time_point turnStart = Clock::now();
+      while (!drain(result, depth)) {
+        if (clock.flagged(engineBlack)) {
+          engine.stop();
+          return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      tally.engineMoves++;
+      tally.depths += depth;
+      tally.moveMs += msSince(turnStart);
+      if (result.bestMove.from < 0) {
+        return;
+      }
+      board.makeMove(result.bestMove);
+      clock.press();
+      if (ponder && result.ponderMove.from >= 0 &&
+          board.getStatus() == GameStatus::Ongoing) {
+        Board expected = board;
+        expected.makeMove(result.ponderMove);
+        startSearch(expected, true);
+        pondering = true;
+        ponderMove = result.ponderMove;
+        ponderStart = Clock::now();
+      }
+      continue;
+    }
+
+    Clock::time_point turnStart = Clock::now();
+    Search search(noStop, &opponentTable);
+    SearchLimits limits;
+    limits.nodes = options.opponentNodes;
+    moveType reply = search.think(board, limits, [](const SearchInfo&) {});
+    while (msSince(turnStart) < options.thinkMs) {
+      drain(result, depth);  // a ponder search doesn't finish on its own
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    board.makeMove(reply);
+    clock.press();
+    if (board.getStatus() != GameStatus::Ongoing) {
+      break;
+    }
+    if (pondering && sameMove(reply, ponderMove)) {
+      engine.ponderHit();
+      tally.hits++;
+      tally.savedMs += msSince(ponderStart);
+    } else {
+      if (pondering) {
+        tally.misses++;
+        abortedId = searchId;
+        missTime = Clock::now();
+        timingRestart = true;
+      }
+      startSearch(board, false);
+    }
+    pondering = false;
+  }
+  engine.stop();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  PonderOptions options;
+  std::string openingsPath;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--games" && i + 1 < argc) {
+      options.games = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--clock" && i + 1 < argc) {
+      options.clockMs = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--inc" && i + 1 < argc) {
+      options.incrementMs = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--think" && i + 1 < argc) {
+      options.thinkMs = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--opponent-nodes" && i + 1 < argc) {
+      options.opponentNodes = std::max(1LL, std::stoll(argv[++i]));
+    } else if (arg == "--plies" && i + 1 < argc) {
+      options.maxPlies = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--openings" && i + 1 < argc) {
+      openingsPath = argv[++i];
+    } else {
+      std::cout << "usage: chess_ponder [--games n] [--clock ms] [--inc ms] "
+                   "[--think ms] [--opponent-nodes n] [--plies n] "
+                   "[--openings file]"
+                << std::endl;
+      return 1;
+    }
+  }
+  std::vector<Board> openings;
+  if (!openingsPath.empty()) {
+    openings = loadOpenings(openingsPath);
+    if (openings.empty()) {
+      std::cout << "no positions in " << openingsPath << std::endl;
+      return 1;
+    }
+  } else {
+    openings.push_back(Board());
+  }
+
+  PonderTally on, off;
+  for (int game = 0; game < options.games; ++game) {
+    const Board& start = openings[game % openings.size()];
+    bool engineBlack = game % 2 == 1;
+    playPonderGame(start, engineBlack, true, options, on);
+    playPonderGame(start, engineBlack, false, options, off);
+    std::cout << "game " << game + 1 << " of " << options.games << ": "
+              << on.hits << " hits, " << on.misses << " misses so far"
+              << std::endl;
+  }
+
+  std::cout << std::fixed << std::setprecision(1) << std::setw(10) << ""
+            << std::setw(8) << "moves" << std::setw(10) << "depth"
+            << std::setw(12) << "ms/move" << std::endl;
+  for (const auto& [name, tally] :
+       {std::make_pair("ponder", &on), std::make_pair("no ponder", &off)}) {
+    int moves = std::max(1, tally->engineMoves);
+    std::cout << std::setw(10) << name << std::setw(8) << tally->engineMoves
+              << std::setw(10) << double(tally->depths) / moves
+              << std::setw(12) << tally->moveMs / moves << std::endl;
+  }
+  int ponders = on.hits + on.misses;
+  std::cout << "hits " << on.hits << " of " << ponders << " ("
+            << 100.0 * on.hits / std::max(1, ponders) << "%), "
+            << on.savedMs / 1000 << " s searched on the opponent's time"
+            << std::endl;
+  if (on.misses > 0) {
+    std::cout << std::setprecision(2) << "a miss: ponder search gone in "
+              << on.abortMs / std::max(1, on.aborts)
+              << " ms, new search through its first iteration in "
+              << on.restartMs / std::max(1, on.restarts) << " ms"
+              << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,138 @@
+// times seeking to random plies of long games in a GameRecord for a range of
+// checkpoint intervals. an interval as long as the game is the same as
+// replaying from the start every time, an interval of 1 is a snapshot for
+// every ply. also checks every seek lands on the position the game had.
+//
+//   chess_replay --games 20 --plies 300 --seeks 2000
+//   chess_replay --intervals 1,8,16,64
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Board.h"
+#include "GameRecord.h"
+
+namespace {
+
+// random moves until the game has plies of them, draws by the fifty move
+// rule or repetition are played through. tries again if it gets mated first
+std::vector<moveType> randomGame(std::mt19937& random, int plies) {
+  while (true) {
+    Board board;
+    std::vector<moveType> moves;
+    while (static_cast<int>(moves.size()) < plies) {
+      std::vector<moveType> legal = board.getMoveList();
+      if (legal.empty()) {
+        break;
+      }
+      moves.push_back(legal[random() % legal.size()]);
+      board.makeMove(moves.back());
+    }
+    if (static_cast<int>(moves.size()) == plies) {
+      return moves;
+    }
+  }
+}
+
+std::vector<int> parseIntervals(const std::string& text) {
+  std::vector<int> intervals;
+  std::istringstream stream(text);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    intervals.push_back(std::max(1, std::stoi(item)));
+  }
+  return intervals;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int games = 20;
+  int plies = 300;
+  int seeks = 2000;
+  std::vector<int> intervals = {1, 4, 8, 16, 32};
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--games" && i + 1 < argc) {
+      games = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--plies" && i + 1 < argc) {
+      plies = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--seeks" && i + 1 < argc) {
+      seeks = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--intervals" && i + 1 < argc) {
+      intervals = parseIntervals(argv[++i]);
+    } else {
+      std::cout << "usage: chess_replay [--games n] [--plies n] [--seeks n]"
+                   " [--intervals 1,4,16]"
+                << std::endl;
+      return 1;
+    }
+  }
+  intervals.push_back(plies + 1);  // one checkpoint, replays from the start
+
+  std::mt19937 random(1);
+  std::vector<std::vector<moveType>> gameMoves;
+  std::vector<std::vector<std::uint64_t>> gameKeys;  // to check seeks against
+  for (int g = 0; g < games; ++g) {
+    gameMoves.push_back(randomGame(random, plies));
+    Board board;
+    gameKeys.emplace_back(1, board.getPositionKey());
+    for (const moveType& move : gameMoves.back()) {
+      board.makeMove(move);
+      gameKeys.back().push_back(board.getPositionKey());
+    }
+  }
+  std::vector<std::pair<int, int>> targets;  // game, ply
+  for (int s = 0; s < seeks; ++s) {
+    targets.push_back({static_cast<int>(random() % games),
+                       static_cast<int>(random() % (plies + 1))});
+  }
+
+  std::cout << games << " games of " << plies << " plies, " << seeks
+            << " seeks to random plies" << std::endl;
+  int wrong = 0;
+  for (int interval : intervals) {
+    std::vector<GameRecord> records;
+    for (const std::vector<moveType>& moves : gameMoves) {
+      records.emplace_back(interval);
+      Board board;
+      for (const moveType& move : moves) {
+        board.makeMove(move);
+        records.back().push(move, board);
+      }
+    }
+
+    std::vector<double> times;
+    Board board;
+    for (const auto& [game, ply] : targets) {
+      auto start = std::chrono::steady_clock::now();
+      records[game].seek(ply, board);
+      times.push_back(std::chrono::duration<double, std::micro>(
+                          std::chrono::steady_clock::now() - start)
+                          .count());
+      wrong += board.getPositionKey() != gameKeys[game][ply];
+    }
+    std::sort(times.begin(), times.end());
+    double total = 0;
+    for (double time : times) {
+      total += time;
+    }
+    std::cout << (interval > plies ? std::string("from start")
+                                   : "interval " + std::to_string(interval))
+              << ": mean " << total / times.size() << " us, p50 "
+              << times[times.size() / 2] << " us, p99 "
+              << times[times.size() * 99 / 100] << " us, max " << times.back()
+              << " us, " << records[0].memoryBytes() << " bytes per game"
+              << std::endl;
+  }
+  if (wrong) {
+    std::cout << wrong << " seeks landed on the wrong position" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,266 @@
+// how well uneven work spreads over threads (TaskScheduler.h). runs perft
+// from a position where one root move has almost all of the tree three ways
+// at each thread count:
+//   static   the root moves dealt out to one std::thread each in turn
+//   locked   the same tasks as stealing, but every thread pushes to and pops
+//            from one queue behind one mutex
+//   stealing the TaskScheduler, a deque per worker
+// then times a tree of a million empty tasks on the locked queue and on the
+// scheduler, which is the cost of handing out a task with nothing to hide it.
+//
+//   chess_scheduler --threads 8
+//   chess_scheduler --fen "<fen>" --depth 6 --split 3 --pin
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Board.h"
+#include "Perft.h"
+#include "TaskScheduler.h"
+
+namespace {
+
+// black is stalemated after every white move but b6-b7+, which lets the king
+// out, and g3-g4, which lets the h-pawn take. b6-b7 has 90% of the nodes
+const std::string unevenFen = "k7/P7/PP6/7p/7P/2N3P1/8/3QKR2 w - - 0 1";
+
+// one mutex, one queue, for comparison
+class LockedPool {
+ private:
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<std::function<void()>> queue;
+  long long pending = 0;  // queued or running
+  bool stopping = false;
+  std::vector<std::thread> threads;
+
+ public:
+  explicit LockedPool(int count) {
+    for (int i = 0; i < count; ++i) {
+      threads.emplace_back([this]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+          changed.wait(lock, [this] { return stopping || !queue.empty(); });
+          if (stopping) {
+            return;
+          }
+          std::function<void()> work = std::move(queue.front());
+          queue.pop_front();
+          lock.unlock();
+          work();
+          lock.lock();
+          if (--pending == 0) {
+            changed.notify_all();
+          }
+        }
+      });
+    }
+  }
+  ~LockedPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    changed.notify_all();
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+  void run(std::function<void()> work) {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push_back(std::move(work));
+    pending++;
+    changed.notify_one();
+  }
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return pending == 0; });
+  }
+};
+
+void lockedPerft(LockedPool& pool, const Board& position, int depth,
+                 int splitDepth, std::atomic<long long>& nodes) {
+  if (depth <= splitDepth) {
+    nodes.fetch_add(perft(position, depth), std::memory_order_relaxed);
+    return;
+  }
+  for (const moveType& move : position.getMoveList()) {
+    Board child = position;
+    child.makeMove(move);
+    pool.run([&pool, child, depth, splitDepth, &nodes]() {
+      lockedPerft(pool, child, depth - 1, splitDepth, nodes);
+    });
+  }
+}
+
+long long staticPerft(const Board& position, int depth, int threads) {
+  std::vector<moveType> moves = position.getMoveList();
+  std::vector<long long> counts(threads, 0);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t]() {
+      for (std::size_t i = t; i < moves.size(); i += threads) {
+        Board child = position;
+        child.makeMove(moves[i]);
+        counts[t] += perft(child, depth - 1);
+      }
+    });
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  long long nodes = 0;
+  for (long long count : counts) {
+    nodes += count;
+  }
+  return nodes;
+}
+
+// a binary tree of tasks that do nothing, levels deep
+void emptyTree(LockedPool& pool, int levels) {
+  if (levels > 0) {
+    pool.run([&pool, levels]() { emptyTree(pool, levels - 1); });
+    pool.run([&pool, levels]() { emptyTree(pool, levels - 1); });
+  }
+}
+
+void emptyTree(TaskGroup& group, int levels) {
+  if (levels > 0) {
+    group.run([&group, levels]() { emptyTree(group, levels - 1); });
+    group.run([&group, levels]() { emptyTree(group, levels - 1); });
+  }
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string fen = unevenFen;
+  int depth = 8;
+  int splitDepth = 3;
+  int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  bool pin = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--fen" && i + 1 < argc) {
+      fen = argv[++i];
+    } else if (arg == "--depth" && i + 1 < argc) {
+      depth = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--split" && i + 1 < argc) {
+      splitDepth = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--threads" && i + 1 < argc) {
+      maxThreads = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--pin") {
+      pin = true;
+    } else {
+      std::cout << "usage: chess_scheduler [--fen fen] [--depth n] "
+                   "[--split plies] [--threads n] [--pin]"
+                << std::endl;
+      return 1;
+    }
+  }
+  Board position;
+  if (!position.loadFen(fen)) {
+    std::cout << "couldn't read fen: " << fen << std::endl;
+    return 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::pair<moveType, long long>> divide =
+      perftDivide(position, depth);
+  double serialSeconds = secondsSince(start);
+  long long expected = 0, biggest = 0;
+  for (const auto& [move, count] : divide) {
+    expected += count;
+    biggest = std::max(biggest, count);
+  }
+  std::cout << std::fixed << std::setprecision(1) << "perft " << depth
+            << ": " << expected << " nodes, " << divide.size()
+            << " root moves, the biggest has "
+            << 100.0 * biggest / std::max(1LL, expected) << "%, "
+            << std::setprecision(3) << serialSeconds << " s on one thread"
+            << std::endl
+            << std::setw(8) << "threads" << std::setw(12) << "static"
+            << std::setw(12) << "locked" << std::setw(12) << "stealing"
+            << std::setw(10) << "steals" << "   (speedup over one thread)"
+            << std::endl;
+
+  std::vector<int> counts;
+  for (int threads = 1; threads < maxThreads; threads *= 2) {
+    counts.push_back(threads);
+  }
+  counts.push_back(maxThreads);
+  bool allRight = true;
+  for (int threads : counts) {
+    start = std::chrono::steady_clock::now();
+    long long staticNodes = staticPerft(position, depth, threads);
+    double staticSeconds = secondsSince(start);
+
+    std::atomic<long long> lockedNodes{0};
+    double lockedSeconds;
+    {
+      LockedPool pool(threads);
+      start = std::chrono::steady_clock::now();
+      lockedPerft(pool, position, depth, splitDepth, lockedNodes);
+      pool.wait();
+      lockedSeconds = secondsSince(start);
+    }
+
+    TaskScheduler scheduler(threads, pin);
+    start = std::chrono::steady_clock::now();
+    long long stealingNodes = perft(position, depth, scheduler, splitDepth);
+    double stealingSeconds = secondsSince(start);
+
+    allRight = allRight && staticNodes == expected &&
+               lockedNodes == expected && stealingNodes == expected;
+    std::cout << std::setprecision(2) << std::setw(8) << threads
+              << std::setw(11) << serialSeconds / staticSeconds << "x"
+              << std::setw(11) << serialSeconds / lockedSeconds << "x"
+              << std::setw(11) << serialSeconds / stealingSeconds << "x"
+              << std::setw(10) << scheduler.steals() << std::endl;
+  }
+  if (!allRight) {
+    std::cout << "a parallel count didn't match the serial one" << std::endl;
+    return 1;
+  }
+
+  const int levels = 19;  // 2^20 - 2 tasks
+  long long tasks = (2LL << levels) - 2;
+  std::cout << std::setprecision(1) << tasks << " empty tasks on "
+            << maxThreads << " thread" << (maxThreads > 1 ? "s" : "")
+            << ":";
+  {
+    LockedPool pool(maxThreads);
+    start = std::chrono::steady_clock::now();
+    emptyTree(pool, levels);
+    pool.wait();
+    std::cout << " locked " << tasks / secondsSince(start) / 1e6 << "M/s";
+  }
+  {
+    TaskScheduler scheduler(maxThreads, pin);
+    start = std::chrono::steady_clock::now();
+    {
+      TaskGroup group(scheduler);
+      group.run([&group]() { emptyTree(group, levels); });
+      group.wait();
+    }
+    std::cout << ", stealing " << (tasks + 1) / secondsSince(start) / 1e6
+              << "M/s" << std::endl;
+  }
+  return 0;
+}
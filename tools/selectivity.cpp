@@ -0,0 +1,184 @@
+// what each part of the selective search (SearchFeatures in Search.h) buys.
+// searches a set of positions to a fixed depth with everything off, with each
+// part on its own, with everything on, and with everything but each part, a
+// fresh table every time. prints the nodes and time to reach the depth, the
+// effective branching factor (how many times more nodes each extra ply of
+// the last two costs) and how often the best move matches the full width
+// search.
+//
+//   chess_selectivity --depth 6
+//   chess_selectivity --depth 7 --positions tools/openings.epd --count 8
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Search.h"
+#include "SelfPlay.h"
+#include "TranspositionTable.h"
+
+namespace {
+
+struct namedFeatures {
+  std::string name;
+  SearchFeatures features;
+};
+
+const std::vector<std::string> defaultPositions = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "r1bqkbnr/pp1ppp1p/2n3p1/2p5/4P3/2N3P1/PPPP1P1P/R1BQKBNR w KQkq - 0 4",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+};
+
+// every part off, each on its own, all on, and all but each
+std::vector<namedFeatures> makeConfigs() {
+  SearchFeatures none{false, false, false, false, false};
+  SearchFeatures all;
+  const char* names[5] = {"pvs", "null move", "lmr", "futility",
+                          "aspiration"};
+  auto part = [](SearchFeatures& features, int i) -> bool& {
+    bool* parts[5] = {&features.pvs, &features.nullMove, &features.lmr,
+                      &features.futility, &features.aspiration};
+    return *parts[i];
+  };
+  std::vector<namedFeatures> configs = {{"none", none}};
+  for (int i = 0; i < 5; ++i) {
+    namedFeatures config{std::string("only ") + names[i], none};
+    part(config.features, i) = true;
+    configs.push_back(config);
+  }
+  configs.push_back({"all", all});
+  for (int i = 0; i < 5; ++i) {
+    namedFeatures config{std::string("all but ") + names[i], all};
+    part(config.features, i) = false;
+    configs.push_back(config);
+  }
+  return configs;
+}
+
+struct configResult {
+  std::vector<long long> depthNodes;  // nodes for each iteration on its own,
+                                      // summed over the positions
+  std::vector<long long> depthMs;     // time to finish each depth, summed
+  std::vector<moveType> bestMoves;
+};
+
+configResult run(const std::vector<Board>& positions, int depth,
+                 int hashMegabytes, const SearchFeatures& features) {
+  configResult result;
+  result.depthNodes.assign(depth + 1, 0);
+  result.depthMs.assign(depth + 1, 0);
+  std::atomic<bool> stop{false};
+  for (const Board& position : positions) {
+    TranspositionTable table(hashMegabytes);
+    Search search(stop, &table);
+    SearchLimits limits;
+    limits.depth = depth;
+    limits.features = features;
+    long long lastNodes = 0;
+    result.bestMoves.push_back(
+        search.think(position, limits, [&](const SearchInfo& info) {
+          if (!info.completed) {
+            return;
+          }
+          result.depthNodes[info.depth] += info.nodes - lastNodes;
+          result.depthMs[info.depth] += info.timeMs;
+          lastNodes = info.nodes;
+        }));
+  }
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int depth = 6;
+  int hashMegabytes = 16;
+  int count = 0;  // 0 is every position in the file
+  std::string positionsPath;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--depth" && i + 1 < argc) {
+      depth = std::max(3, std::stoi(argv[++i]));
+    } else if (arg == "--positions" && i + 1 < argc) {
+      positionsPath = argv[++i];
+    } else if (arg == "--count" && i + 1 < argc) {
+      count = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--hash" && i + 1 < argc) {
+      hashMegabytes = std::stoi(argv[++i]);
+    } else {
+      std::cout << "usage: chess_selectivity [--depth n] [--positions file] "
+                   "[--count n] [--hash mb]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  std::vector<Board> positions;
+  if (positionsPath.empty()) {
+    for (const std::string& fen : defaultPositions) {
+      positions.emplace_back();
+      positions.back().loadFen(fen);
+    }
+  } else {
+    positions = loadOpenings(positionsPath);
+  }
+  if (count && static_cast<int>(positions.size()) > count) {
+    positions.resize(count);
+  }
+  if (positions.empty()) {
+    std::cout << "no positions" << std::endl;
+    return 1;
+  }
+
+  std::cout << positions.size() << " positions to depth " << depth
+            << std::endl
+            << std::left << std::setw(22) << "" << std::right
+            << std::setw(14) << "nodes" << std::setw(10) << "ms"
+            << std::setw(8) << "ebf" << std::setw(10) << "speedup"
+            << std::setw(12) << "same move" << std::endl;
+  std::vector<namedFeatures> configs = makeConfigs();
+  configResult baseline;
+  for (std::size_t c = 0; c < configs.size(); ++c) {
+    configResult result =
+        run(positions, depth, hashMegabytes, configs[c].features);
+    if (c == 0) {
+      baseline = result;
+    }
+    long long nodes = 0;
+    for (long long depthNodes : result.depthNodes) {
+      nodes += depthNodes;
+    }
+    double ebf = std::sqrt(static_cast<double>(result.depthNodes[depth]) /
+                           std::max(1LL, result.depthNodes[depth - 2]));
+    int sameMoves = 0;
+    for (std::size_t p = 0; p < positions.size(); ++p) {
+      const moveType& a = result.bestMoves[p];
+      const moveType& b = baseline.bestMoves[p];
+      sameMoves += a.from == b.from && a.to == b.to &&
+                   a.promotion == b.promotion;
+    }
+    std::cout << std::left << std::setw(22) << configs[c].name << std::right
+              << std::setw(14) << nodes << std::setw(10)
+              << result.depthMs[depth] << std::fixed << std::setprecision(2)
+              << std::setw(8) << ebf << std::setw(9)
+              << static_cast<double>(baseline.depthMs[depth]) /
+                     std::max(1LL, result.depthMs[depth])
+              << "x" << std::setw(7) << sameMoves << "/" << positions.size()
+              << std::endl;
+    // time to each depth, to see where the savings start
+    std::cout << std::setw(22) << "" << "  by depth ms:";
+    for (int d = 1; d <= depth; ++d) {
+      std::cout << " " << result.depthMs[d];
+    }
+    std::cout << std::endl;
+  }
+  return 0;
+}
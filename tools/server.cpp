@@ -0,0 +1,72 @@
+// hosts many games in one process for other programs to talk to over a
+// local socket, one request per line (see SessionShard in SessionServer.h).
+// chess_loadgen measures it.
+//
+//   chess_server --port 9000 --workers 4
+//   chess_server --unix /tmp/chess.sock
+
+#include <csignal>
+#include <iostream>
+#include <string>
+
+#include "SessionServer.h"
+
+namespace {
+
+SessionServer* running = nullptr;
+
+void onSignal(int) {
+  if (running) {
+    running->stop();
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ServerConfig config;
+  int port = 9000;
+  std::string unixPath;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--port" && i + 1 < argc) {
+      port = std::stoi(argv[++i]);
+    } else if (arg == "--unix" && i + 1 < argc) {
+      unixPath = argv[++i];
+    } else if (arg == "--workers" && i + 1 < argc) {
+      config.workers = std::stoi(argv[++i]);
+    } else if (arg == "--max-sessions" && i + 1 < argc) {
+      config.maxSessions = std::stoll(argv[++i]);
+    } else if (arg == "--hash" && i + 1 < argc) {
+      config.hashMegabytes = std::stoi(argv[++i]);
+    } else if (arg == "--max-nodes" && i + 1 < argc) {
+      config.maxEngineNodes = std::stoll(argv[++i]);
+    } else {
+      std::cout << "usage: chess_server [--port n | --unix path] [--workers n]"
+                   " [--max-sessions n] [--hash mb] [--max-nodes n]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  SessionServer server(config);
+  if (unixPath.empty() ? !server.listenTcp(port)
+                       : !server.listenUnix(unixPath)) {
+    return 1;
+  }
+  running = &server;
+  std::signal(SIGINT, onSignal);
+  std::signal(SIGTERM, onSignal);
+  std::cout << "listening on "
+            << (unixPath.empty() ? "127.0.0.1:" + std::to_string(port)
+                                 : unixPath)
+            << " with " << config.workers << " workers, "
+            << sizeof(gameSession) << " bytes per session plus up to "
+            << "100 repetition keys" << std::endl;
+  server.run();
+  running = nullptr;
+  std::cout << server.getRequestCount() << " requests, "
+            << server.getSessionCount() << " sessions open at exit"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,140 @@
+// checks the sliding attack backends (SlidingAttacks.h) against each other
+// and times them. every square gets random occupancies plus the occupancies
+// of the bench positions, and every backend has to give the same attacks as
+// the loop one. then prints rook and bishop attacks per second for each.
+//
+//   chess_sliders
+//   chess_sliders --samples 200000 --time 1
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Board.h"
+#include "SlidingAttacks.h"
+
+namespace {
+
+const SliderBackend backends[] = {SliderBackend::Loop,
+                                  SliderBackend::KoggeStone,
+                                  SliderBackend::Magic, SliderBackend::Pext};
+
+const std::vector<std::string> positions = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+};
+
+volatile std::uint64_t sink = 0;
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int samples = 100000;
+  double minSeconds = 0.3;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--samples" && i + 1 < argc) {
+      samples = std::stoi(argv[++i]);
+    } else if (arg == "--time" && i + 1 < argc) {
+      minSeconds = std::stod(argv[++i]);
+    } else {
+      std::cout << "usage: chess_sliders [--samples n] [--time seconds]"
+                << std::endl;
+      return 1;
+    }
+  }
+
+  // sparse, dense and in between, plus real positions
+  std::mt19937_64 random(1);
+  std::vector<std::uint64_t> occupancies;
+  for (int i = 0; i < samples; ++i) {
+    std::uint64_t bits = random();
+    switch (i % 3) {
+      case 0:
+        bits &= random() & random();
+        break;
+      case 1:
+        bits &= random();
+        break;
+    }
+    occupancies.push_back(bits);
+  }
+  for (const std::string& fen : positions) {
+    Board board;
+    board.loadFen(fen);
+    std::array<int, 64> squares;
+    for (int i = 0; i < 64; ++i) {
+      squares[i] = board.getPiece(i);
+    }
+    occupancies.push_back(occupancyOf(squares));
+  }
+
+  SliderBackend startup = getSliderBackend();
+  std::cout << "picked at startup: " << sliderBackendName(startup)
+            << ", fastest by cpuid: "
+            << sliderBackendName(fastestSliderBackend()) << std::endl;
+
+  std::vector<std::uint64_t> expected;
+  setSliderBackend(SliderBackend::Loop);
+  for (std::uint64_t occupied : occupancies) {
+    for (int square = 0; square < 64; ++square) {
+      expected.push_back(rookAttackBits(square, occupied));
+      expected.push_back(bishopAttackBits(square, occupied));
+    }
+  }
+
+  int failures = 0;
+  std::cout << std::left << std::setw(14) << "backend" << std::right
+            << std::setw(12) << "mismatches" << std::setw(18)
+            << "rook attacks/s" << std::setw(18) << "bishop attacks/s"
+            << std::endl;
+  for (SliderBackend backend : backends) {
+    if (!setSliderBackend(backend)) {
+      std::cout << std::left << std::setw(14) << sliderBackendName(backend)
+                << "not supported on this cpu" << std::endl;
+      continue;
+    }
+    long long mismatches = 0;
+    std::size_t k = 0;
+    for (std::uint64_t occupied : occupancies) {
+      for (int square = 0; square < 64; ++square) {
+        mismatches += rookAttackBits(square, occupied) != expected[k++];
+        mismatches += bishopAttackBits(square, occupied) != expected[k++];
+      }
+    }
+    failures += mismatches != 0;
+
+    double rate[2];
+    for (int bishop = 0; bishop < 2; ++bishop) {
+      long long calls = 0;
+      double seconds = 0;
+      std::uint64_t total = 0;
+      while (seconds < minSeconds) {
+        auto start = std::chrono::steady_clock::now();
+        for (std::uint64_t occupied : occupancies) {
+          for (int square = 0; square < 64; ++square) {
+            total += bishop ? bishopAttackBits(square, occupied)
+                            : rookAttackBits(square, occupied);
+          }
+        }
+        calls += 64 * static_cast<long long>(occupancies.size());
+        seconds += std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+      }
+      sink = sink + total;
+      rate[bishop] = calls / seconds;
+    }
+    std::cout << std::left << std::setw(14) << sliderBackendName(backend)
+              << std::right << std::setw(12) << mismatches << std::fixed
+              << std::setprecision(0) << std::setw(18) << rate[0]
+              << std::setw(18) << rate[1] << std::endl;
+  }
+  setSliderBackend(startup);
+  return failures ? 1 : 0;
+}
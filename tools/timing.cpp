@@ -0,0 +1,160 @@
+// checks how well the time manager keeps to its budgets. runs searches on a
+// clock from random middlegame positions, optionally with extra threads
+// spinning to load the machine, and compares the time each move took with
+// the soft and hard limits it was given.
+//
+//   chess_timing --searches 40 --clock 60000 --inc 1000
+//   chess_timing --threads 2 --load 4
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Search.h"
+#include "TranspositionTable.h"
+
+namespace {
+
+struct MoveTiming {
+  int softMs;
+  int hardMs;
+  double usedMs;
+};
+
+Board randomPosition(std::mt19937& random) {
+  while (true) {
+    Board board;
+    int plies = 10 + random() % 30;
+    for (int ply = 0; ply < plies; ++ply) {
+      std::vector<moveType> moves = board.getMoveList();
+      if (moves.empty()) {
+        break;
+      }
+      board.makeMove(moves[random() % moves.size()]);
+    }
+    if (board.getStatus() == GameStatus::Ongoing &&
+        board.getMoveList().size() > 1) {
+      return board;
+    }
+  }
+}
+
+double percentile(std::vector<double> values, double fraction) {
+  std::sort(values.begin(), values.end());
+  return values[std::min(values.size() - 1,
+                         static_cast<std::size_t>(fraction * values.size()))];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int searches = 40;
+  int clockMs = 60000;
+  int incrementMs = 1000;
+  int movesToGo = 0;
+  int threads = 1;
+  int load = 0;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    if (arg == "--searches") {
+      searches = std::stoi(argv[i + 1]);
+    } else if (arg == "--clock") {
+      clockMs = std::stoi(argv[i + 1]);
+    } else if (arg == "--inc") {
+      incrementMs = std::stoi(argv[i + 1]);
+    } else if (arg == "--movestogo") {
+      movesToGo = std::stoi(argv[i + 1]);
+    } else if (arg == "--threads") {
+      threads = std::max(1, std::stoi(argv[i + 1]));
+    } else if (arg == "--load") {
+      load = std::stoi(argv[i + 1]);
+    } else {
+      std::cout << "usage: chess_timing [--searches n] [--clock ms] [--inc ms]"
+                   " [--movestogo n] [--threads n] [--load n]"
+                << std::endl;
+      return 1;
+    }
+  }
+  if (argc % 2 == 0) {
+    std::cout << "missing value for " << argv[argc - 1] << std::endl;
+    return 1;
+  }
+
+  // busy threads competing with the searches for the cores
+  std::atomic<bool> done{false};
+  std::vector<std::thread> spinners;
+  for (int i = 0; i < load; ++i) {
+    spinners.emplace_back([&] {
+      volatile unsigned long long spin = 0;
+      while (!done.load(std::memory_order_relaxed)) {
+        spin = spin + 1;
+      }
+    });
+  }
+
+  std::vector<MoveTiming> timings;
+  std::mutex timingsMutex;
+  std::atomic<int> next{0};
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t] {
+      std::mt19937 random(1234 + t);
+      TranspositionTable table(16);
+      std::atomic<bool> stopFlag{false};
+      while (next.fetch_add(1) < searches) {
+        Board position = randomPosition(random);
+        SearchLimits limits;
+        limits.timeLeftMs = clockMs;
+        limits.incrementMs = incrementMs;
+        limits.movesToGo = movesToGo;
+        Search search(stopFlag, &table);
+        auto start = std::chrono::steady_clock::now();
+        search.think(position, limits, nullptr);
+        double used = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+        const TimeManager& manager = search.getTimeManager();
+        std::lock_guard<std::mutex> lock(timingsMutex);
+        // soft as it stood at the end, after any extension for an unstable
+        // best move
+        timings.push_back({manager.getSoftMs(), manager.getHardMs(), used});
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  done = true;
+  for (auto& spinner : spinners) {
+    spinner.join();
+  }
+
+  std::vector<double> ofSoft, overHard;
+  int pastHard = 0;
+  double usedTotal = 0, softTotal = 0;
+  for (const MoveTiming& timing : timings) {
+    ofSoft.push_back(timing.usedMs / timing.softMs);
+    overHard.push_back(timing.usedMs - timing.hardMs);
+    pastHard += timing.usedMs > timing.hardMs;
+    usedTotal += timing.usedMs;
+    softTotal += timing.softMs;
+  }
+  std::cout << timings.size() << " searches on " << threads << " threads with "
+            << load << " busy threads, clock " << clockMs << "+"
+            << incrementMs << " ms" << std::endl;
+  std::cout << "budget: soft " << timings[0].softMs << " ms, hard "
+            << timings[0].hardMs << " ms (first search)" << std::endl;
+  std::cout << "used/soft: mean " << usedTotal / softTotal << ", median "
+            << percentile(ofSoft, 0.5) << ", p90 " << percentile(ofSoft, 0.9)
+            << std::endl;
+  std::cout << "past the hard limit: " << pastHard << " of " << timings.size()
+            << ", worst by " << std::max(0.0, percentile(overHard, 1.0))
+            << " ms" << std::endl;
+  return 0;
+}
@@ -0,0 +1,249 @@
+// headless engine vs engine matches between two configurations, spread over
+// every core. results are from the point of view of engine A.
+//
+//   chess_tournament --openings tools/openings.epd --games 1000
+//                    --a nodes=20000 --b nodes=40000 --sprt 0,10
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Profiler.h"
+#include "SelfPlay.h"
+#include "TaskScheduler.h"
+
+namespace {
+
+struct MatchOptions {
+  std::string openingsPath;
+  std::string profilePath;
+  int games = 100;
+  int threads = std::max(1u, std::thread::hardware_concurrency());
+  PlayerConfig a, b;
+  bool useSprt = false;
+  double elo0 = 0, elo1 = 10, alpha = 0.05, beta = 0.05;
+};
+
+struct Tally {
+  int wins = 0, draws = 0, losses = 0;  // for engine A
+  int played() const { return wins + draws + losses; }
+};
+
+bool parsePlayer(const std::string& text, PlayerConfig& player) {
+  std::istringstream items(text);
+  std::string item;
+  while (std::getline(items, item, ',')) {
+    auto equals = item.find('=');
+    if (equals == std::string::npos) {
+      return false;
+    }
+    std::string key = item.substr(0, equals);
+    std::string value = item.substr(equals + 1);
+    if (key == "name") {
+      player.name = value;
+    } else if (key == "depth") {
+      player.limits.depth = std::stoi(value);
+    } else if (key == "movetime") {
+      player.limits.moveTimeMs = std::stoi(value);
+    } else if (key == "nodes") {
+      player.limits.nodes = std::stoll(value);
+    } else if (key == "hash") {
+      player.hashMegabytes = std::stoul(value);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+double eloFromScore(double score) {
+  score = std::clamp(score, 1e-6, 1 - 1e-6);
+  return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+double scoreFromElo(double elo) { return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0)); }
+
+// mean score and per game variance of the results so far
+void scoreStats(const Tally& tally, double& mean, double& variance) {
+  double n = tally.played();
+  mean = (tally.wins + 0.5 * tally.draws) / n;
+  variance = (tally.wins * std::pow(1 - mean, 2) +
+              tally.draws * std::pow(0.5 - mean, 2) +
+              tally.losses * std::pow(mean, 2)) /
+             n;
+}
+
+// log likelihood ratio of elo1 against elo0, normal approximation of the
+// trinomial model
+double sprtLlr(const Tally& tally, double elo0, double elo1) {
+  if (tally.played() < 2) {
+    return 0;
+  }
+  double mean, variance;
+  scoreStats(tally, mean, variance);
+  if (variance <= 0) {
+    return 0;
+  }
+  double s0 = scoreFromElo(elo0), s1 = scoreFromElo(elo1);
+  return tally.played() * (s1 - s0) * (2 * mean - s0 - s1) / (2 * variance);
+}
+
+void printUsage() {
+  std::cout << "usage: chess_tournament [--openings file.epd] [--games n]"
+               " [--threads n]\n"
+               "         [--a key=value,...] [--b key=value,...]"
+               " [--sprt elo0,elo1] [--alpha a] [--beta b]"
+               " [--profile out.json]\n"
+               "player keys: name, depth, movetime (ms), nodes, hash (MB)\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  MatchOptions options;
+  options.a.name = "A";
+  options.b.name = "B";
+  options.a.limits.nodes = options.b.limits.nodes = 20000;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    std::string value = i + 1 < argc ? argv[i + 1] : "";
+    bool ok = true;
+    if (arg == "--openings") {
+      options.openingsPath = value;
+    } else if (arg == "--profile") {
+      options.profilePath = value;
+    } else if (arg == "--games") {
+      options.games = std::stoi(value);
+    } else if (arg == "--threads") {
+      options.threads = std::max(1, std::stoi(value));
+    } else if (arg == "--a") {
+      ok = parsePlayer(value, options.a);
+    } else if (arg == "--b") {
+      ok = parsePlayer(value, options.b);
+    } else if (arg == "--sprt") {
+      options.useSprt = true;
+      ok = std::sscanf(value.c_str(), "%lf,%lf", &options.elo0,
+                       &options.elo1) == 2;
+    } else if (arg == "--alpha") {
+      options.alpha = std::stod(value);
+    } else if (arg == "--beta") {
+      options.beta = std::stod(value);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      printUsage();
+      return 1;
+    }
+    i++;
+  }
+
+  std::vector<Board> openings;
+  if (!options.openingsPath.empty()) {
+    openings = loadOpenings(options.openingsPath);
+    if (openings.empty()) {
+      std::cout << options.openingsPath << " has no usable positions"
+                << std::endl;
+      return 1;
+    }
+  } else {
+    openings.push_back(Board());
+    std::cout << "no openings given, every game starts from the initial "
+                 "position"
+              << std::endl;
+  }
+
+  double lowerBound = std::log(options.beta / (1 - options.alpha));
+  double upperBound = std::log((1 - options.beta) / options.alpha);
+
+  Tally tally;
+  std::mutex tallyMutex;
+  std::atomic<bool> stopFlag{false};
+  auto startTime = std::chrono::steady_clock::now();
+
+  // games come in pairs from the same opening with colours swapped, one task
+  // each. once the sprt has an answer the games not started are cancelled and
+  // the ones being played stop where they are
+  TaskScheduler scheduler(options.threads);
+  TaskGroup group(scheduler);
+  auto play = [&](int game) {
+    const Board& opening = openings[(game / 2) % openings.size()];
+    bool aIsWhite = game % 2 == 0;
+    SelfPlayGame result =
+        aIsWhite ? playGame(opening, options.a, options.b, stopFlag)
+                 : playGame(opening, options.b, options.a, stopFlag);
+    if (result.outcome == GameOutcome::Unfinished) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(tallyMutex);
+    if (result.outcome == GameOutcome::Draw) {
+      tally.draws++;
+    } else if ((result.outcome == GameOutcome::WhiteWins) == aIsWhite) {
+      tally.wins++;
+    } else {
+      tally.losses++;
+    }
+    if (options.useSprt) {
+      double llr = sprtLlr(tally, options.elo0, options.elo1);
+      if (llr <= lowerBound || llr >= upperBound) {
+        stopFlag.store(true);
+        group.cancel();
+      }
+    }
+    if (tally.played() % 10 == 0) {
+      std::cout << "games " << tally.played() << "  +" << tally.wins << " ="
+                << tally.draws << " -" << tally.losses << std::endl;
+    }
+  };
+  for (int game = 0; game < options.games; ++game) {
+    group.run([&play, game]() { play(game); });
+  }
+  group.wait();
+
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - startTime)
+                       .count();
+  int played = tally.played();
+  std::cout << std::endl
+            << options.a.name << " vs " << options.b.name << ": " << played
+            << " games, W/D/L " << tally.wins << "/" << tally.draws << "/"
+            << tally.losses << std::endl;
+  if (played) {
+    double mean, variance;
+    scoreStats(tally, mean, variance);
+    double margin = 1.96 * std::sqrt(variance / played);  // 95% interval
+    double elo = eloFromScore(mean);
+    std::cout << "score " << mean * 100 << "%, elo " << elo << " +/- "
+              << (eloFromScore(mean + margin) - eloFromScore(mean - margin)) / 2
+              << std::endl;
+  }
+  if (options.useSprt) {
+    double llr = sprtLlr(tally, options.elo0, options.elo1);
+    std::cout << "sprt [" << options.elo0 << ", " << options.elo1
+              << "] llr " << llr << " bounds [" << lowerBound << ", "
+              << upperBound << "] ";
+    if (llr >= upperBound) {
+      std::cout << "H1 accepted" << std::endl;
+    } else if (llr <= lowerBound) {
+      std::cout << "H0 accepted" << std::endl;
+    } else {
+      std::cout << "inconclusive" << std::endl;
+    }
+  }
+  std::cout << options.threads << " threads, " << seconds << " s, "
+            << played / seconds << " games/s" << std::endl;
+  if (!options.profilePath.empty()) {
+    profileWriteJson(options.profilePath);
+  }
+  return 0;
+}
@@ -0,0 +1,510 @@
+// texel tuning of the evaluation weights. every position gets the result of
+// the game it came from, and the weights are moved to make
+// sigmoid(eval) predict those results better. the eval is a sum of weights
+// (piece values, piece square tables, mobility), so each position is kept in
+// 32 bytes as its pieces and mobility counts, and the error and its gradient
+// are summed in pieces of a fixed size on a TaskScheduler. writes a file the
+// game and tools load with --eval.
+//
+//   chess_tune --data train.bin --out eval.txt
+//   chess_tune --data quiet.epd --method local --iterations 20
+//   chess_tune --data train.bin --scaling
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Evaluate.h"
+#include "SlidingAttacks.h"
+#include "TaskScheduler.h"
+#include "TrainingData.h"
+
+namespace {
+
+struct tuningPosition {  // a labelled position in 32 bytes
+  std::uint64_t occupancy;  // bit i set if square i (0 is a8) has a piece
+  std::array<std::uint8_t, 16> pieces;  // piece ids two to a byte, in the
+                                        // order of the occupied squares
+  std::array<std::int8_t, 4> mobility;  // mobilityCounts for rook, knight,
+                                        // bishop and queen
+  std::uint8_t result;  // 0 black won, 1 draw, 2 white won
+  std::uint8_t padding[3];
+};
+static_assert(sizeof(tuningPosition) == 32,
+              "tuningPosition should be 32 bytes");
+
+// the weights as one vector: piece values, then a table of 64 for each piece
+// type, then mobility. the eval is linear in them
+constexpr int VALUES = 0;
+constexpr int TABLES = 7;
+constexpr int MOBILITY = TABLES + 7 * 64;
+constexpr int WEIGHT_COUNT = MOBILITY + 7;
+
+std::vector<double> toWeights(const EvalParams& params) {
+  std::vector<double> weights(WEIGHT_COUNT);
+  for (int type = 0; type < 7; ++type) {
+    weights[VALUES + type] = params.pieceValues[type];
+    weights[MOBILITY + type] = params.mobility[type];
+    for (int i = 0; i < 64; ++i) {
+      weights[TABLES + type * 64 + i] = params.pieceSquare[type][i];
+    }
+  }
+  return weights;
+}
+
+EvalParams toParams(const std::vector<double>& weights) {
+  EvalParams params;
+  for (int type = 0; type < 7; ++type) {
+    params.pieceValues[type] =
+        static_cast<int>(std::lround(weights[VALUES + type]));
+    params.mobility[type] =
+        static_cast<int>(std::lround(weights[MOBILITY + type]));
+    for (int i = 0; i < 64; ++i) {
+      params.pieceSquare[type][i] =
+          static_cast<int>(std::lround(weights[TABLES + type * 64 + i]));
+    }
+  }
+  return params;
+}
+
+tuningPosition makePosition(const std::array<int, 64>& squares, int result) {
+  tuningPosition position{};
+  int count = 0;
+  for (int i = 0; i < 64; ++i) {
+    if (squares[i]) {
+      position.occupancy |= 1ULL << i;
+      position.pieces[count / 2] |= squares[i] << (count % 2 * 4);
+      count++;
+    }
+  }
+  std::array<int, 7> mobility = mobilityCounts(squares);
+  for (int type = 2; type <= 5; ++type) {
+    position.mobility[type - 2] = static_cast<std::int8_t>(mobility[type]);
+  }
+  position.result = static_cast<std::uint8_t>(result);
+  return position;
+}
+
+// "1-0", "0-1" or "1/2-1/2" anywhere after the fen, or [1.0] [0.5] [0.0]
+int epdResult(const std::string& line) {
+  if (line.find("1/2-1/2") != std::string::npos ||
+      line.find("[0.5]") != std::string::npos) {
+    return 1;
+  }
+  if (line.find("1-0") != std::string::npos ||
+      line.find("[1.0]") != std::string::npos) {
+    return 2;
+  }
+  if (line.find("0-1") != std::string::npos ||
+      line.find("[0.0]") != std::string::npos) {
+    return 0;
+  }
+  return -1;
+}
+
+bool loadPositions(const std::string& path,
+                   std::vector<tuningPosition>& positions, long long limit) {
+  std::ifstream probe(path, std::ios::binary);
+  std::uint32_t magic = 0;
+  if (!probe) {
+    std::cout << "couldn't open " << path << std::endl;
+    return false;
+  }
+  probe.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  std::array<int, 64> squares;
+  if (magic == TRAINING_MAGIC) {
+    TrainingReader reader;
+    reader.open(path);
+    trainingSample sample;
+    while (static_cast<long long>(positions.size()) < limit &&
+           reader.next(sample)) {
+      for (int i = 0; i < 64; ++i) {
+        squares[i] = sample.position.getPiece(i);
+      }
+      int result = sample.outcome == GameOutcome::WhiteWins   ? 2
+                   : sample.outcome == GameOutcome::BlackWins ? 0
+                                                              : 1;
+      positions.push_back(makePosition(squares, result));
+    }
+    return true;
+  }
+  std::ifstream file(path);
+  std::string line;
+  Board board;
+  while (static_cast<long long>(positions.size()) < limit &&
+         std::getline(file, line)) {
+    int result = epdResult(line);
+    if (result < 0 || !board.loadFen(line.substr(0, line.find(';')))) {
+      continue;
+    }
+    for (int i = 0; i < 64; ++i) {
+      squares[i] = board.getPiece(i);
+    }
+    positions.push_back(makePosition(squares, result));
+  }
+  return true;
+}
+
+// eval from white's point of view, the same sum evaluateSquares does
+double linearEval(const tuningPosition& position,
+                  const std::vector<double>& weights) {
+  double score = 0;
+  std::uint64_t bits = position.occupancy;
+  for (int count = 0; bits; ++count, bits &= bits - 1) {
+    int square = lowestBit(bits);
+    int id = position.pieces[count / 2] >> (count % 2 * 4) & 15;
+    int type = id % 8;
+    if (id / 8) {
+      score -= weights[VALUES + type] +
+               weights[TABLES + type * 64 + (square ^ 56)];
+    } else {
+      score += weights[VALUES + type] + weights[TABLES + type * 64 + square];
+    }
+  }
+  for (int type = 2; type <= 5; ++type) {
+    score += weights[MOBILITY + type] * position.mobility[type - 2];
+  }
+  return score;
+}
+
+// squared error of sigmoid(eval) against the results over [first, last).
+// with a gradient, also adds d(error)/d(weight) for every weight to it
+double errorSum(const std::vector<tuningPosition>& positions,
+                std::size_t first, std::size_t last,
+                const std::vector<double>& weights, double k,
+                double* gradient) {
+  const double scale = k * std::log(10.0) / 400;
+  double sum = 0;
+  for (std::size_t p = first; p < last; ++p) {
+    const tuningPosition& position = positions[p];
+    double sigmoid = 1 / (1 + std::exp(-scale * linearEval(position, weights)));
+    double error = position.result * 0.5 - sigmoid;
+    sum += error * error;
+    if (!gradient) {
+      continue;
+    }
+    double slope = -2 * error * sigmoid * (1 - sigmoid) * scale;
+    std::uint64_t bits = position.occupancy;
+    for (int count = 0; bits; ++count, bits &= bits - 1) {
+      int square = lowestBit(bits);
+      int id = position.pieces[count / 2] >> (count % 2 * 4) & 15;
+      int type = id % 8;
+      double sign = id / 8 ? -slope : slope;
+      gradient[VALUES + type] += sign;
+      gradient[TABLES + type * 64 + (id / 8 ? square ^ 56 : square)] += sign;
+    }
+    for (int type = 2; type <= 5; ++type) {
+      gradient[MOBILITY + type] += slope * position.mobility[type - 2];
+    }
+  }
+  return sum;
+}
+
+const std::size_t PIECE_POSITIONS = 2048;
+
+// mean error over all positions. the positions are cut into pieces of a fixed
+// size, each summed into its own partial sums on whichever worker takes it,
+// and the pieces are added up in order at the end, so the answer is the same
+// on any number of threads
+double meanError(const std::vector<tuningPosition>& positions,
+                 const std::vector<double>& weights, double k,
+                 TaskScheduler& scheduler, std::vector<double>* gradient) {
+  std::size_t pieces =
+      (positions.size() + PIECE_POSITIONS - 1) / PIECE_POSITIONS;
+  std::vector<double> sums(pieces);
+  std::vector<std::vector<double>> partials(
+      gradient ? pieces : 0, std::vector<double>(WEIGHT_COUNT, 0.0));
+  parallelFor(scheduler, 0, pieces, 1,
+              [&](std::size_t first, std::size_t last) {
+                for (std::size_t p = first; p < last; ++p) {
+                  sums[p] = errorSum(
+                      positions, p * PIECE_POSITIONS,
+                      std::min(positions.size(), (p + 1) * PIECE_POSITIONS),
+                      weights, k, gradient ? partials[p].data() : nullptr);
+                }
+              });
+  double n = std::max<std::size_t>(1, positions.size());
+  double total = 0;
+  for (double sum : sums) {
+    total += sum;
+  }
+  if (gradient) {
+    gradient->assign(WEIGHT_COUNT, 0.0);
+    for (const std::vector<double>& partial : partials) {
+      for (int i = 0; i < WEIGHT_COUNT; ++i) {
+        (*gradient)[i] += partial[i] / n;
+      }
+    }
+  }
+  return total / n;
+}
+
+// the k that makes the current weights fit the results best, by golden
+// section search. it turns centipawns into a win probability
+double fitK(const std::vector<tuningPosition>& positions,
+            const std::vector<double>& weights, TaskScheduler& scheduler) {
+  double low = 0.1, high = 3.0;
+  const double ratio = (std::sqrt(5.0) - 1) / 2;
+  for (int step = 0; step < 30; ++step) {
+    double a = high - ratio * (high - low);
+    double b = low + ratio * (high - low);
+    if (meanError(positions, weights, a, scheduler, nullptr) <
+        meanError(positions, weights, b, scheduler, nullptr)) {
+      high = b;
+    } else {
+      low = a;
+    }
+  }
+  return (low + high) / 2;
+}
+
+double msSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<std::string> dataPaths;
+  std::string outPath = "eval.txt";
+  std::string startPath;
+  std::string method = "gradient";
+  int threads = std::max(1u, std::thread::hardware_concurrency());
+  int iterations = 300;
+  double rate = 1.0;
+  double validationShare = 0.1;
+  long long limit = 1LL << 40;
+  bool scaling = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--data" && i + 1 < argc) {
+      dataPaths.push_back(argv[++i]);
+    } else if (arg == "--out" && i + 1 < argc) {
+      outPath = argv[++i];
+    } else if (arg == "--start" && i + 1 < argc) {
+      startPath = argv[++i];
+    } else if (arg == "--method" && i + 1 < argc) {
+      method = argv[++i];
+    } else if (arg == "--threads" && i + 1 < argc) {
+      threads = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--iterations" && i + 1 < argc) {
+      iterations = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--rate" && i + 1 < argc) {
+      rate = std::stod(argv[++i]);
+    } else if (arg == "--validation" && i + 1 < argc) {
+      validationShare = std::clamp(std::stod(argv[++i]), 0.0, 0.9);
+    } else if (arg == "--limit" && i + 1 < argc) {
+      limit = std::max(1LL, std::stoll(argv[++i]));
+    } else if (arg == "--scaling") {
+      scaling = true;
+    } else {
+      std::cout << "usage: chess_tune --data file [--data file]... [--out "
+                   "eval.txt] [--start eval.txt]\n"
+                   "                  [--method gradient|local] [--iterations "
+                   "n] [--rate r] [--threads n]\n"
+                   "                  [--validation share] [--limit "
+                   "positions] [--scaling]"
+                << std::endl;
+      return 1;
+    }
+  }
+  if (dataPaths.empty() || (method != "gradient" && method != "local")) {
+    std::cout << "need --data, and --method is gradient or local"
+              << std::endl;
+    return 1;
+  }
+  if (!startPath.empty() && !loadEvalParams(startPath)) {
+    return 1;
+  }
+
+  auto loadStart = std::chrono::steady_clock::now();
+  std::vector<tuningPosition> all;
+  for (const std::string& path : dataPaths) {
+    if (!loadPositions(path, all, limit)) {
+      return 1;
+    }
+  }
+  // every n-th position is held back to check the tuning generalises
+  std::vector<tuningPosition> positions, validation;
+  int every = validationShare > 0 ? static_cast<int>(1 / validationShare) : 0;
+  for (std::size_t i = 0; i < all.size(); ++i) {
+    (every && i % every == 0 ? validation : positions).push_back(all[i]);
+  }
+  std::vector<tuningPosition>().swap(all);
+  if (positions.empty()) {
+    std::cout << "no labelled positions" << std::endl;
+    return 1;
+  }
+  std::cout << positions.size() << " positions to tune on, "
+            << validation.size() << " held back, "
+            << positions.size() * sizeof(tuningPosition) / 1024
+            << " KB in memory, loaded in " << std::fixed
+            << std::setprecision(0) << msSince(loadStart) << " ms"
+            << std::endl;
+
+  std::vector<double> weights = toWeights(evalParams());
+  // the sum has to be the evaluation's, or the tuning means nothing
+  int mismatches = 0;
+  for (std::size_t p = 0; p < positions.size() && p < 1000; ++p) {
+    std::array<int, 64> squares = {};
+    std::uint64_t bits = positions[p].occupancy;
+    for (int count = 0; bits; ++count, bits &= bits - 1) {
+      squares[lowestBit(bits)] =
+          positions[p].pieces[count / 2] >> (count % 2 * 4) & 15;
+    }
+    mismatches += evaluateSquares(squares, false) !=
+                  static_cast<int>(linearEval(positions[p], weights));
+  }
+  if (mismatches) {
+    std::cout << mismatches << " positions where the tuner's eval doesn't "
+              << "match evaluateSquares" << std::endl;
+    return 1;
+  }
+
+  if (scaling) {
+    std::vector<int> threadCounts;
+    for (int count = 1; count < threads; count *= 2) {
+      threadCounts.push_back(count);
+    }
+    threadCounts.push_back(threads);
+    double single = 0;
+    std::vector<double> gradient;
+    for (int count : threadCounts) {
+      const int passes = 5;
+      TaskScheduler counted(count);
+      auto start = std::chrono::steady_clock::now();
+      for (int pass = 0; pass < passes; ++pass) {
+        meanError(positions, weights, 1.0, counted, &gradient);
+      }
+      double ms = msSince(start) / passes;
+      if (count == 1) {
+        single = ms;
+      }
+      std::cout << count << " thread" << (count > 1 ? "s" : " ") << ": "
+                << std::setprecision(1) << ms << " ms per pass, "
+                << single / ms << "x, "
+                << positions.size() / ms / 1000 << "M positions/s"
+                << std::endl;
+    }
+    return 0;
+  }
+
+  TaskScheduler scheduler(threads);
+  double k = fitK(positions, weights, scheduler);
+  auto report = [&](const std::string& label, double ms) {
+    std::cout << label << ": error " << std::setprecision(6)
+              << meanError(positions, weights, k, scheduler, nullptr);
+    if (!validation.empty()) {
+      std::cout << ", held back "
+                << meanError(validation, weights, k, scheduler, nullptr);
+    }
+    if (ms >= 0) {
+      std::cout << ", " << std::setprecision(1) << ms << " ms";
+    }
+    std::cout << std::endl;
+  };
+  std::cout << "k " << std::setprecision(3) << k << std::endl;
+  report("start", -1);
+
+  auto tuneStart = std::chrono::steady_clock::now();
+  int done = 0;
+  if (method == "gradient") {
+    // adam: a step of about rate centipawns per iteration for every weight,
+    // whatever the size of its gradient
+    std::vector<double> gradient, moment(WEIGHT_COUNT), velocity(WEIGHT_COUNT);
+    const double beta1 = 0.9, beta2 = 0.999;
+    for (int iteration = 1; iteration <= iterations; ++iteration) {
+      auto start = std::chrono::steady_clock::now();
+      meanError(positions, weights, k, scheduler, &gradient);
+      for (int i = 0; i < WEIGHT_COUNT; ++i) {
+        moment[i] = beta1 * moment[i] + (1 - beta1) * gradient[i];
+        velocity[i] =
+            beta2 * velocity[i] + (1 - beta2) * gradient[i] * gradient[i];
+        double corrected = moment[i] / (1 - std::pow(beta1, iteration));
+        double spread = velocity[i] / (1 - std::pow(beta2, iteration));
+        weights[i] -= rate * corrected / (std::sqrt(spread) + 1e-12);
+      }
+      done++;
+      if (iteration % 25 == 0 || iteration == iterations) {
+        report("iteration " + std::to_string(iteration), msSince(start));
+      }
+    }
+  } else {
+    // the original texel method: nudge each weight by one either way and
+    // keep whatever lowers the error, until a pass changes nothing. no
+    // gradient, so it works for any eval, just slowly
+    // only weights some position uses, the king's value always cancels out
+    std::vector<bool> used(WEIGHT_COUNT);
+    for (const tuningPosition& position : positions) {
+      std::uint64_t bits = position.occupancy;
+      for (int count = 0; bits; ++count, bits &= bits - 1) {
+        int id = position.pieces[count / 2] >> (count % 2 * 4) & 15;
+        int square = lowestBit(bits);
+        used[VALUES + id % 8] = true;
+        used[TABLES + id % 8 * 64 + (id / 8 ? square ^ 56 : square)] = true;
+      }
+      for (int type = 2; type <= 5; ++type) {
+        used[MOBILITY + type] =
+            used[MOBILITY + type] || position.mobility[type - 2];
+      }
+    }
+    used[VALUES + 6] = false;
+    double best = meanError(positions, weights, k, scheduler, nullptr);
+    for (int pass = 1; pass <= iterations; ++pass) {
+      auto start = std::chrono::steady_clock::now();
+      int changed = 0;
+      for (int i = 0; i < WEIGHT_COUNT; ++i) {
+        if (!used[i]) {
+          continue;
+        }
+        for (double step : {1.0, -1.0}) {
+          weights[i] += step;
+          double error = meanError(positions, weights, k, scheduler, nullptr);
+          if (error < best) {
+            best = error;
+            changed++;
+            break;
+          }
+          weights[i] -= step;
+        }
+      }
+      done++;
+      report("pass " + std::to_string(pass) + ", " + std::to_string(changed) +
+                 " changed",
+             msSince(start));
+      if (!changed) {
+        break;
+      }
+    }
+  }
+  double tuneMs = msSince(tuneStart);
+
+  weights = toWeights(toParams(weights));  // what the eval will actually use
+  report("rounded", -1);
+  std::cout << std::setprecision(1) << done << " iterations in " << tuneMs
+            << " ms, " << tuneMs / std::max(1, done) << " ms each on "
+            << threads << " thread" << (threads > 1 ? "s" : "") << std::endl;
+  EvalParams tuned = toParams(weights);
+  std::cout << "piece values:";
+  for (int type = 1; type <= 5; ++type) {
+    std::cout << " " << evalParams().pieceValues[type] << "->"
+              << tuned.pieceValues[type];
+  }
+  std::cout << std::endl;
+  if (!saveEvalParams(outPath, tuned)) {
+    std::cout << "couldn't write " << outPath << std::endl;
+    return 1;
+  }
+  std::cout << "wrote " << outPath << std::endl;
+  return 0;
+}